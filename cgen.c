@@ -1232,6 +1232,9 @@ int rmfile (const char *path, FILE *out)
     return rc;
 }
 
+#include "lib/dirread.c"
+#include "lib/dr_open.c"
+
 /* Helper structure for collection sub-directories during the recurvive removal
 ** of a directory.
 */
@@ -1242,39 +1245,40 @@ struct _dlist {
     char path[1];
 };
 
-static int
-is_dotordotdot (const char*s)
-{
-    return (*s == '.' && (!s[1] || (s[1] == '.' && !s[2])));
-}
-
-/* Remove a directory - including (recursively) all of it' entries.
+/* Remove a directory - including (recursively) all of it' entries. The
+** directory reader 'dr' is shared by all levels of the recursion (each
+** directory is read completely and closed before it's sub-directories are
+** processed), so it's buffer is allocated only once.
 */
 static int
-rmrec (const char *path, FILE *out)
+rmrec (struct dirread *dr, const char *path, FILE *out)
 {
-    int rc;
-    DIR *dp;
-    struct dirent *de;
+    int rc, isdir;
+    struct dr_entry de;
     size_t bsz = 0, pl; char *buf = NULL, *p;
     dlist_t subdirs = NULL, ne;
     struct stat st;
 
-    if (!(dp = opendir (path))) { return -1; }
-    while ((de = readdir (dp))) {
-	if (is_dotordotdot (de->d_name)) { continue; }
-	pl = strlen (path) + strlen (de->d_name) + 2;
+    if (dr_open (dr, path)) { return -1; }
+    while ((rc = dr_next (dr, &de)) > 0) {
+	pl = strlen (path) + strlen (de.name) + 2;
 	if (pl > bsz) {
 	    bsz = pl + 1023; bsz -= bsz % 1024;
 	    if (!(p = (char *) realloc (buf, bsz))) { goto ERREXIT; }
 	    buf = p; 
 	}
-	snprintf (buf, bsz, "%s/%s", path, de->d_name);
-	if (lstat (buf, &st)) {
-	    if (errno == ENOENT) { continue; }
-	    goto ERREXIT;
+	snprintf (buf, bsz, "%s/%s", path, de.name);
+	if (de.type == DT_UNKNOWN) {
+	    /* No type in the directory entry ... */
+	    if (lstat (buf, &st)) {
+		if (errno == ENOENT) { continue; }
+		goto ERREXIT;
+	    }
+	    isdir = S_ISDIR (st.st_mode);
+	} else {
+	    isdir = (de.type == DT_DIR);
 	}
-	if (S_ISDIR (st.st_mode)) {
+	if (isdir) {
 	    if (!(ne = tsmalloc (dlist_s, strlen (buf)))) { goto ERREXIT; }
 	    ne->next = subdirs; subdirs = ne;
 	    strcpy (ne->path, buf);
@@ -1282,10 +1286,11 @@ rmrec (const char *path, FILE *out)
 	    goto ERREXIT;
 	}
     }
-    closedir (dp);
+    if (rc < 0) { goto ERREXIT; }
+    dr_close (dr);
     while (subdirs) {
 	ne = subdirs; subdirs = ne->next; ne->next = NULL;
-	if (rmrec (ne->path, out)) { goto ERREXIT; }
+	if (rmrec (dr, ne->path, out)) { goto ERREXIT; }
 	free (ne); ne = NULL;
     }
     if (buf) { free (buf); }
@@ -1296,6 +1301,7 @@ rmrec (const char *path, FILE *out)
     if (out) { fputs ((rc ? " failed\n" : " done\n"), out); }
     return rc;
 ERREXIT:
+    { int ec = errno; dr_close (dr); errno = ec; }
     while (subdirs) {
 	ne = subdirs; subdirs = ne->next;
 	ne->next = NULL; free (ne); ne = NULL;
@@ -1309,7 +1315,14 @@ rmfsentry (const char *path, FILE *out)
 {
     struct stat st;
     if (lstat (path, &st)) { return (errno == ENOENT ? 0 : -1); }
-    if (S_ISDIR (st.st_mode)) { return rmrec (path, out); }
+    if (S_ISDIR (st.st_mode)) {
+	struct dirread dr;
+	int rc;
+	dr_init (&dr, 0);
+	rc = rmrec (&dr, path, out);
+	dr_free (&dr);
+	return rc;
+    }
     return rmfile (path, out);
 }
 
@@ -28,6 +28,7 @@
 #include "lib/pbCopy.c"
 #include "lib/bgetline.c"
 #include "lib/puteol.c"
+#include "lib/arena.c"
 
 typedef struct list *list_t;
 struct list {
@@ -36,13 +37,15 @@ struct list {
     char *name, *value;
 };
 
+/* The elements of the list (together with their names and values) are
+** allocated from this arena; '_free_list()' releases all of them at once.
+*/
+static struct arena list_pool = ARENA_INIT;
+
 static void _free_list (list_t *_list)
 {
-    list_t list;
-    for (list = *_list; list; list = *_list) {
-	*_list = list->next;
-	cfree (list);
-    }
+    arena_free (&list_pool);
+    *_list = NULL;
 }
 
 static int _insert (list_t *_list, const char *name, const char *value)
@@ -54,11 +57,10 @@ static int _insert (list_t *_list, const char *name, const char *value)
 	if (!strcmp (list->name, name)) { list->ambiguous = 1; return 1; }
 	list = list->next;
     }
-    nl = strlen (name) + 1; vl = (value ? 0 : strlen (value) + 1);
-    ifnull (list = t_allocp (struct list, nl + vl)) {
-	return -1;
-    }
-    list->next = *_list; *_list = list;
+    nl = strlen (name) + 1; vl = (value ? strlen (value) + 1 : 0);
+    list = (list_t) arena_alloc (&list_pool, sizeof(struct list) + nl + vl);
+    ifnull (list) { return -1; }
+    list->next = *_list; *_list = list; list->ambiguous = 0;
     p = (char *)list + sizeof(struct list);
     list->name = p; p = pbCopy (p, name);
     if (value) {
@@ -23,7 +23,6 @@
 #include <stdarg.h>
 #include <stdbool.h>
 #include <dirent.h>
-#include <regex.h>
 #include <errno.h>
 #include <utime.h>
 #include <fcntl.h>
@@ -43,6 +42,10 @@
 #include "lib/x_strdup.c"
 #include "lib/store_progpath.c"
 #include "lib/bgetline.c"
+#include "lib/dirread.c"
+#include "lib/dr_open.c"
+#include "lib/strlist.c"
+#include "lib/exclude.c"
 
 static const char *src_excludes = ".srcdist-excludes";
 static const char *bin_excludes = ".bindist-excludes";
@@ -112,7 +115,7 @@ static void
 error (int ec, const char *fmt, ...)
 {
     va_list ap;
-    va_start (ap, fmt); eprintf (fmt, ap); va_end (ap);
+    va_start (ap, fmt); veprintf (fmt, ap); va_end (ap);
     exit (ec);
 }
 
@@ -157,11 +160,11 @@ usage (const char *fmt, ...)
 	exit (64);
     }
     fprintf (stderr,
-	     "\nUsage: %s [-p 'packcmd'] [-c 'cleancmd'] [-x 'excludes'] [-n]"
-	     " [-q] \\\n"
+	     "\nUsage: %s [-p 'packcmd'] [-c 'cleancmd'] [-x 'excludes']"
+	     " [-C 'cachefile'] [-n] [-q] \\\n"
 	     "                   srcdist [dir [suffix]]"
 	     "\n       %s [-p 'packcmd'] [-i 'installcmd'] [-x 'excludes']"
-	     " [-n] [-q] \\\n"
+	     " [-C 'cachefile'] [-n] [-q] \\\n"
 	     "                   bindist [dir [prefix [suffix]]]"
 	     "\n       %s -h"
 	     "\n       %s -V"
@@ -193,8 +196,15 @@ usage (const char *fmt, ...)
 	     "\n  -x 'excludes'"
 	     "\n     A file which contains pathname-patterns to be excluded"
 	     " from the"
-	     "\n     'srcdist'/'bindist' process."
+	     "\n     'srcdist'/'bindist' process. A file with the same"
+	     " name in a"
+	     "\n     sub-directory contains patterns for this sub-directory"
+	     " only."
 	     "\n     (Default: a compiled builtin)"
+	     "\n  -C 'cachefile'"
+	     "\n     Keep the compiled exclude rules in 'cachefile' (which is"
+	     " compiled anew"
+	     "\n     only if one of the exclude files changed)."
 	     "\n  prefix"
 	     "\n     The installation prefix (e.g. /usr, /usr/local, ...)"
 	     "\n  suffix"
@@ -272,69 +282,6 @@ buf_delete (char **_buf, size_t *_bufsz)
     cfree (*_buf); *_bufsz = 0;
 }
 
-#define ccharp(c) ((const char *) &(c))
-
-static void
-conv_path (const char *p, size_t len, char **_buf, size_t *_bufsz)
-{
-    char cc;
-    int brctx = 0;
-    while (len-- > 0) {
-	cc = *p++;
-	switch ((int) cc & 0xFF) {
-	    case '\\':
-		buf_puts (ccharp (cc), 1, _buf, _bufsz);
-		if (len > 0) {
-		    buf_puts (p++, 1, _buf, _bufsz); --len;
-		}
-		if (brctx > 0) { brctx = 3; }
-		break;
-	    case '[':
-		buf_puts (ccharp (cc), 1, _buf, _bufsz);
-		brctx = (brctx > 0 ? 3 : 1);
-		break;
-	    case '^': case '!':
-		if (brctx) {
-		    if (brctx < 2) { brctx = 2; }
-		} else {
-		    if (cc == '^') { buf_puts ("\\", 1, _buf, _bufsz); }
-		}
-		buf_puts (ccharp (cc), 1, _buf, _bufsz);
-	    case ']':
-		buf_puts (ccharp (cc), 1, _buf, _bufsz);
-		brctx = (brctx > 0 && brctx < 3 ? 3 : 0);
-		break;
-	    case '?':
-		if (brctx) {
-		    buf_puts (ccharp (cc), 1, _buf, _bufsz); brctx = 3;
-		} else {
-		    buf_puts (".", 1, _buf, _bufsz);
-		}
-		break;
-	    case '*':
-		if (brctx) {
-		    buf_puts (ccharp (cc), 1, _buf, _bufsz); brctx = 3;
-		} else {
-		    buf_puts (".*", 2, _buf, _bufsz);
-		}
-		break;
-	    case '$': case '{': case '}': case '+': case ' ': case '\t':
-	    case '.':
-		if (brctx) {
-		    brctx = 3;
-		} else {
-		    buf_puts ("\\", 1, _buf, _bufsz);
-		}
-		buf_puts (ccharp (cc), 1, _buf, _bufsz);
-		break;
-	    default:
-		if (brctx > 0) { brctx = 3; }
-		buf_puts (ccharp (cc), 1, _buf, _bufsz);
-		break;
-	}
-    }
-}
-
 static int
 is_dir (const char *path)
 {
@@ -344,6 +291,17 @@ is_dir (const char *path)
     return (S_ISDIR (sb.st_mode) ? 1 : 0);
 }
 
+/* Like 'is_dir()', but uses the type of a directory entry if the file system
+** supplies it (symbolic links are still followed) ...
+*/
+static int
+entry_is_dir (unsigned char type, const char *path)
+{
+    if (type == DT_DIR) { return 1; }
+    if (type == DT_UNKNOWN || type == DT_LNK) { return is_dir (path); }
+    return 0;
+}
+
 static int
 qcommand (const char *cmd, const char *outto)
 {
@@ -376,217 +334,149 @@ qcommand (const char *cmd, const char *outto)
     return wst;
 }
 
-static const char *word_class = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ_"
-				"abcdefghijklmnopqrstuvwxyz";
-static const char *digit_class = "0123456789";
-static const char *blank_class = "\t\n\f\r ";
+/* The exclude rules (interpreted by the exclude engine 'lib/exclude.c',
+** which is shared with 'exclude_list'): the program itself, the rules of the
+** exclude file, those of the hard-coded file 'admin/excludes' and the ones
+** added by 'gen_srcdist()'. The rules are compiled only when they are needed
+** (and then kept in the cache file given with '-C', if any) ...
+*/
+#define MAXSOURCES 16
 
-static int
-put_class (int class_type, int *_qmode, char **_buf, size_t *_bufsz)
-{
-    const char *pfx, *x_class;
-    char buf[10];
-    if (!*_qmode) {
-	switch (class_type) {
-	    case 's': pfx = "["; x_class = blank_class; break;
-	    case 'S': pfx = "[^"; x_class = blank_class; break;
-	    case 'd': pfx = "["; x_class = digit_class; break;
-	    case 'D': pfx = "[^"; x_class = digit_class; break;
-	    case 'w': pfx = "[", x_class = word_class; break;
-	    case 'W': pfx = "[^", x_class = word_class; break;
-	    case 'Q': *_qmode = 1; return 0;
-	    default:  goto ESCAPED_CHAR;
-	}
-	buf_puts (pfx, strlen (pfx), _buf, _bufsz);
-	buf_puts (x_class, strlen (x_class), _buf, _bufsz);
-	buf_puts ("]", 1, _buf,_bufsz);
-	return 1;
-    }
-    if (class_type == 'E') { *_qmode = 0; return 0; }
-ESCAPED_CHAR:
-    sprintf (buf, "\\%c", class_type);
-    buf_puts (buf, strlen (buf), _buf, _bufsz);
-    return 0;
-}
+struct excl_spec {
+    struct ex_source src[MAXSOURCES];
+    size_t nsrc;
+    const char *cachefile;
+};
+
+/* The exclude files in the sub-directories (with the same name as the
+** exclude file) are compiled during the walk through the tree. The rules of
+** such a file apply only to the pathnames below its directory, which are
+** matched relative to this directory (e.g. 'sub/x' as './x' by the rules of
+** 'sub/.srcdist-excludes'). The scopes of the directories above the current
+** one are linked through 'up' ...
+*/
+static const char *dir_excludes = NULL;
+
+struct excl_scope {
+    struct exclude ex;
+    size_t dirlen;
+    const struct excl_scope *up;
+};
 
 static void
-put_special (char special, int qmode, char **_buf, size_t *_bufsz)
+add_source (struct excl_spec *xs, const char *path, const char *rule)
 {
-    const char *cf = (qmode ? "\\%c" : "%c");
-    char buf[10];
-    sprintf (buf, cf, special);
-    buf_puts (buf, strlen (buf), _buf, _bufsz);
+    if (xs->nsrc >= MAXSOURCES) { error (1, "too many exclude rules"); }
+    xs->src[xs->nsrc].path = path;
+    xs->src[xs->nsrc].rule = (rule ? x_strdup (rule) : NULL);
+    ++xs->nsrc;
 }
 
+/* Add the rule 'pfx' + 'path' (with the prefix './' inserted if 'path' is a
+** relative pathname) ...
+*/
 static void
-unquote_rx (const char *regex_un, char **_buf, size_t *_bufsz)
+add_path_rule (struct excl_spec *xs, const char *pfx, const char *path)
 {
-    char cc;
-    int qmode = 0;
-    while ((cc = *regex_un++)) {
-	switch ((int) cc & 0xFF) {
-	    case '\\':
-		if (*regex_un) {
-		    cc = *regex_un++;
-		    put_class ((int) cc & 0xFF, &qmode, _buf, _bufsz);
-		} else {
-		    buf_puts (ccharp (cc), 1, _buf, _bufsz);
-		}
-		break;
-	    case '(': case ')': case '[': case ']': case '{': case '}':
-	    case '*': case '+': case '?': case '|': case '^': case '$':
-	    case '.':
-		put_special ((int) cc & 0xFF, qmode, _buf, _bufsz);
-		break;
-	    default:
-		buf_puts (ccharp (cc), 1, _buf, _bufsz);
-		break;
-	}
+    char *buf = NULL;
+    size_t bufsz = 0;
+    buf_clear (&buf, &bufsz);
+    buf_puts (pfx, strlen (pfx), &buf, &bufsz);
+    if (*path != '/' && strncmp (path, "./", 2) != 0
+    &&  strncmp (path, "../", 3) != 0) {
+	buf_puts ("./", 2, &buf, &bufsz);
     }
+    buf_puts (path, strlen (path), &buf, &bufsz);
+    add_source (xs, NULL, buf);
+    buf_delete (&buf, &bufsz);
 }
 
 static void
-quote_rx (const char *s, char **_buf, size_t *_bufsz)
+add_exclude_file (struct excl_spec *xs, const char *filename, int quiet)
 {
-    while (*s) {
-	switch (*s) {
-	    case '(': case ')': case '[': case ']': case '{': case '}':
-	    case '*': case '+': case '?': case '|': case '^': case '$':
-	    case '.': case '\\':
-		buf_puts ("\\", 1, _buf, _bufsz);
-		break;
-	    default:
-		break;
-	}
-	buf_puts (s++, 1, _buf, _bufsz);
+    if (!quiet && access (filename, R_OK)) {
+	fprintf (stderr, "WARNING! %s - %s\n", filename, strerror (errno));
     }
+    add_source (xs, filename, NULL);
 }
 
-typedef struct rxlist_s *rxlist_t;
-struct rxlist_s {
-    rxlist_t next;
-    regex_t rx;
-    char s[1];
-};
+static void
+init_excludes (struct excl_spec *xs, const char *filename, int quiet,
+	       const char *cachefile)
+{
+    xs->nsrc = 0; xs->cachefile = cachefile;
+    /* Start the exclude-list with the program's name ... */
+    add_path_rule (xs, "!", progpath);
+    /* ... and the cache file (which may reside in the source tree) ... */
+    if (cachefile) { add_path_rule (xs, "!!", cachefile); }
+    /* Add the filename-patterns from the supplied exclude-file ... */
+    add_exclude_file (xs, filename, quiet);
+    /* Add the filename-patterns from a hard-coded file, too ... */
+    add_exclude_file (xs, "admin/excludes", quiet);
+    /* The exclude files of the sub-directories have the same name ... */
+    dir_excludes = strrchr (filename, '/');
+    dir_excludes = (dir_excludes ? dir_excludes + 1 : filename);
+}
 
-static int
-append_regex (const char *regex, rxlist_t *_first, rxlist_t *_last)
+static void
+open_excludes (struct excl_spec *xs, struct exclude *ex)
 {
-    int rc;
-    char errbuf[1024];
-    rxlist_t el = t_allocp (struct rxlist_s, strlen (regex));
-    if (!el) { error (1, "%s - %s\n", regex, strerror (errno)); }
-    if ((rc = regcomp (&el->rx, regex, REG_EXTENDED|REG_NOSUB))) {
-	regerror (rc, &el->rx, errbuf, sizeof (errbuf));
-	eprintf ("%s - %s\n", regex, errbuf);
-	rc = -1;
-    } else {
-	strcpy (el->s, regex);
-	el->next = 0;
-	if (!*_first) {
-	    *_first = *_last = el;
-	} else {
-	    (*_last)->next = el; *_last = el;
-	}
-	rc = 0;
+    if (ex_open (ex, xs->cachefile, xs->nsrc, xs->src)) {
+	error (1, "%s", (errno == EINVAL && *ex->errmsg
+			 ? ex->errmsg : strerror (errno)));
+    }
+    if (ex->cache_errno) {
+	eprintf ("WARNING! %s - %s", xs->cachefile,
+		 strerror (ex->cache_errno));
     }
-    return rc;
 }
 
+/* Open the scope of the directory 'dir' (below the scope 'up'), returning 1
+** if 'dir' has an exclude file, 0 if it has none and -1 on failure ...
+*/
 static int
-add_pattern (const char *p, rxlist_t *_first, rxlist_t *_last,
-	     char **_buf, size_t *_bufsz)
+open_scope (struct excl_scope *sc, const char *dir,
+	    const struct excl_scope *up)
 {
-    buf_clear (_buf, _bufsz);
-    if (*p == '~') {
-	/* Regular expression match */
-	/*buf_puts ("^(", 2, _buf, _bufsz);*/
-	unquote_rx (++p, _buf, _bufsz);
-	/*buf_puts (")$", 2, _buf, _bufsz);*/
-    } else if (*p == '!') {
-	/* A (sub-)string match */
-	++p; if (*p == '!') {
-	    /* Exact match */
-	    buf_puts ("^(", 2, _buf, _bufsz);
-	    quote_rx (++p, _buf, _bufsz);
-	    buf_puts (")$", 2, _buf, _bufsz);
-	} else if (*p == '$') {
-	    /* End of string match */
-	    buf_puts ("(", 1, _buf, _bufsz);
-	    quote_rx (++p, _buf, _bufsz);
-	    buf_puts (")$", 2, _buf, _bufsz);
-	} else if (*p == '^') {
-	    /* Begin of string match */
-	    buf_puts ("^(", 2, _buf, _bufsz);
-	    quote_rx (++p, _buf, _bufsz);
-	    buf_puts (")", 1, _buf, _bufsz);
+    struct ex_source src;
+    char *path = NULL;
+    size_t pathsz = 0;
+    int rc = 0;
+    buf_clear (&path, &pathsz);
+    buf_puts (dir, strlen (dir), &path, &pathsz);
+    buf_puts ("/", 1, &path, &pathsz);
+    buf_puts (dir_excludes, strlen (dir_excludes), &path, &pathsz);
+    if (access (path, F_OK) == 0) {
+	src.path = path; src.rule = NULL;
+	if (ex_open (&sc->ex, NULL, 1, &src)) {
+	    eprintf ("%s - %s", path,
+		     (errno == EINVAL && *sc->ex.errmsg
+		      ? sc->ex.errmsg : strerror (errno)));
+	    rc = -1;
 	} else {
-	    /* Sub-string match (default after '!') */
-	    if (*p == ':') { ++p; }
-	    buf_puts ("(", 1, _buf, _bufsz);
-	    quote_rx (p, _buf, _bufsz);
-	    buf_puts (")", 1, _buf, _bufsz);
-	}
-    } else {
-	/* Shell-alike wildcard match */
-	if (*p == ':') { ++p; }
-	buf_puts ("^(", 2, _buf, _bufsz);
-	if (*p != '/' && strncmp (p, "./", 2) != 0
-	&&  strncmp (p, "../", 3) != 0) {
-	    conv_path ("./", 2, _buf, _bufsz);
+	    sc->dirlen = strlen (dir); sc->up = up;
+	    rc = 1;
 	}
-	conv_path(p, strlen (p), _buf, _bufsz);
-	buf_puts (")$", 2, _buf, _bufsz);
     }
-    return append_regex (*_buf, _first, _last);
+    buf_delete (&path, &pathsz);
+    return rc;
 }
 
+/* Check 'path' against the global rules 'excl' and then against the rules
+** of each scope from 'sc' upwards ...
+*/
 static int
-load_pattern_list (const char *filename, int quiet, rxlist_t *_out)
+is_excluded (const struct exclude *excl, const struct excl_scope *sc,
+	     const char *path)
 {
-    int errcnt = 0;
-    FILE *file;
-    const char *fn;
-    char *line = 0, *buf = 0, *p;
-    size_t linesz = 0, bufsz = 0;
-    rxlist_t first = 0, last = 0;
-
-    /* Start the exclude-list with the program's name ... */
-    buf_clear (&buf, &bufsz);
-    if (*progpath != '/') { buf_puts ("./", 2, &buf, &bufsz); }
-    buf_puts ("!", 1, &buf, &bufsz);
-    buf_puts (progpath, strlen (progpath), &buf, &bufsz);
-    p = x_strdup (buf);
-    if (add_pattern (p, &first, &last, &buf, &bufsz) < 0) { ++errcnt; }
-    cfree (p);
-
-    /* Add the filename-patterns from the supplied exclude-file ... */
-    if ((file = fopen (filename, "rb"))) {
-	while (bgetline (file, line, linesz) >= 0) {
-	    p = line; while (isws (*p)) { ++p; }
-	    if (*p == '\0' || *p == '#') { continue; }
-	    if (add_pattern (p, &first, &last, &buf, &bufsz) < 0) { ++errcnt; }
+    size_t len = strlen (path);
+    if (ex_match (excl, path, len)) { return 1; }
+    for (; sc; sc = sc->up) {
+	if (ex_match (&sc->ex, path + sc->dirlen + 1, len - sc->dirlen - 1)) {
+	    return 1;
 	}
-	fclose (file);
-    } else if (!quiet) {
-	fprintf (stderr, "WARNING! %s - %s\n", filename, strerror (errno));
-    }
-
-    /* Add the filename-patterns from a hard-coded file, too ... */
-    fn = "admin/excludes";
-    if ((file = fopen (fn, "rb"))) {
-	while (bgetline (file, line, linesz) >= 0) {
-	    p = line; while (isws (*p)) { ++p; }
-	    if (*p == '\0' || *p == '#') { continue; }
-	    if (add_pattern (p, &first, &last, &buf, &bufsz) < 0) { ++errcnt; }
-	}
-	fclose (file);
-    } else if (!quiet) {
-	fprintf (stderr, "WARNING! %s - %s\n", p, strerror (errno));
     }
-    cfree (line); cfree (buf);
-    *_out = first;
-    return (errcnt > 0 ? -1 : 0);
+    return 0;
 }
 
 static int
@@ -811,46 +701,13 @@ get_packdir (const char *packdir)
 	strcpy (p, vers);
 	cfree (wd); cfree (vers);
     } else {
-	res = t_check_allocv (char, strlen (packdir));
+	res = t_check_allocv (char, strlen (packdir) + 1);
 	strcpy (res, packdir);
     }
     return res;
 }
 
-/*#### list basetype plus removal function ####*/
-typedef struct list_s *list_t;
-struct list_s { list_t next; };
-
-static void
-distfile_list_free (list_t *_list)
-{
-    list_t lh;
-    while ((lh = *_list)) {
-	*_list = lh->next; lh->next = 0; free (lh);
-    }
-}
-#define list_free(l) (distfile_list_free ((list_t *) &(l)))
-/*#### end of list basetype plus removal function ####*/
-
 /*#### copy_tree #### */
-typedef struct sdlist_s *sdlist_t;
-struct sdlist_s {
-    sdlist_t next;
-    char *path;
-};
-
-static sdlist_t
-sdlist_add (sdlist_t sdlist, const char *sdpath)
-{
-    sdlist_t newit = t_allocv (struct sdlist_s, sizeof(struct sdlist_s) +
-					strlen (sdpath) + 1);
-    if (newit) {
-	newit->next = sdlist;
-	newit->path = (char *) newit + sizeof(struct sdlist_s);
-	strcpy (newit->path, sdpath);
-    }
-    return newit;
-}
 
 static void
 copy_xattrs (const char *src, const char *dst)
@@ -966,46 +823,43 @@ icopy_file (const char *src, const char *dst)
 }
 
 static int
-copy_tree (const char *srcdir, const char *dstdir, rxlist_t excl)
+copy_tree (const char *srcdir, const char *dstdir,
+	   const struct exclude *excl, const struct excl_scope *up)
 {
     char *spath = NULL, *dpath = NULL, *p;
     size_t spathsz = 0, dpathsz = 0;
-    struct dirent *de = NULL;
-    rxlist_t rx = NULL;
-    regmatch_t m_dummy[1];
-    int skip_entry = 0, ec;
-    sdlist_t sdlist = NULL, newsd;
-    DIR *dfp = opendir (srcdir);
-    if (!dfp) {
+    struct dirread dr;
+    struct dr_entry de;
+    int ec, rc;
+    struct strlist sdirs = STRLIST_INIT;
+    struct sl_item *sd;
+    struct excl_scope sc;
+    const struct excl_scope *scope = up;
+    /* (The exclude file of the top-level directory is the global one) */
+    if (strcmp (srcdir, ".") != 0) {
+	if ((rc = open_scope (&sc, srcdir, up)) < 0) { return -1; }
+	if (rc > 0) { scope = &sc; }
+    }
+    dr_init (&dr, 0);
+    if (dr_open (&dr, srcdir)) {
 	fprintf (stderr, "%s: attempt to read directory '%s' failed - %s\n",
 			 prog, srcdir, strerror (errno));
+	dr_free (&dr);
+	if (scope == &sc) { ex_free (&sc.ex); }
 	return -1;
     }
-    while ((de = readdir (dfp))) {
-	if (*de->d_name == '\0') { continue; }
-	if (*de->d_name == '.') {
-	    if (de->d_name[1] == '\0'
-	    ||  (de->d_name[1] == '.' && de->d_name[2] == '\0')) {
-		continue;
-	    }
-	}
-	skip_entry = 0;
+    while ((rc = dr_next (&dr, &de)) > 0) {
 	buf_clear (&spath, &spathsz);
 	buf_puts (srcdir, strlen (srcdir), &spath, &spathsz);
 	p = spath + strlen (spath);
 	while (--p != spath && *p == '/') { *p = '\0'; }
 	if (*p == '/') { *p = '\0'; }
 	buf_puts ("/", 1, &spath, &spathsz);
-	buf_puts (de->d_name, strlen (de->d_name), &spath, &spathsz);
-	for (rx = excl; rx; rx = rx->next) {
-	    if (regexec (&rx->rx, spath, 1, m_dummy, 0) == 0) {
-		skip_entry = 1; break;
-	    }
-	}
-	if (skip_entry) { continue; }
-	if (is_dir (spath)) {
-	    if (!(newsd = sdlist_add (sdlist, spath))) { goto ERROR; }
-	    sdlist = newsd; continue;
+	buf_puts (de.name, strlen (de.name), &spath, &spathsz);
+	if (is_excluded (excl, scope, spath)) { continue; }
+	if (entry_is_dir (de.type, spath)) {
+	    if (!sl_append (&sdirs, spath)) { goto ERROR; }
+	    continue;
 	}
 	buf_clear (&dpath, &dpathsz);
 	buf_puts (dstdir, strlen (dstdir), &dpath, &dpathsz);
@@ -1016,34 +870,36 @@ copy_tree (const char *srcdir, const char *dstdir, rxlist_t excl)
 	buf_puts (spath, strlen (spath), &dpath, &dpathsz);
 	if (icopy_file (spath, dpath) < 0) { goto ERROR; }
     }
-    closedir (dfp); dfp = NULL;
+    if (rc < 0) { goto ERROR; }
+    dr_free (&dr);
     buf_delete (&spath, &spathsz);
     /* create the sub-directories and call copy_tree() with each of them
     ** recursively ...
     */
-    for (newsd = sdlist; newsd; newsd = sdlist) {
-	sdlist = newsd->next;
+    for (sd = sdirs.first; sd; sd = sd->next) {
 	buf_clear (&dpath, &dpathsz);
 	buf_puts (dstdir, strlen (dstdir), &dpath, &dpathsz);
 	p = dpath + strlen (dpath);
 	while (p != dpath && *--p == '/') { *p = '\0'; }
 	if (*p == '/') { *p = '\0'; }
-	if (*newsd->path != '/') { buf_puts ("/", 1, &dpath, &dpathsz); }
-	buf_puts (newsd->path, strlen (newsd->path), &dpath, &dpathsz);
+	if (*sd->str != '/') { buf_puts ("/", 1, &dpath, &dpathsz); }
+	buf_puts (sd->str, strlen (sd->str), &dpath, &dpathsz);
 	if (mkdir (dpath, 0755) < 0) { goto ERROR; }
 	if (chmod (dpath, 0755) < 0) { goto ERROR; }
-	if (copy_tree (newsd->path, dstdir, excl) < 0) { goto ERROR; }
-	fix_perms (newsd->path, dpath);
-	cfree (newsd);
+	if (copy_tree (sd->str, dstdir, excl, scope) < 0) { goto ERROR; }
+	fix_perms (sd->str, dpath);
     }
+    sl_free (&sdirs);
     buf_delete (&dpath, &dpathsz);
+    if (scope == &sc) { ex_free (&sc.ex); }
     return 0;
 ERROR:
     ec = errno;
-    if (dfp) { closedir (dfp); dfp = NULL; }
-    list_free (sdlist);
+    dr_free (&dr);
+    sl_free (&sdirs);
     buf_delete (&spath, &spathsz);
     buf_delete (&dpath, &dpathsz);
+    if (scope == &sc) { ex_free (&sc.ex); }
     errno = ec;
     return -1;
 }
@@ -1209,47 +1065,43 @@ remove_tree (const char *dir, char **_buf, size_t *_bufsz)
 {
     int rc;
     char *path = NULL, *p;
-    sdlist_t sdlist = NULL, newsd;
-    DIR *dfp = opendir (dir);
-    struct dirent *de = NULL;
-    if (!dfp) {
+    struct strlist sdirs = STRLIST_INIT;
+    struct sl_item *sd;
+    struct dirread dr;
+    struct dr_entry de;
+    dr_init (&dr, 0);
+    if (dr_open (&dr, dir)) {
 	eprintf ("attempt to read directory '%s' failed - %s",
 		 dir, strerror (errno));
+	dr_free (&dr);
 	return -1;
     }
-    while ((de = readdir (dfp))) {
-	if (*de->d_name == '\0') { continue; }
-	if (*de->d_name == '.') {
-	    if (de->d_name[1] == '\0'
-	    ||  (de->d_name[1] == '.' && de->d_name[2] == '\0')) {
-		continue;
-	    }
-	}
+    while ((rc = dr_next (&dr, &de)) > 0) {
 	buf_clear (_buf, _bufsz);
 	buf_puts (dir, strlen (dir), _buf, _bufsz);
 	p = *_buf + strlen (*_buf);
 	while (--p != path && *p == '/') { *p = '\0'; }
 	if (*p == '/') { *p = '\0'; }
 	buf_puts ("/", 1, _buf, _bufsz);
-	buf_puts (de->d_name, strlen (de->d_name), _buf, _bufsz);
+	buf_puts (de.name, strlen (de.name), _buf, _bufsz);
 	p = *_buf;
-	if (is_dir (p)) {
-	    if (!(newsd = sdlist_add (sdlist, p))) { goto ERROR; }
-	    sdlist = newsd; continue;
+	if (entry_is_dir (de.type, p)) {
+	    if (!sl_append (&sdirs, p)) { goto ERROR; }
+	    continue;
 	}
 	if (unlink (p)) { goto ERROR; }
     }
-    closedir (dfp); dfp = NULL;
-    for (newsd = sdlist; newsd; newsd = sdlist) {
-	sdlist = newsd->next;
-	if (remove_tree (newsd->path, _buf, _bufsz)) { goto ERROR; }
-	cfree (newsd);
+    if (rc < 0) { goto ERROR; }
+    dr_free (&dr);
+    for (sd = sdirs.first; sd; sd = sd->next) {
+	if (remove_tree (sd->str, _buf, _bufsz)) { goto ERROR; }
     }
+    sl_free (&sdirs);
     return rmdir (dir);
 ERROR:
     rc = errno;
-    if (dfp) { closedir (dfp); dfp = NULL; }
-    list_free (sdlist);
+    dr_free (&dr);
+    sl_free (&sdirs);
     errno = rc;
     return -1;
 }
@@ -1323,7 +1175,7 @@ get_packagename (const char *packcmd,
 /*#### gen_srcdist ####*/
 
 /* Generate a source-archive using all files in the current source-tree which
-** match none of the regular expressions in 'exclude_pats'; the commands for
+** match none of the exclude rules of 'xs'; the commands for
 ** generating the archive are generated from the templates 'cleanupcmd'
 ** (issuing a cleanup in the temporary directory created for generating the
 ** archive) and 'packcmd' (the commands which really generate the requested
@@ -1334,7 +1186,7 @@ get_packagename (const char *packcmd,
 ** ...
 */
 static int
-gen_srcdist (rxlist_t exclude_pats,
+gen_srcdist (struct excl_spec *xs,
 	     const char *cleanupcmd,
 	     const char *packcmd,
 	     const char *suffix,
@@ -1343,10 +1195,9 @@ gen_srcdist (rxlist_t exclude_pats,
 	     char **_package)
 {
     int rc;
-    char *packdir, *buf = NULL, *package = NULL, *packname = NULL;
-    size_t bufsz = 0;
-    const char *cluptpl = NULL, *packtpl = NULL, *t;
-    rxlist_t last_pat = 0;
+    char *packdir, *package = NULL, *packname = NULL;
+    const char *cluptpl = NULL, *packtpl = NULL;
+    struct exclude ex;
     cluptpl = get_template ('c', cleanupcmd, ".cleanupcmds",
 			    "admin/cleanupcmds", def_cluptpls);
     if (!cluptpl) { eprintf ("no template for cleaning up found"); return -1; }
@@ -1358,29 +1209,27 @@ gen_srcdist (rxlist_t exclude_pats,
 
     packdir = get_packdir (newdir);
 
+    /* The package directory and the administrative directories of some
+    ** version control systems are excluded, too. (The exclude rules are
+    ** compiled before the package directory is created, so an invalid rule
+    ** leaves nothing behind) ...
+    */
+    add_path_rule (xs, "!!", packdir);
+    add_source (xs, NULL, ".svn"); add_source (xs, NULL, "*/.svn");
+    add_source (xs, NULL, "CVS"); add_source (xs, NULL, "*/CVS");
+    open_excludes (xs, &ex);
+
     if (mkdir (packdir, 0755)) { //  && errno != EEXIST) {
 	error (1, "%s - %s\n", packdir, strerror (errno));
     }
-
-    if ((last_pat = exclude_pats)) {
-	while (last_pat->next) { last_pat = last_pat->next; }
-    }
-    if (add_pattern (packdir, &exclude_pats, &last_pat, &buf, &bufsz) < 0) {
-	error (1, "adding '%s' to exclude-list failed - %s\n",
-		  packdir, strerror (errno));
-    }
-    t = "~^(\\./(.*/)?(\\.svn|CVS))$";
-    if (add_pattern (t, &exclude_pats, &last_pat, &buf, &bufsz) < 0) {
-	error (1, "adding '%s' to exclude-list failed - %s\n",
-		  t+1, strerror (errno));
-    }
     /* "Intelligentes" Kopieren der Daten aus dem aktuellen Verzeichnis in
     ** das zu packende Zielverzeichnis. Die Dateien werden nach Möglichkeit
     ** nur referentiell kopiert ('link()'). Nur wenn das nicht funktioniert
     ** werden die Dateien physisch kopiert ...
     */
     rc = -1;
-    rc = copy_tree (".", packdir, exclude_pats);
+    rc = copy_tree (".", packdir, &ex, NULL);
+    ex_free (&ex);
     if (!rc) {
 	/* Nun wird im Zielverzeichnis aufgeräumt ... */
 	rc = cleanup (packdir, cluptpl, quiet);
@@ -1423,54 +1272,40 @@ cwd (void)
 }
 /*#### end cwd ####*/
 
-typedef struct flist_s *flist_t;
-struct flist_s {
-    flist_t next;
-    int is_dir;
-    char path[1];
-};
-
-/*#### flist_add ####*/
-static flist_t
-flist_add (flist_t fl, const char *path, int is_dir)
-{
-    flist_t newfl = t_allocp (struct flist_s, strlen (path) + 1);
-    if (newfl) {
-	newfl->next = fl;
-	newfl->is_dir = is_dir;
-	strcpy (newfl->path, path);
-    }
-    return newfl;
-}
-/*#### end flist_add ####*/
+/* The excluded files/directories are collected in a 'struct strlist' whose
+** element flags are FL_DIR for directories ...
+*/
+#define FL_DIR 1
 
 /*#### collect_excludes ####*/
 static int
-collect_excludes (const char *dir, rxlist_t excl, flist_t *_xl,
-		  char **_buf, size_t *_bufsz)
+collect_excludes (const char *dir, const struct exclude *excl,
+		  const struct excl_scope *up,
+		  struct strlist *xl, char **_buf, size_t *_bufsz)
 {
-    int ec;
+    int ec, rc, isdir;
     char *p;
-    struct dirent *de = NULL;
-    regmatch_t m_dummy[1];
+    struct dirread dr;
+    struct dr_entry de;
     int do_exclude = 0;
-    rxlist_t rx;
-    flist_t nxl;
-    sdlist_t sdlist = NULL, newsd;
-    DIR *dfp = opendir (dir);
-    if (!dfp) {
+    struct sl_item *nxl;
+    struct strlist sdirs = STRLIST_INIT;
+    struct sl_item *sd;
+    struct excl_scope sc;
+    const struct excl_scope *scope = up;
+    if (strcmp (dir, ".") != 0) {
+	if ((rc = open_scope (&sc, dir, up)) < 0) { return -1; }
+	if (rc > 0) { scope = &sc; }
+    }
+    dr_init (&dr, 0);
+    if (dr_open (&dr, dir)) {
 	eprintf ("attempt to read directory '%s' failed - %s\n",
 		 dir, strerror (errno));
+	dr_free (&dr);
+	if (scope == &sc) { ex_free (&sc.ex); }
 	return -1;
     }
-    while ((de = readdir (dfp))) {
-	if (*de->d_name == '\0') { continue; }
-	if (*de->d_name == '.') {
-	    if (de->d_name[1] == '\0'
-	    ||  (de->d_name[1] == '.' && de->d_name[2] == '\0')) {
-		continue;
-	    }
-	}
+    while ((rc = dr_next (&dr, &de)) > 0) {
 	do_exclude = 0;
 	buf_clear (_buf, _bufsz);
 	buf_puts (dir, strlen (dir), _buf, _bufsz);
@@ -1478,39 +1313,38 @@ collect_excludes (const char *dir, rxlist_t excl, flist_t *_xl,
 	while (--p != *_buf && *p == '/') { *p = '\0'; }
 	if (*p == '/') { *p = '\0'; }
 	buf_puts ("/", 1, _buf, _bufsz);
-	buf_puts (de->d_name, strlen (de->d_name), _buf, _bufsz);
+	buf_puts (de.name, strlen (de.name), _buf, _bufsz);
 	p = *_buf;
-	for (rx = excl; rx; rx = rx->next) {
-	    if (regexec (&rx->rx, p, 1, m_dummy, 0) == 0) {
-		do_exclude = 1; break;
-	    }
-	}
+	do_exclude = is_excluded (excl, scope, p);
+	isdir = entry_is_dir (de.type, p);
 	if (do_exclude) {
-	    if (!(nxl = flist_add (*_xl, p, is_dir (p)))) { goto ERROR; }
-	    *_xl = nxl;
+	    if (!(nxl = sl_append (xl, p))) { goto ERROR; }
+	    if (isdir) { nxl->flags = FL_DIR; }
 	    continue;
 	}
-	if (is_dir (p)) {
-	    if (!(newsd = sdlist_add (sdlist, p))) { goto ERROR; }
-	    sdlist = newsd; continue;
+	if (isdir) {
+	    if (!sl_append (&sdirs, p)) { goto ERROR; }
+	    continue;
 	}
     }
-    closedir (dfp); dfp = NULL;
+    if (rc < 0) { goto ERROR; }
+    dr_free (&dr);
     /* create the sub-directories and call copy_tree() with each of them
     ** recursively ...
     */
-    for (newsd = sdlist; newsd; newsd = sdlist) {
-	sdlist = newsd->next;
-	if (collect_excludes (newsd->path, excl, _xl, _buf, _bufsz)) {
+    for (sd = sdirs.first; sd; sd = sd->next) {
+	if (collect_excludes (sd->str, excl, scope, xl, _buf, _bufsz)) {
 	    goto ERROR;
 	}
-	cfree (newsd);
     }
+    sl_free (&sdirs);
+    if (scope == &sc) { ex_free (&sc.ex); }
     return 0;
 ERROR:
     ec = errno;
-    if (dfp) { closedir (dfp); dfp = NULL; }
-    list_free (sdlist);
+    dr_free (&dr);
+    sl_free (&sdirs);
+    if (scope == &sc) { ex_free (&sc.ex); }
     errno = ec;
     return -1;
 }
@@ -1518,32 +1352,33 @@ ERROR:
 
 /*#### exclude_binaries ####*/
 static int
-exclude_binaries (const char *packdir, rxlist_t exclude_pats)
+exclude_binaries (const char *packdir, const struct exclude *excl)
 {
     int rc, ec;
     const char *oldwd;
     char *pbuf = NULL;
     size_t pbufsz = 0;
-    flist_t fl = NULL, lh;
+    struct strlist fl = STRLIST_INIT;
+    struct sl_item *lh;
     if (!(oldwd = cwd ())) { return -1; }
     if (chdir (packdir)) { return -1; }
     buf_clear (&pbuf, &pbufsz);
-    rc = collect_excludes (".", exclude_pats, &fl, &pbuf, &pbufsz);
+    rc = collect_excludes (".", excl, NULL, &fl, &pbuf, &pbufsz);
     if (rc) { goto ERROR; }
-    while ((lh = fl)) {
-	fl = lh->next;
-	if (lh->is_dir) {
-	    rc = remove_tree (lh->path, &pbuf, &pbufsz);
+    for (lh = fl.first; lh; lh = lh->next) {
+	if (lh->flags & FL_DIR) {
+	    rc = remove_tree (lh->str, &pbuf, &pbufsz);
 	} else {
-	    rc = unlink (lh->path);
+	    rc = unlink (lh->str);
 	}
-	free (lh); if (rc) { goto ERROR; }
+	if (rc) { goto ERROR; }
     }
+    sl_free (&fl);
     buf_delete (&pbuf, &pbufsz);
     return chdir (oldwd);
 ERROR:
     ec = errno;
-    list_free (fl);
+    sl_free (&fl);
     buf_delete (&pbuf, &pbufsz);
     chdir (oldwd);
     errno = ec;
@@ -1553,7 +1388,7 @@ ERROR:
 
 /*#### gen_bindist ####*/
 static int
-gen_bindist (rxlist_t exclude_pats,
+gen_bindist (struct excl_spec *xs,
 	     const char *instcmd, const char *packcmd,
 	     const char *instpfx, const char *suffix,
 	     const char *newdir, int quiet,
@@ -1564,6 +1399,7 @@ gen_bindist (rxlist_t exclude_pats,
     char *packdir = NULL, *cmd = NULL, *package = NULL;
     size_t cmdsz = 0;
     struct rplc_struct r1[5];
+    struct exclude ex;
 
     insttpl = get_template ('c', instcmd, ".installcmds", "admin/installcmds",
 			    def_insttpls);
@@ -1579,6 +1415,10 @@ gen_bindist (rxlist_t exclude_pats,
 
     packdir = get_packdir (newdir);
 
+    /* (The exclude rules are compiled before the package directory is
+    ** created, so an invalid rule leaves nothing behind) */
+    open_excludes (xs, &ex);
+
     if (mkdir (packdir, 0755)) {
 	error (1, "%s - %s\n", packdir, strerror (errno));
     }
@@ -1592,9 +1432,12 @@ gen_bindist (rxlist_t exclude_pats,
     rc = qcommand (cmd, (quiet ? "/dev/null" : NULL));
 
     if (!rc) {
-	/* The cleanup-process which uses 'exclude_pats' is not ready yet ... */
-	rc = exclude_binaries (packdir, exclude_pats);
+	/* The cleanup-process which uses the exclude rules is not ready yet
+	** ...
+	*/
+	rc = exclude_binaries (packdir, &ex);
     }
+    ex_free (&ex);
 
     if (!rc) {
 	/* Nun wird das Archiv generiert ... */
@@ -1647,16 +1490,22 @@ int
 main (int argc, char *argv[])
 {
     int mode = -1, opt, quiet = 0, rc = 0, print_name = 0;
-    const char *exclude_file = 0;
+    const char *exclude_file = 0, *cachefile = NULL;
     char *mname, *instcmd = NULL, *packcmd = NULL, *newdir = NULL;
     char *pkgname = NULL, *clupcmd = NULL, *ipfx = NULL;
     const char *psfx = NULL;
-    rxlist_t exclude_pats = NULL;
+    struct excl_spec xs;
     store_progpath (argv);
     if (argc < 2) { usage (NULL); }
-    /* get the '-c', '-h', '-i', '-n', '-p', '-q', '-V' and '-x' options */
-    while ((opt = getopt (argc, argv, "+c:hi:np:qVx:")) != -1) {
+    /* get the '-C', '-c', '-h', '-i', '-n', '-p', '-q', '-V' and '-x'
+    ** options
+    */
+    while ((opt = getopt (argc, argv, "+C:c:hi:np:qVx:")) != -1) {
 	switch (opt) {
+	    case 'C':	/* -C cachefile (e.g. -C .distfile-cache) */
+		if (cachefile) { usage ("ambiguous '-C'-option"); }
+		cachefile = x_strdup (optarg);
+		break;
 	    case 'c':	/* -c 'cleancmd-template' (e.g. -c 'make cleanall') */
 		if (clupcmd) { usage ("ambiguous '-c'-option"); }
 		clupcmd = x_strdup (optarg);
@@ -1700,9 +1549,7 @@ main (int argc, char *argv[])
     } else {
 	usage ("invalid mode; use a (prefix of) 'srcdist' or 'bindist'");
     }
-    if (load_pattern_list (exclude_file, quiet, &exclude_pats)) {
-	error (1, "errors found in '%s'", argv[1]);
-    }
+    init_excludes (&xs, exclude_file, quiet, cachefile);
     /* ... */
     switch (mode) {
 	case MODE_SRCDIST:
@@ -1714,7 +1561,7 @@ main (int argc, char *argv[])
 	    if (print_name) {
 		pkgname = get_packagename (packcmd, psfx, newdir);
 	    } else {
-		rc = gen_srcdist (exclude_pats, clupcmd, packcmd,
+		rc = gen_srcdist (&xs, clupcmd, packcmd,
 				  psfx, newdir, quiet, &pkgname);
 	    }
 	    break;
@@ -1728,7 +1575,7 @@ main (int argc, char *argv[])
 	    if (print_name) {
 		pkgname = get_packagename (packcmd, psfx, newdir);
 	    } else {
-		rc = gen_bindist (exclude_pats, instcmd, packcmd, ipfx,
+		rc = gen_bindist (&xs, instcmd, packcmd, ipfx,
 				  psfx, newdir, quiet, &pkgname);
 	    }
 	    break;
@@ -12,7 +12,22 @@
 ** as pathnames of files and converts them into a single regular
 ** expression suitable for the '-regex'-option of a 'find'-command
 ** ...
-** 
+**
+** Synopsis:
+**    exclude_list filename
+**    exclude_list compile [-C cachefile] [-r rule]... filename...
+**    exclude_list filter [-0] [-C cachefile] [-r rule]... [filename...]
+**
+** The subcommands 'compile' and 'filter' don't generate a regular expression
+** but compile the rules of the exclude files (and the rules given with '-r')
+** with the exclude engine of 'lib/exclude.c'. 'compile' writes the compiled
+** rules to 'cachefile' (default: the first 'filename' with the suffix
+** '.dfa'); 'filter' reads pathnames (separated by newlines or - with '-0' -
+** by NUL characters) from stdin and writes those which are not excluded to
+** stdout. With '-C cachefile', the compiled rules are loaded from 'cachefile'
+** (if it is up to date) instead of being compiled, or else compiled and
+** stored in 'cachefile'.
+**
 */
 #include <stdio.h>
 #include <stdlib.h>
@@ -30,10 +45,14 @@
 #include "lib/isws.c"
 #include "lib/cuteol.c"
 #include "lib/bgetline.c"
+#include "lib/exclude.c"
 
 static void usage (void)
 {
-    printf ("Usage: %s filename\n", prog);
+    printf ("Usage: %s filename\n"
+	    "       %s compile [-C cachefile] [-r rule]... filename...\n"
+	    "       %s filter [-0] [-C cachefile] [-r rule]... [filename...]\n",
+	    prog, prog, prog);
     exit (0);
 }
 
@@ -124,6 +143,141 @@ int is_dir (const char *path)
     return (S_ISDIR (sb.st_mode) ? 1 : 0);
 }
 
+/* THE NATIVE MODE. The rules are interpreted by the exclude engine which is
+** shared with 'distfile' ('lib/exclude.c'): besides the (glob) patterns of
+** the regex mode, the rules '!!string', '!$string', '!^string', '!string'
+** and '~regex' are understood. Each exclude file excludes itself, and each
+** pathname matched by a rule excludes everything below it, too.
+*/
+static void nomem (void)
+{
+    fprintf (stderr, "%s: %s\n", prog, strerror (errno));
+    exit (1);
+}
+
+static void out_flush (const char *buf, size_t len)
+{
+    ssize_t wr;
+    while (len > 0) {
+	if ((wr = write (1, buf, len)) < 0) {
+	    if (errno == EINTR) { continue; }
+	    fprintf (stderr, "%s: <stdout> - %s\n", prog, strerror (errno));
+	    exit (1);
+	}
+	buf += wr; len -= (size_t) wr;
+    }
+}
+
+#define FBUFSZ 65536
+
+/* Read the pathnames (separated by 'sep') from stdin and write the ones which
+** are not excluded to stdout ...
+*/
+static void filter_paths (const struct exclude *ex, int sep)
+{
+    char *ibuf, *obuf, *p, *q, *end;
+    size_t isz = FBUFSZ, ilen = 0, olen = 0, len;
+    ssize_t rd;
+    int eof = 0;
+    if (!(ibuf = t_allocv (char, isz)) || !(obuf = t_allocv (char, FBUFSZ))) {
+	nomem ();
+    }
+    while (! eof) {
+	if ((rd = read (0, ibuf + ilen, isz - ilen)) < 0) {
+	    if (errno == EINTR) { continue; }
+	    fprintf (stderr, "%s: <stdin> - %s\n", prog, strerror (errno));
+	    exit (1);
+	}
+	if (rd == 0) { eof = 1; }
+	ilen += (size_t) rd;
+	p = ibuf; end = ibuf + ilen;
+	for (;;) {
+	    if (!(q = memchr (p, sep, (size_t) (end - p)))) {
+		if (! eof || p >= end) { break; }
+		q = end;
+	    }
+	    len = (size_t) (q - p);
+	    if (len > 0 && ! ex_match (ex, p, len)) {
+		if (olen + len + 1 > FBUFSZ) {
+		    out_flush (obuf, olen); olen = 0;
+		}
+		if (len + 1 > FBUFSZ) {
+		    out_flush (p, len); out_flush ((char *) &sep, 1);
+		} else {
+		    memcpy (obuf + olen, p, len); olen += len;
+		    obuf[olen++] = (char) sep;
+		}
+	    }
+	    p = q + (q < end ? 1 : 0);
+	}
+	/* (The incomplete last pathname is moved to the beginning of the
+	** buffer, which is enlarged if it is filled by this pathname) */
+	ilen = (size_t) (end - p);
+	if (ilen > 0 && p > ibuf) { memmove (ibuf, p, ilen); }
+	if (ilen >= isz) {
+	    isz *= 2;
+	    if (!(p = t_realloc (char, ibuf, isz))) { nomem (); }
+	    ibuf = p;
+	}
+    }
+    out_flush (obuf, olen);
+    free (ibuf); free (obuf);
+}
+
+static int native_mode (int argc, char *argv[])
+{
+    const char *cmd = argv[1], *cachefile = NULL, *p;
+    char *dfafile = NULL, *rule;
+    struct ex_source *src;
+    struct exclude ex;
+    size_t nsrc = 0;
+    int optx = 2, sep = '\n', compile = !strcmp (cmd, "compile"), rel;
+    if (!(src = t_allocv (struct ex_source, 2 * argc))) { nomem (); }
+    for (; optx < argc && *argv[optx] == '-'; ++optx) {
+	if (!strcmp (argv[optx], "--")) { ++optx; break; }
+	if (!strcmp (argv[optx], "-0") && ! compile) {
+	    sep = '\0';
+	} else if (!strcmp (argv[optx], "-C") && optx + 1 < argc) {
+	    cachefile = argv[++optx];
+	} else if (!strcmp (argv[optx], "-r") && optx + 1 < argc) {
+	    src[nsrc].path = NULL; src[nsrc++].rule = argv[++optx];
+	} else {
+	    fprintf (stderr, "%s: invalid option '%s'\n", prog, argv[optx]);
+	    exit (64);
+	}
+    }
+    if (optx >= argc && (compile || nsrc == 0)) { usage (); }
+    if (compile && ! cachefile) {
+	p = argv[optx];
+	if (!(dfafile = t_allocv (char, strlen (p) + 5))) { nomem (); }
+	strcpy (dfafile, p); strcat (dfafile, ".dfa");
+	cachefile = dfafile;
+    }
+    for (; optx < argc; ++optx) {
+	/* (Each exclude file excludes itself) */
+	p = argv[optx];
+	rel = (*p != '/' && strncmp (p, "./", 2) != 0
+	       && strncmp (p, "../", 3) != 0);
+	if (!(rule = t_allocv (char, strlen (p) + 5))) { nomem (); }
+	strcpy (rule, (rel ? "!!./" : "!!")); strcat (rule, p);
+	src[nsrc].path = NULL; src[nsrc++].rule = rule;
+	src[nsrc].path = p; src[nsrc++].rule = NULL;
+    }
+    if (ex_open (&ex, cachefile, nsrc, src)) {
+	fprintf (stderr, "%s: %s\n", prog,
+		 (errno == EINVAL && *ex.errmsg ? ex.errmsg : strerror (errno)));
+	exit (1);
+    }
+    if (ex.cache_errno) {
+	fprintf (stderr, "%s: %s - %s\n", prog, cachefile,
+		 strerror (ex.cache_errno));
+	if (compile) { exit (1); }
+    }
+    if (! compile) { filter_paths (&ex, sep); }
+    ex_free (&ex); cfree (dfafile);
+    return 0;
+}
+
 int main (int argc, char *argv[])
 {
     char *line = 0, *rx = 0, *p, *q;
@@ -131,6 +285,10 @@ int main (int argc, char *argv[])
     FILE *file;
     store_prog (argv);
     if (argc < 2) { usage (); }
+    if (argc > 2 && (!strcmp (argv[1], "compile")
+		 ||  !strcmp (argv[1], "filter"))) {
+	return native_mode (argc, argv);
+    }
     p = argv[1];
     if (!(file = fopen (p, "rb"))) {
 	fprintf (stderr, "%s: %s - %s\n", prog, p, strerror (errno));
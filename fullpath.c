@@ -27,11 +27,11 @@
 #include "lib/set_prog.c"
 #include "lib/cwd.c"
 #include "lib/check_ptr.c"
-#include "lib/bconc.c"
 /*#include "lib/sdup.c"*/
 #include "lib/puteol.c"
 #include "lib/bwhich.c"
 #include "lib/trans_path.c"
+#include "lib/trans_paths.c"
 
 static void usage (const char *format, ...)
 {
@@ -52,11 +52,11 @@ static void usage (const char *format, ...)
 
 int main (int argc, char *argv[])
 {
-    int opt, level = 0, ix, errcc = 0, newitem, dots, lastch, use_path = 0;
+    int opt, level = 0, lv, ix, errcc = 0, use_path = 0, npaths;
     unsigned long v;
-    const char *wd;
-    char *p, *q, *buf = NULL, *ep, *sp, *path;
-    size_t bufsz = 0;
+    const char *wd, **paths;
+    char *p, *buf = NULL, *sp, *path, *wbuf = NULL, *found;
+    size_t bufsz = 0, wbufsz = 0, *offsets;
 
     set_prog (argc, argv);
     while ((opt = getopt (argc, argv, ":b:hp")) != -1) {
@@ -82,28 +82,52 @@ int main (int argc, char *argv[])
 
     if (optind >= argc) { usage ("missing argument(s)"); }
 
+    /* Normalize all pathnames in one go (relative to the current working
+    ** directory); with '-p', a simple command name is looked up in PATH
+    ** first ...
+    */
     wd = cwd ();
-    for (ix = optind; ix < argc; ++ix) {
-	if (*(path = argv[ix]) == '/') {
-	    p = bconc (buf, bufsz, path);
-	} else if (use_path && !strchr (path, '/')) {
-	    p = bwhich (buf, bufsz, path);
-	} else {
-	    p = bconc (buf, bufsz, wd, "/", path);
+    npaths = argc - optind;
+    paths = t_allocv (const char *, npaths); check_ptr ("main", paths);
+    offsets = t_allocv (size_t, npaths); check_ptr ("main", offsets);
+    found = t_allocv (char, npaths); check_ptr ("main", found);
+    for (ix = 0; ix < npaths; ++ix) {
+	path = argv[optind + ix]; found[ix] = 1;
+	if (use_path && *path != '/' && !strchr (path, '/')) {
+	    /* (A name not found in PATH is reported in the output loop, so
+	    ** the results of the other arguments are still written) */
+	    if ((p = bwhich (wbuf, wbufsz, path))) {
+		path = strdup (p); check_ptr ("main", path);
+	    } else {
+		found[ix] = 0;
+	    }
 	}
-	check_ptr ("main", p);
-	if (trans_path (p, p)) {
-	    fprintf (stderr, "%s: '%s' - invalid\n", prog, p);
+	paths[ix] = path;
+    }
+    if (trans_paths (wd, (size_t) npaths, paths, &buf, &bufsz, offsets)) {
+	check_ptr ("main", NULL);
+    }
+    for (ix = 0; ix < npaths; ++ix) {
+	if (! found[ix]) {
+	    fprintf (stderr, "%s: '%s' - not found\n", prog, paths[ix]);
 	    ++errcc; continue;
 	}
-	sp = p; p += strlen (p);
-	while (level > 0) {
-	    --level; if (p == sp) { level = 0; break; }
+	if (offsets[ix] == TP_INVALID) {
+	    fprintf (stderr, "%s: '%s' - invalid\n", prog, paths[ix]);
+	    ++errcc; continue;
+	}
+	sp = buf + offsets[ix]; p = sp + strlen (sp);
+	for (lv = level; lv > 0; --lv) {
+	    if (p == sp) { break; }
 	    while (p > sp && *p != '/') { --p; }
 	    if (p > sp) { *p-- = '\0'; }
 	}
 	fputs (sp, stdout); puteol (stdout);
     }
-    free (buf);
+    for (ix = 0; ix < npaths; ++ix) {
+	if (paths[ix] != argv[optind + ix]) { free ((char *) paths[ix]); }
+    }
+    free (paths); free (offsets); free (found);
+    free (buf); free (wbuf);
     return (errcc > 0 ? 1 : 0);
 }
@@ -12,7 +12,9 @@
 **
 ** Synopsis:
 **
-**    genflist [-d|-f] [-e|-n] path
+**    genflist [-d|-f] [-e|-n] [-j N] [-S|-s] [-0] path
+**    genflist [-d|-f] [-e|-n] [-0] -I indexfile [-C] path
+**    genflist [-d|-f] [-e|-n] [-0] -W outfile path
 **
 ** Options:
 **   -d
@@ -23,6 +25,29 @@
 **     don't write the pathnames of empty directories
 **   -n (no directories)
 **     don't write the pathnames of directories
+**   -j N (jobs)
+**     scan the directories with N (parallel) threads; the order of the
+**     pathnames written is not determined then (unless '-S' is used)
+**   -S (sorted)
+**     write the pathnames sorted (a directory immediately followed by it's
+**     entries)
+**   -s (streamed)
+**     write each pathname as soon as it is found (instead of collecting all
+**     pathnames first)
+**   -0
+**     terminate each pathname with a NUL character instead of a newline
+**   -I indexfile (index)
+**     maintain an index of the directory tree (type, inode, modification
+**     time and size of each entry) in 'indexfile'; a directory which didn't
+**     change since the index was written isn't read again (it's entries are
+**     taken from the index). The pathnames are written sorted (as with '-S')
+**   -C (changes)
+**     (with '-I') write only the changes since the index was written, each
+**     pathname preceded by '+ ' (added), '- ' (removed) or 'M ' (modified)
+**   -W outfile (watch; also '--watch outfile')
+**     write the (sorted) list of pathnames into 'outfile' and keep it up to
+**     date (via 'inotify') until terminated by a signal; 'outfile' is
+**     replaced atomically after each batch of changes
 **
 ** vim: set tabstop=8 shiftwidth=4 noexpandtab:
 */
@@ -32,16 +57,24 @@
 #include <string.h>
 #include <errno.h>
 #include <stdarg.h>
+#include <time.h>
+
+#include <fcntl.h>
+
+#include <poll.h>
+#include <signal.h>
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/inotify.h>
 
 #define PROG "genflist"
 
 #include "lib/set_prog.c"
 #include "lib/mrmacs.c"
 #include "lib/sdup.c"
-#include "lib/slist.c"
+#include "lib/strlist.c"
+#include "lib/arena_strdup.c"
 #include "lib/cwd.c"
 #include "lib/pbCopy.c"
 #include "lib/trans_path.c"
@@ -49,6 +82,13 @@
 #include "lib/travdir.c"
 #include "lib/travdirnd.c"
 #include "lib/travdirne.c"
+#include "lib/dirread.c"
+#include "lib/dr_open.c"
+#include "lib/pwalk.c"
+#include "lib/strhash.c"
+#include "lib/sh_remove.c"
+#include "lib/sh_walk.c"
+#include "lib/pathtab.c"
 
 static
 int get_filetype (const char *path, int *_filetype)
@@ -78,38 +118,997 @@ int is_pprefix (const char *p, const char *s)
 }
 
 struct pe_data {
-    int cut_prefix, add_dot;
+    int cut_prefix, add_dot, stream, mark, ofd, sort;
     char *prefix;
-    slist_t flf, flp;
+    size_t prefixlen;
+    struct strlist names;
+    struct pathtab tab;		/* (The pathnames collected with '-S') */
+    char *nbuf, *obuf;
+    size_t nbufsz, olen;
 };
 
+/* The separator written after each pathname ('\n' or - with '-0' - '\0') */
+static int out_sep = '\n';
+
+/* Streamed output ('-s'): each pathname is written into a (large) buffer
+** immediately, which is written to stdout (or - in watch mode - the output
+** file) when it is full. With '-j', each
+** worker has it's own buffer; the buffers are written mutually exclusive
+** (so the output consists of complete pathnames) ...
+*/
+#define OBUFSZ (256 * 1024)
+
+static pthread_mutex_t out_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static
+int out_flush (struct pe_data *pe)
+{
+    ssize_t wlen;
+    size_t off = 0;
+    int rc = 0;
+    if (pe->olen == 0) { return 0; }
+    pthread_mutex_lock (&out_lock);
+    while (off < pe->olen) {
+	if ((wlen = write (pe->ofd, pe->obuf + off, pe->olen - off)) < 0) {
+	    if (errno == EINTR) { continue; }
+	    rc = -1; break;
+	}
+	off += (size_t) wlen;
+    }
+    pthread_mutex_unlock (&out_lock);
+    pe->olen = 0;
+    return rc;
+}
+
+static
+int out_put (struct pe_data *pe, const char *pfx, const char *path)
+{
+    size_t pl = strlen (pfx), len = strlen (path), ml = (pe->mark ? 2 : 0);
+    if (! pe->obuf) {
+	ifnull (pe->obuf = t_allocv (char, OBUFSZ)) { return -1; }
+    }
+    if (pe->olen + ml + pl + len + 1 > OBUFSZ) {
+	if (out_flush (pe)) { return -1; }
+	if (ml + pl + len + 1 > OBUFSZ) {
+	    /* (Pathnames this long don't exist in practice) */
+	    errno = ENAMETOOLONG; return -1;
+	}
+    }
+    if (pe->mark) {
+	/* The change marker ('-C') ... */
+	pe->obuf[pe->olen++] = (char) pe->mark; pe->obuf[pe->olen++] = ' ';
+    }
+    memcpy (pe->obuf + pe->olen, pfx, pl); pe->olen += pl;
+    memcpy (pe->obuf + pe->olen, path, len); pe->olen += len;
+    pe->obuf[pe->olen++] = (char) out_sep;
+    return 0;
+}
+
 static
 int process_entry (const char *path, int filetype, void *data)
 {
     struct pe_data *pe = (struct pe_data *) data;
+    const char *pfx = "";
+    if (pe->sort) {
+	/* ('-S') Only the pathname relative to 'path' is stored (and marked
+	** as found, unlike the parent directories added implicitly) ...
+	*/
+	size_t ix;
+	if (is_pprefix (pe->prefix, path)) { path += pe->prefixlen; }
+	if ((ix = pt_addpath (&pe->tab, path)) == PT_NONE) { return -1; }
+	pe->tab.v[ix].flags = 1;
+	return 0;
+    }
     if (pe->cut_prefix && is_pprefix (pe->prefix, path)) {
-	path += strlen (pe->prefix) + 1;
+	path += pe->prefixlen;
+	if (*path) { ++path; }
     }
     if (!*path || !strcmp (path, ".")) {
-	if (slist_append (pe->flp, (pe->add_dot ? "." : "/"))) {
-	    return -1;
+	path = (pe->add_dot ? "." : "/");
+    } else if (pe->add_dot) {
+	pfx = "./";
+    }
+    if (pe->stream) { return out_put (pe, pfx, path); }
+    if (*pfx) {
+	/* Build the pathname in a (reusable) buffer ... */
+	size_t sz = strlen (path) + 3;
+	if (sz > pe->nbufsz) {
+	    char *p;
+	    sz += 127; sz -= sz % 128;
+	    ifnull (p = (char *) realloc (pe->nbuf, sz)) { return -1; }
+	    pe->nbuf = p; pe->nbufsz = sz;
+	}
+	pbCopy (pbCopy (pe->nbuf, pfx), path);
+	path = pe->nbuf;
+    }
+    ifnull (sl_append (&pe->names, path)) { return -1; }
+    return 0;
+}
+
+/* The pathnames are sorted such that each directory is immediately
+** followed by it's entries ('/' sorts before any other character) ...
+*/
+static
+int pathcmp (const char *a, const char *b)
+{
+    int ca, cb;
+    for (;; ++a, ++b) {
+	ca = (*a == '/' ? 1 : (unsigned char) *a);
+	cb = (*b == '/' ? 1 : (unsigned char) *b);
+	if (ca != cb || !ca) { return ca - cb; }
+    }
+}
+
+/* The 'visit()' function for the parallel traversal ('-j'); each worker
+** uses it's own 'struct pe_data' ...
+*/
+static
+int pw_process_entry (const char *path, int filetype, int worker, void *data)
+{
+    return process_entry (path, filetype, &((struct pe_data *) data)[worker]);
+}
+
+/* Sorted output ('-S'): the path tables of the workers are merged (into
+** the largest one), and the merged table is walked in sorted order, each
+** pathname being rebuilt (prefixed with the scanned directory) and written
+** (like with '-s') through 'process_entry()' ...
+*/
+struct so_data {
+    struct pe_data *pe;
+    struct pathtab *tab;
+    char *buf;
+    size_t bufsz;
+};
+
+static
+int so_write (const char *rel, size_t ix, void *data)
+{
+    struct so_data *sd = (struct so_data *) data;
+    struct pe_data *pe = sd->pe;
+    size_t rlen = strlen (rel), len = pe->prefixlen, sz = len + rlen + 2;
+    if (! sd->tab->v[ix].flags) { return 0; }
+    if (sz > sd->bufsz) {
+	char *p;
+	sz += 127; sz -= sz % 128;
+	ifnull (p = (char *) realloc (sd->buf, sz)) { return -1; }
+	sd->buf = p; sd->bufsz = sz;
+    }
+    memcpy (sd->buf, pe->prefix, len);
+    if (rlen > 0) {
+	if (len == 0 || sd->buf[len - 1] != '/') { sd->buf[len++] = '/'; }
+	memcpy (sd->buf + len, rel, rlen); len += rlen;
+    }
+    sd->buf[len] = '\0';
+    return process_entry (sd->buf, FT_FILE, (void *) pe);
+}
+
+static
+int write_sorted (struct pe_data *pes, int njobs, struct pe_data *pe)
+{
+    struct so_data sd;
+    int ix, dst = 0, rc = 0;
+    for (ix = 1; ix < njobs; ++ix) {
+	if (pes[ix].tab.count > pes[dst].tab.count) { dst = ix; }
+    }
+    for (ix = 0; ix < njobs; ++ix) {
+	if (ix == dst) { continue; }
+	if (pt_merge (&pes[dst].tab, &pes[ix].tab)) { return -1; }
+	pt_free (&pes[ix].tab);
+    }
+    sd.pe = pe; sd.tab = &pes[dst].tab; sd.buf = NULL; sd.bufsz = 0;
+    pe->sort = 0; pe->stream = 1;
+    if (pt_walk (sd.tab, so_write, (void *) &sd) || out_flush (pe)) {
+	rc = -1;
+    }
+    cfree (sd.buf);
+    return rc;
+}
+
+/* The file-tree index ('-I'). It holds an entry (type, inode, modification
+** time, size and the pathname relative to the scanned directory) for each
+** file/directory, sorted as with '-S'. The index file consists of a header
+** and one record per entry, each one terminated by a NUL character:
+**    genflist-index 1 <scan-time> <directory>
+**    <type> <inode> <mtime> <mtime-nsec> <size> <pathname>
+** The type is one of 'd', 'f', 'l', 'p', 's', 'c' or 'b'; the pathname of
+** the scanned directory itself is empty. A directory modified shortly before
+** (or during) the scan is read again on the next run, because it may have
+** been changed after it was read without changing it's modification time
+** (whose granularity may be coarse) ...
+*/
+#define IX_MAGIC "genflist-index 1"
+#define IX_NONE ((size_t) -1)
+
+struct ix_entry {
+    char *path;
+    int type, empty;
+    unsigned long long ino, size;
+    long long mtime;
+    long mtime_ns;
+    size_t end;			/* (Index behind the entry's sub-tree) */
+};
+
+struct ix_list {
+    struct ix_entry *v;
+    size_t count, size;
+    char *data;			/* (The content of the index file) */
+    struct arena pool;		/* (The pathnames of a scanned tree) */
+};
+
+struct ix_ctx {
+    const char *root;
+    long long scantime, oldscantime;
+    struct ix_list old, cur;
+    struct dirread dr;
+    char *buf;
+    size_t bufsz, rootlen;
+};
+
+static
+int ix_type (mode_t mode)
+{
+    if (S_ISDIR (mode)) { return 'd'; }
+    if (S_ISLNK (mode)) { return 'l'; }
+    if (S_ISFIFO (mode)) { return 'p'; }
+    if (S_ISSOCK (mode)) { return 's'; }
+    if (S_ISCHR (mode)) { return 'c'; }
+    if (S_ISBLK (mode)) { return 'b'; }
+    return 'f';
+}
+
+static
+struct ix_entry *ix_new (struct ix_list *l)
+{
+    if (l->count >= l->size) {
+	size_t sz = (l->size > 0 ? 2 * l->size : 1024);
+	struct ix_entry *v = t_realloc (struct ix_entry, l->v, sz);
+	ifnull (v) { return NULL; }
+	l->v = v; l->size = sz;
+    }
+    return &l->v[l->count++];
+}
+
+static
+void ix_free (struct ix_list *l)
+{
+    arena_free (&l->pool);
+    cfree (l->v); cfree (l->data);
+    l->count = l->size = 0;
+}
+
+/* Check if 'path' is inside of the directory 'dir' ... */
+static
+int ix_inside (const char *dir, const char *path)
+{
+    size_t len = strlen (dir);
+    if (len == 0) { return *path != '\0'; }
+    return !strncmp (path, dir, len) && path[len] == '/';
+}
+
+/* Set the sub-tree ends and the 'empty' flags of the (sorted) list ... */
+static
+int ix_finish (struct ix_list *l)
+{
+    size_t *stack, sp = 0, ix;
+    if (l->count == 0) { return 0; }
+    ifnull (stack = t_allocv (size_t, l->count)) { return -1; }
+    for (ix = 0; ix < l->count; ++ix) {
+	while (sp > 0 && ! ix_inside (l->v[stack[sp - 1]].path, l->v[ix].path)) {
+	    l->v[stack[--sp]].end = ix;
 	}
-	if (!pe->flf) { pe->flf = pe->flp; }
+	stack[sp++] = ix;
+    }
+    while (sp > 0) { l->v[stack[--sp]].end = l->count; }
+    for (ix = 0; ix < l->count; ++ix) {
+	l->v[ix].empty = (l->v[ix].type == 'd' && l->v[ix].end == ix + 1);
+    }
+    free (stack);
+    return 0;
+}
+
+static
+size_t ix_find (struct ix_list *l, const char *path)
+{
+    size_t lo = 0, hi = l->count, mid;
+    int cmp;
+    while (lo < hi) {
+	mid = lo + (hi - lo) / 2;
+	if ((cmp = pathcmp (l->v[mid].path, path)) == 0) { return mid; }
+	if (cmp < 0) { lo = mid + 1; } else { hi = mid; }
+    }
+    return IX_NONE;
+}
+
+/* Read the index file 'file' into 'ctx->old'. A missing index file (or one
+** of another directory) yields an empty index ...
+*/
+static
+int ix_load (struct ix_ctx *ctx, const char *file)
+{
+    struct ix_list *l = &ctx->old;
+    struct ix_entry *e;
+    struct stat sb;
+    char *p, *end, *hdr, type;
+    size_t len = 0;
+    ssize_t rlen;
+    int fd, n = -1;
+    if ((fd = open (file, O_RDONLY)) < 0) {
+	if (errno == ENOENT) { return 0; }
+	fprintf (stderr, "%s: %s - %s\n", prog, file, strerror (errno));
+	return -1;
+    }
+    if (fstat (fd, &sb)
+    ||  ! (l->data = t_allocv (char, (size_t) sb.st_size + 1))) {
+	fprintf (stderr, "%s: %s - %s\n", prog, file, strerror (errno));
+	close (fd); return -1;
+    }
+    while (len < (size_t) sb.st_size) {
+	rlen = read (fd, l->data + len, (size_t) sb.st_size - len);
+	if (rlen < 0 && errno == EINTR) { continue; }
+	if (rlen <= 0) { break; }
+	len += (size_t) rlen;
+    }
+    close (fd);
+    l->data[len] = '\0'; end = l->data + len;
+    hdr = l->data; p = hdr + strlen (hdr) + 1;
+    if (strncmp (hdr, IX_MAGIC " ", sizeof(IX_MAGIC))
+    ||  (len > 0 && end[-1] != '\0')) {
+	goto INVALID;
+    }
+    sscanf (hdr + sizeof(IX_MAGIC), "%lld %n", &ctx->oldscantime, &n);
+    if (n < 0) { goto INVALID; }
+    if (strcmp (hdr + sizeof(IX_MAGIC) + n, ctx->root)) {
+	fprintf (stderr, "%s: %s - index of another directory (ignored)\n",
+		 prog, file);
+	cfree (l->data); return 0;
+    }
+    for (; p < end; p += strlen (p) + 1) {
+	ifnull (e = ix_new (l)) {
+	    fprintf (stderr, "%s: %s\n", prog, strerror (errno)); return -1;
+	}
+	/* (Parsed by hand, as 'sscanf()' is rather slow for this) */
+	type = *p++;
+	if (! type || ! strchr ("dflpscb", type) || *p++ != ' ') {
+	    goto INVALID;
+	}
+	e->type = type;
+	e->ino = strtoull (p, &p, 10); if (*p++ != ' ') { goto INVALID; }
+	e->mtime = strtoll (p, &p, 10); if (*p++ != ' ') { goto INVALID; }
+	e->mtime_ns = strtol (p, &p, 10); if (*p++ != ' ') { goto INVALID; }
+	e->size = strtoull (p, &p, 10); if (*p++ != ' ') { goto INVALID; }
+	e->path = p;
+	if (l->count > 1 && pathcmp (e[-1].path, e->path) >= 0) {
+	    goto INVALID;
+	}
+    }
+    if (ix_finish (l)) {
+	fprintf (stderr, "%s: %s\n", prog, strerror (errno)); return -1;
+    }
+    return 0;
+INVALID:
+    fprintf (stderr, "%s: %s - invalid index file\n", prog, file);
+    return -1;
+}
+
+/* Append '/name' to the pathname (of length 'len') in 'ctx->buf'. Returns
+** the new length of the pathname (or 0 on failure) ...
+*/
+static
+size_t ix_push (struct ix_ctx *ctx, size_t len, const char *name)
+{
+    size_t nlen = strlen (name), sz = len + nlen + 2;
+    int slash = (len == 0 || ctx->buf[len - 1] != '/');
+    if (sz > ctx->bufsz) {
+	char *p;
+	sz += 127; sz -= sz % 128;
+	ifnull (p = (char *) realloc (ctx->buf, sz)) { return 0; }
+	ctx->buf = p; ctx->bufsz = sz;
+    }
+    if (slash) { ctx->buf[len++] = '/'; }
+    memcpy (ctx->buf + len, name, nlen + 1);
+    return len + nlen;
+}
+
+/* Scan the file/directory whose pathname (of length 'len') is in
+** 'ctx->buf' into 'ctx->cur' ...
+*/
+static
+int ix_scan (struct ix_ctx *ctx, size_t len)
+{
+    struct stat sb;
+    struct ix_entry *e, *oe = NULL;
+    struct dr_entry de;
+    const char *rel = ctx->buf + ctx->rootlen;
+    char *names = NULL, *np;
+    size_t rellen, ox, cx, nlen, namesz = 0, nameslen = 0;
+    int rc;
+
+    if (*rel == '/') { ++rel; }
+    if (lstat (ctx->buf, &sb)) {
+	/* (Entries removed during the scan are ignored) */
+	return (errno == ENOENT && *rel ? 0 : -1);
+    }
+    ifnull (e = ix_new (&ctx->cur)) { return -1; }
+    ifnull (e->path = arena_strdup (&ctx->cur.pool, rel)) {
+	--ctx->cur.count; return -1;
+    }
+    e->type = ix_type (sb.st_mode);
+    e->ino = (unsigned long long) sb.st_ino;
+    e->size = (unsigned long long) sb.st_size;
+    e->mtime = (long long) sb.st_mtim.tv_sec;
+    e->mtime_ns = sb.st_mtim.tv_nsec;
+    if (e->type != 'd') { return 0; }
+    rellen = strlen (rel);
+    if ((ox = ix_find (&ctx->old, rel)) != IX_NONE) { oe = &ctx->old.v[ox]; }
+    if (oe && oe->type == 'd' && oe->ino == e->ino && oe->mtime == e->mtime
+    &&  oe->mtime_ns == e->mtime_ns && oe->mtime < ctx->oldscantime - 1) {
+	/* The directory didn't change; take it's entries from the index ...
+	*/
+	for (cx = ox + 1; cx < oe->end; cx = ctx->old.v[cx].end) {
+	    np = ctx->old.v[cx].path + rellen + (rellen > 0);
+	    if (! (nlen = ix_push (ctx, len, np))) { return -1; }
+	    if (ix_scan (ctx, nlen)) { return -1; }
+	}
+	ctx->buf[len] = '\0';
 	return 0;
     }
-    if (pe->add_dot) {
-	char *npath = t_allocv (char, strlen (path) + 3);
-	if (!npath) { return -1; }
-	pbCopy (npath, "./"); pbCopy (npath + 2, path);
-	if (slist_append (pe->flp, npath)) { free (npath); return -1; }
-	free (npath);
-    } else {
-	if (slist_append (pe->flp, path)) { return -1; }
+    /* Read the directory (collecting the names of it's entries first) ... */
+    if (dr_open (&ctx->dr, ctx->buf)) { return -1; }
+    while ((rc = dr_next (&ctx->dr, &de)) > 0) {
+	nlen = strlen (de.name) + 1;
+	if (nameslen + nlen > namesz) {
+	    size_t sz = (namesz > 0 ? 2 * namesz : 1024);
+	    while (sz < nameslen + nlen) { sz *= 2; }
+	    ifnull (np = (char *) realloc (names, sz)) { rc = -1; break; }
+	    names = np; namesz = sz;
+	}
+	memcpy (names + nameslen, de.name, nlen);
+	nameslen += nlen;
+    }
+    dr_close (&ctx->dr);
+    for (np = names; rc == 0 && np < names + nameslen; np += strlen (np) + 1) {
+	if (! (nlen = ix_push (ctx, len, np)) || ix_scan (ctx, nlen)) {
+	    rc = -1;
+	}
+    }
+    ctx->buf[len] = '\0';
+    cfree (names);
+    return rc;
+}
+
+static
+int ix_entpcmp (const void *a, const void *b)
+{
+    return pathcmp (((const struct ix_entry *) a)->path,
+		    ((const struct ix_entry *) b)->path);
+}
+
+/* Create a temporary file for replacing 'file' atomically (by renaming it
+** to 'file' later). Returns the file descriptor (and the allocated name of
+** the temporary file in '*_tmpf') or -1 ...
+*/
+static
+int tmpfile_for (const char *file, char **_tmpf)
+{
+    char *tmpf;
+    mode_t um;
+    int fd, ec;
+    ifnull (tmpf = t_allocv (char, strlen (file) + 8)) { return -1; }
+    pbCopy (pbCopy (tmpf, file), ".XXXXXX");
+    if ((fd = mkstemp (tmpf)) < 0) { free (tmpf); return -1; }
+    /* ('mkstemp()' creates the file with the mode 0600) */
+    um = umask (0); umask (um);
+    if (fchmod (fd, 0666 & ~um)) {
+	ec = errno; close (fd); unlink (tmpf); free (tmpf); errno = ec;
+	return -1;
+    }
+    *_tmpf = tmpf;
+    return fd;
+}
+
+/* Write 'ctx->cur' into the index file 'file' (replacing it atomically) ...
+*/
+static
+int ix_save (struct ix_ctx *ctx, const char *file)
+{
+    struct ix_entry *e;
+    char *tmpf;
+    FILE *fp;
+    size_t ix;
+    int fd, ec;
+    if ((fd = tmpfile_for (file, &tmpf)) < 0) { return -1; }
+    ifnull (fp = fdopen (fd, "w")) { goto ERROUT; }
+    fd = -1;
+    setvbuf (fp, NULL, _IOFBF, OBUFSZ);
+    fprintf (fp, "%s %lld %s", IX_MAGIC, ctx->scantime, ctx->root);
+    putc ('\0', fp);
+    for (ix = 0; ix < ctx->cur.count; ++ix) {
+	e = &ctx->cur.v[ix];
+	fprintf (fp, "%c %llu %lld %ld %llu %s", e->type, e->ino, e->mtime,
+		 e->mtime_ns, e->size, e->path);
+	putc ('\0', fp);
+    }
+    if (fclose (fp)) { fp = NULL; goto ERROUT; }
+    fp = NULL;
+    if (rename (tmpf, file)) { goto ERROUT; }
+    free (tmpf);
+    return 0;
+ERROUT:
+    ec = errno;
+    if (fp) { fclose (fp); }
+    if (fd >= 0) { close (fd); }
+    unlink (tmpf); free (tmpf);
+    errno = ec;
+    return -1;
+}
+
+/* Write the pathname of the entry 'e' (preceded by the marker 'mark' if it
+** isn't 0) ...
+*/
+static
+int ix_output (struct ix_ctx *ctx, struct pe_data *pe, int mark,
+	       const struct ix_entry *e)
+{
+    size_t len = ctx->rootlen;
+    ctx->buf[len] = '\0';
+    if (*e->path && ! (len = ix_push (ctx, len, e->path))) { return -1; }
+    pe->mark = mark;
+    return process_entry (ctx->buf, (e->type == 'd' ? FT_DIRECTORY : FT_FILE),
+			  (void *) pe);
+}
+
+/* Check if the entry 'e' is to be written (considering '-e' and '-n') ...
+*/
+static
+int ix_wanted (const struct ix_entry *e, int flags)
+{
+    if (e->type != 'd') { return 1; }
+    if (flags & TRAV_NODIRS) { return 0; }
+    return ! ((flags & TRAV_NOEMPTY) && e->empty);
+}
+
+static
+int ix_modified (const struct ix_entry *o, const struct ix_entry *e)
+{
+    if (o->type != e->type || o->ino != e->ino) { return 1; }
+    /* (The modification time of a directory changes with it's entries) */
+    if (e->type == 'd') { return 0; }
+    return o->mtime != e->mtime || o->mtime_ns != e->mtime_ns
+	|| o->size != e->size;
+}
+
+/* Check if the scanned tree is the same as the one in the index ... */
+static
+int ix_unchanged (struct ix_ctx *ctx)
+{
+    size_t ix;
+    struct ix_entry *o, *e;
+    if (ctx->old.count != ctx->cur.count) { return 0; }
+    for (ix = 0; ix < ctx->cur.count; ++ix) {
+	o = &ctx->old.v[ix]; e = &ctx->cur.v[ix];
+	if (o->type != e->type || o->ino != e->ino || o->size != e->size
+	||  o->mtime != e->mtime || o->mtime_ns != e->mtime_ns
+	||  strcmp (o->path, e->path)) {
+	    return 0;
+	}
+    }
+    return 1;
+}
+
+/* Scan the directory 'root' using (and updating) the index 'indexfile' and
+** write either all pathnames or (with 'changes') only the changes ...
+*/
+static
+int ix_run (struct pe_data *pe, const char *root, const char *indexfile,
+	    int flags, int changes)
+{
+    struct ix_ctx ctx;
+    struct ix_entry *o, *e;
+    size_t ox = 0, cx = 0;
+    int cmp, rc = -1;
+
+    memset (&ctx, 0, sizeof(ctx));
+    dr_init (&ctx.dr, 0);
+    ctx.root = root; ctx.rootlen = strlen (root);
+    ctx.scantime = (long long) time (NULL);
+    if (ctx.rootlen == 1) { ctx.rootlen = 0; }	/* (root == "/") */
+    if (ix_load (&ctx, indexfile)) { goto CLEANUP; }
+    ifnull (ctx.buf = sdup (root)) { goto ERROUT; }
+    ctx.bufsz = strlen (root) + 1;
+    if (ix_scan (&ctx, strlen (root))) {
+	fprintf (stderr, "%s: %s - %s\n", prog, ctx.buf, strerror (errno));
+	goto CLEANUP;
+    }
+    qsort (ctx.cur.v, ctx.cur.count, sizeof(struct ix_entry), ix_entpcmp);
+    if (ix_finish (&ctx.cur)) { goto ERROUT; }
+    pe->stream = 1;
+    if (! changes) {
+	for (cx = 0; cx < ctx.cur.count; ++cx) {
+	    e = &ctx.cur.v[cx];
+	    if (ix_wanted (e, flags) && ix_output (&ctx, pe, 0, e)) {
+		goto ERROUT;
+	    }
+	}
+    }
+    while (changes && (ox < ctx.old.count || cx < ctx.cur.count)) {
+	o = (ox < ctx.old.count ? &ctx.old.v[ox] : NULL);
+	e = (cx < ctx.cur.count ? &ctx.cur.v[cx] : NULL);
+	if (o && ! ix_wanted (o, flags)) { ++ox; continue; }
+	if (e && ! ix_wanted (e, flags)) { ++cx; continue; }
+	cmp = (! o ? 1 : (! e ? -1 : pathcmp (o->path, e->path)));
+	if (cmp < 0) {
+	    if (ix_output (&ctx, pe, '-', o)) { goto ERROUT; }
+	    ++ox;
+	} else if (cmp > 0) {
+	    if (ix_output (&ctx, pe, '+', e)) { goto ERROUT; }
+	    ++cx;
+	} else {
+	    if (ix_modified (o, e) && ix_output (&ctx, pe, 'M', e)) {
+		goto ERROUT;
+	    }
+	    ++ox; ++cx;
+	}
+    }
+    if (out_flush (pe)) { goto ERROUT; }
+    /* (The index is rewritten only if something changed) */
+    if (! ix_unchanged (&ctx) && ix_save (&ctx, indexfile)) {
+	fprintf (stderr, "%s: %s - %s\n", prog, indexfile, strerror (errno));
+	goto CLEANUP;
+    }
+    rc = 0;
+    goto CLEANUP;
+ERROUT:
+    fprintf (stderr, "%s: %s\n", prog, strerror (errno));
+CLEANUP:
+    ix_free (&ctx.old); ix_free (&ctx.cur);
+    dr_free (&ctx.dr);
+    cfree (ctx.buf);
+    return rc;
+}
+
+/* Watch mode ('-W outfile'). After an initial traversal, the list of
+** pathnames is kept in a hash table (pathname -> file type) which is
+** updated from the 'inotify' events of the (watched) directories. The
+** output file is (atomically) replaced after each batch of changes, i.e.
+** when no further events arrived for W_QUIET milliseconds (but at the
+** latest W_MAXDELAY milliseconds after the first change). The watch mode
+** ends with SIGINT, SIGTERM or SIGHUP ...
+*/
+#define W_MASK (IN_CREATE|IN_DELETE|IN_MOVED_FROM|IN_MOVED_TO|IN_ONLYDIR \
+		|IN_DONT_FOLLOW|IN_EXCL_UNLINK)
+#define W_QUIET 100
+#define W_MAXDELAY 1000
+
+struct w_ctx {
+    int ifd, flags;
+    const char *root, *outfile;
+    struct strhash files;
+    char **wdirs;		/* The directory of each watch descriptor */
+    size_t nwdirs;
+    char *buf, *pbuf;
+    size_t bufsz, pbufsz;
+    struct pe_data *pe;
+};
+
+static volatile sig_atomic_t w_stop = 0;
+
+static
+void w_sighandler (int sig)
+{
+    (void) sig;
+    w_stop = 1;
+}
+
+/* (Entries removed during a traversal are handled by the 'inotify' events
+** of their directories, so they are treated as regular files here) ...
+*/
+static
+int w_filetype (const char *path, int *_filetype)
+{
+    if (get_filetype (path, _filetype) == 0) { return 0; }
+    if (errno != ENOENT) { return -1; }
+    *_filetype = FT_FILE;
+    return 0;
+}
+
+static
+int w_watch (struct w_ctx *w, const char *dir)
+{
+    int wd = inotify_add_watch (w->ifd, dir, W_MASK);
+    if (wd < 0) { return (errno == ENOENT || errno == ENOTDIR ? 0 : -1); }
+    if ((size_t) wd >= w->nwdirs) {
+	size_t ix, sz = (size_t) wd + 256;
+	char **wdirs = t_realloc (char *, w->wdirs, sz);
+	ifnull (wdirs) { return -1; }
+	for (ix = w->nwdirs; ix < sz; ++ix) { wdirs[ix] = NULL; }
+	w->wdirs = wdirs; w->nwdirs = sz;
+    }
+    cfree (w->wdirs[wd]);
+    ifnull (w->wdirs[wd] = sdup (dir)) { return -1; }
+    return 0;
+}
+
+static
+int w_add_entry (const char *path, int filetype, void *data)
+{
+    struct w_ctx *w = (struct w_ctx *) data;
+    struct sh_entry *e = sh_insert (&w->files, path, filetype, NULL);
+    ifnull (e) { return -1; }
+    e->value = filetype;
+    /* (The directory is watched before it is read) */
+    return (filetype == FT_DIRECTORY ? w_watch (w, path) : 0);
+}
+
+/* Add the (new) directory tree 'path'. If a directory is removed during the
+** traversal, the traversal is repeated (a few times) ...
+*/
+static
+int w_add_tree (struct w_ctx *w, const char *path)
+{
+    int rc, tries = 0;
+    for (;;) {
+	rc = travdir_core (&w->buf, &w->bufsz, path, 0, w_filetype,
+			   w_add_entry, (void *) w);
+	if (rc != -2 || errno != ENOENT) { break; }
+	if (access (path, F_OK)) { return 0; }
+	if (++tries >= 5) { break; }
+    }
+    return (rc ? -1 : 0);
+}
+
+/* Check if 'path' is 'dir' or inside of it ... */
+static
+int w_inside (const char *dir, size_t len, const char *path)
+{
+    return !strncmp (path, dir, len)
+	&& (path[len] == '\0' || path[len] == '/');
+}
+
+static
+int w_remove_op (struct sh_entry *e, void *data)
+{
+    const char *path = (const char *) data;
+    return w_inside (path, strlen (path), e->key);
+}
+
+/* Remove the directory tree 'path' (and the watches of it's directories)
+** ...
+*/
+static
+void w_remove_tree (struct w_ctx *w, const char *path)
+{
+    size_t wd, len = strlen (path);
+    sh_walk (&w->files, w_remove_op, (void *) path);
+    for (wd = 0; wd < w->nwdirs; ++wd) {
+	if (w->wdirs[wd] && w_inside (path, len, w->wdirs[wd])) {
+	    inotify_rm_watch (w->ifd, (int) wd);
+	    cfree (w->wdirs[wd]);
+	}
+    }
+}
+
+/* Forget everything and traverse the directory tree again (after the
+** event queue overflowed) ...
+*/
+static
+int w_rescan (struct w_ctx *w)
+{
+    size_t wd;
+    for (wd = 0; wd < w->nwdirs; ++wd) {
+	if (w->wdirs[wd]) {
+	    inotify_rm_watch (w->ifd, (int) wd); cfree (w->wdirs[wd]);
+	}
+    }
+    sh_free (&w->files);
+    return w_add_tree (w, w->root);
+}
+
+/* Read and process the pending events. Returns 1 if the list changed, 0 if
+** it didn't and -1 on failure ...
+*/
+static
+int w_events (struct w_ctx *w)
+{
+    char ebuf[65536]
+	__attribute__ ((aligned (__alignof__ (struct inotify_event))));
+    struct inotify_event *ev;
+    ssize_t len;
+    size_t dl, sz;
+    char *p;
+    int changed = 0, rescan = 0;
+    if ((len = read (w->ifd, ebuf, sizeof(ebuf))) < 0) {
+	return (errno == EINTR || errno == EAGAIN ? 0 : -1);
+    }
+    for (p = ebuf; p < ebuf + len; p += sizeof(*ev) + ev->len) {
+	ev = (struct inotify_event *) p;
+	if (ev->mask & IN_Q_OVERFLOW) { rescan = 1; continue; }
+	if (ev->wd < 0 || (size_t) ev->wd >= w->nwdirs || ! w->wdirs[ev->wd]) {
+	    continue;
+	}
+	if (ev->mask & IN_IGNORED) { cfree (w->wdirs[ev->wd]); continue; }
+	if (ev->len == 0 || ! *ev->name) { continue; }
+	/* Build the pathname of the entry ... */
+	dl = strlen (w->wdirs[ev->wd]);
+	sz = dl + strlen (ev->name) + 2;
+	if (sz > w->pbufsz) {
+	    char *np;
+	    sz += 127; sz -= sz % 128;
+	    ifnull (np = (char *) realloc (w->pbuf, sz)) { return -1; }
+	    w->pbuf = np; w->pbufsz = sz;
+	}
+	pbCopy (pbCopy (pbCopy (w->pbuf, w->wdirs[ev->wd]), "/"), ev->name);
+	if (ev->mask & (IN_CREATE|IN_MOVED_TO)) {
+	    if (ev->mask & IN_ISDIR) {
+		if (w_add_tree (w, w->pbuf)) { return -1; }
+	    } else ifnull (sh_insert (&w->files, w->pbuf, FT_FILE, NULL)) {
+		return -1;
+	    }
+	    changed = 1;
+	} else if (ev->mask & (IN_DELETE|IN_MOVED_FROM)) {
+	    if (ev->mask & IN_ISDIR) {
+		w_remove_tree (w, w->pbuf);
+	    } else {
+		sh_remove (&w->files, w->pbuf);
+	    }
+	    changed = 1;
+	}
+    }
+    if (rescan) {
+	if (w_rescan (w)) { return -1; }
+	changed = 1;
     }
-    if (!pe->flf) { pe->flf = pe->flp; }
+    return changed;
+}
+
+struct w_list {
+    struct sh_entry **v;
+    size_t count;
+};
+
+static
+int w_collect_op (struct sh_entry *e, void *data)
+{
+    struct w_list *l = (struct w_list *) data;
+    l->v[l->count++] = e;
     return 0;
 }
 
+static
+int w_entpcmp (const void *a, const void *b)
+{
+    return pathcmp ((*(struct sh_entry * const *) a)->key,
+		    (*(struct sh_entry * const *) b)->key);
+}
+
+/* Write the (sorted) list of pathnames into the output file (replacing it
+** atomically) ...
+*/
+static
+int w_output (struct w_ctx *w)
+{
+    struct w_list l;
+    struct sh_entry *e;
+    size_t ix;
+    char *tmpf;
+    int fd, ec, rc = 0;
+    l.count = 0;
+    ifnull (l.v = t_allocv (struct sh_entry *, w->files.count + 1)) {
+	return -1;
+    }
+    sh_walk (&w->files, w_collect_op, (void *) &l);
+    qsort (l.v, l.count, sizeof(struct sh_entry *), w_entpcmp);
+    if ((fd = tmpfile_for (w->outfile, &tmpf)) < 0) { free (l.v); return -1; }
+    w->pe->ofd = fd;
+    for (ix = 0; rc == 0 && ix < l.count; ++ix) {
+	e = l.v[ix];
+	if (e->value == FT_DIRECTORY) {
+	    if (w->flags & TRAV_NODIRS) { continue; }
+	    /* (A directory is empty if it isn't followed by an entry of it) */
+	    if ((w->flags & TRAV_NOEMPTY)
+	    &&  (ix + 1 >= l.count
+		 || ! w_inside (e->key, strlen (e->key), l.v[ix + 1]->key))) {
+		continue;
+	    }
+	}
+	rc = process_entry (e->key, e->value, (void *) w->pe);
+    }
+    if (rc == 0) { rc = out_flush (w->pe); }
+    w->pe->olen = 0;
+    ec = errno;
+    if (close (fd) && rc == 0) { rc = -1; ec = errno; }
+    if (rc == 0 && rename (tmpf, w->outfile)) { rc = -1; ec = errno; }
+    if (rc) { unlink (tmpf); }
+    free (tmpf); free (l.v);
+    errno = ec;
+    return rc;
+}
+
+static
+long w_msecs (void)
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (long) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* Traverse the directory tree 'root', write the list of pathnames into
+** 'outfile' and keep it up to date (until a signal terminates this) ...
+*/
+static
+int w_run (struct pe_data *pe, const char *root, const char *outfile,
+	   int flags)
+{
+    struct w_ctx w;
+    struct pollfd pfd;
+    struct sigaction sa;
+    long first = 0, timeout;
+    int rc = -1, dirty = 0, n;
+
+    memset (&w, 0, sizeof(w));
+    w.root = root; w.outfile = outfile; w.flags = flags; w.pe = pe;
+    pe->stream = 1;
+    memset (&sa, 0, sizeof(sa));
+    sa.sa_handler = w_sighandler;
+    sigemptyset (&sa.sa_mask);
+    sigaction (SIGINT, &sa, NULL);
+    sigaction (SIGTERM, &sa, NULL);
+    sigaction (SIGHUP, &sa, NULL);
+    if ((w.ifd = inotify_init1 (IN_NONBLOCK|IN_CLOEXEC)) < 0) {
+	fprintf (stderr, "%s: inotify - %s\n", prog, strerror (errno));
+	return -1;
+    }
+    if (w_add_tree (&w, root)) {
+	fprintf (stderr, "%s: %s - %s\n", prog, root, strerror (errno));
+	goto CLEANUP;
+    }
+    if (w_output (&w)) { goto OUTERR; }
+    pfd.fd = w.ifd; pfd.events = POLLIN;
+    while (! w_stop) {
+	/* Wait for events; when the list changed, only until the changes
+	** are to be written ...
+	*/
+	timeout = -1;
+	if (dirty) {
+	    timeout = first + W_MAXDELAY - w_msecs ();
+	    if (timeout > W_QUIET) { timeout = W_QUIET; }
+	    if (timeout < 0) { timeout = 0; }
+	}
+	if ((n = poll (&pfd, 1, (int) timeout)) < 0) {
+	    if (errno == EINTR) { continue; }
+	    fprintf (stderr, "%s: poll - %s\n", prog, strerror (errno));
+	    goto CLEANUP;
+	}
+	if (n > 0) {
+	    if ((n = w_events (&w)) < 0) {
+		fprintf (stderr, "%s: %s\n", prog, strerror (errno));
+		goto CLEANUP;
+	    }
+	    if (n > 0 && ! dirty) { dirty = 1; first = w_msecs (); }
+	    if (! dirty || w_msecs () - first < W_MAXDELAY) { continue; }
+	}
+	if (dirty) {
+	    if (w_output (&w)) { goto OUTERR; }
+	    dirty = 0;
+	}
+    }
+    /* (Pending changes are written before terminating) */
+    if (dirty && w_output (&w)) { goto OUTERR; }
+    rc = 0;
+    goto CLEANUP;
+OUTERR:
+    fprintf (stderr, "%s: %s - %s\n", prog, outfile, strerror (errno));
+CLEANUP:
+    close (w.ifd);
+    sh_free (&w.files);
+    if (w.wdirs) {
+	size_t wd;
+	for (wd = 0; wd < w.nwdirs; ++wd) { cfree (w.wdirs[wd]); }
+	free (w.wdirs);
+    }
+    cfree (w.buf); cfree (w.pbuf);
+    return rc;
+}
+
 typedef int (*trav_t) (char **_buf, size_t *_bufsz,
 		       const char *dirname, getfiletype_t get_filetype,
 		       travop_t travop, void *travdata);
@@ -124,9 +1123,19 @@ void usage (const char *format, ...)
 	fputs ("\n", stderr);
 	exit (64);
     }
-    printf ("Usage: %s [-d|-f] [-e|-n] path\n"
+    printf ("Usage: %s [-d|-f] [-e|-n] [-j N] [-S|-s] [-0] path\n"
+	    "       %s [-d|-f] [-e|-n] [-0] -I indexfile [-C] path\n"
+	    "       %s [-d|-f] [-e|-n] [-0] -W outfile path\n"
 	    "       %s -h\n"
 	    "\nOptions:"
+	    "\n  -0"
+	    "\n    terminate each pathname with a NUL character (instead of a"
+	    " newline)"
+	    "\n  -C (changes)"
+	    "\n    (with '-I') print only the changes since the index was"
+	    " written, each"
+	    "\n    pathname preceded by '+ ' (added), '- ' (removed) or 'M '"
+	    " (modified)"
 	    "\n  -d (dot-add)"
 	    "\n    prepend a '.' to each path printed"
 	    "\n  -e (no empty dirs)"
@@ -135,9 +1144,29 @@ void usage (const char *format, ...)
 	    "\n    expand each entry's pathname to an absolute pathname"
 	    "\n  -h (help)"
 	    "\n    display this text and terminate"
+	    "\n  -I indexfile (index)"
+	    "\n    maintain an index of the directory tree in 'indexfile' and"
+	    " read only the"
+	    "\n    directories which changed since the index was written (the"
+	    " pathnames are"
+	    "\n    printed sorted)"
+	    "\n  -j N (jobs)"
+	    "\n    scan the directories with N parallel threads (the order of"
+	    " the pathnames"
+	    "\n    is not determined then, unless '-S' is used)"
 	    "\n  -n (no dirs)"
-	    "\n    do not process (print) the pathnames of directories\n",
-	    prog, prog);
+	    "\n    do not process (print) the pathnames of directories"
+	    "\n  -S (sorted)"
+	    "\n    print the pathnames sorted (each directory followed by it's"
+	    " entries)"
+	    "\n  -s (streamed)"
+	    "\n    print each pathname as soon as it is found"
+	    "\n  -W outfile (watch; also '--watch outfile')"
+	    "\n    write the (sorted) list of pathnames into 'outfile' and keep"
+	    " it up to date"
+	    "\n    (replacing it atomically on changes) until terminated by a"
+	    " signal\n",
+	    prog, prog, prog, prog);
     exit (0);
 }
 
@@ -145,14 +1174,18 @@ int main (int argc, char *argv[])
 {
     char *buf = NULL, *path = NULL;
     size_t bufsz = 0;
-    int rc, optx, opt_d = 0, opt_e = 0, opt_f = 0, opt_n = 0;
-    struct pe_data pe;
-    slist_t lp;
+    int rc, optx, opt_d = 0, opt_e = 0, opt_f = 0, opt_n = 0, opt_S = 0;
+    int opt_s = 0, opt_C = 0;
+    int njobs = 0, ix, flags = 0;
+    const char *indexfile = NULL, *watchfile = NULL;
+    struct pe_data pe, *pes = NULL;
+    struct sl_item *it;
     trav_t trav = travdir;
 
     set_prog (argc, argv);
-    pe.cut_prefix = 1; pe.add_dot = 0;
-    pe.prefix = NULL; pe.flf = pe.flp = NULL;
+    memset (&pe, 0, sizeof(pe));
+    pt_init (&pe.tab);
+    pe.cut_prefix = 1; pe.ofd = 1;
 
     if (argc < 2) { usage (NULL); }
     for (optx = 1; optx < argc; ++optx) {
@@ -175,14 +1208,64 @@ int main (int argc, char *argv[])
 	    if (opt_e) { usage ("can't use '-n' and '-e' together"); }
 	    opt_n = 1; continue;
 	}
+	if (!strcmp (argv[optx], "-S")) {
+	    if (opt_s) { usage ("can't use '-S' and '-s' together"); }
+	    opt_S = 1; continue;
+	}
+	if (!strcmp (argv[optx], "-s")) {
+	    if (opt_S) { usage ("can't use '-s' and '-S' together"); }
+	    opt_s = 1; continue;
+	}
+	if (!strcmp (argv[optx], "-0")) { out_sep = '\0'; continue; }
+	if (!strcmp (argv[optx], "-C")) { opt_C = 1; continue; }
+	if (!strncmp (argv[optx], "-W", 2) || !strcmp (argv[optx], "--watch")) {
+	    watchfile = (argv[optx][1] == 'W' ? argv[optx] + 2 : "");
+	    if (!*watchfile) {
+		if (++optx >= argc) { usage ("missing argument for '-W'"); }
+		watchfile = argv[optx];
+	    }
+	    if (!*watchfile) { usage ("invalid argument for '-W'"); }
+	    continue;
+	}
+	if (!strncmp (argv[optx], "-I", 2)) {
+	    indexfile = argv[optx] + 2;
+	    if (!*indexfile) {
+		if (++optx >= argc) { usage ("missing argument for '-I'"); }
+		indexfile = argv[optx];
+	    }
+	    if (!*indexfile) { usage ("invalid argument for '-I'"); }
+	    continue;
+	}
+	if (!strncmp (argv[optx], "-j", 2)) {
+	    const char *arg = argv[optx] + 2;
+	    char *p;
+	    long lv;
+	    if (!*arg) {
+		if (++optx >= argc) { usage ("missing argument for '-j'"); }
+		arg = argv[optx];
+	    }
+	    lv = strtol (arg, &p, 10);
+	    if (p == arg || *p || lv < 1 || lv > 256) {
+		usage ("invalid argument for '-j' (1..256 expected)");
+	    }
+	    njobs = (int) lv; continue;
+	}
 	usage ("invalid option '%s'", argv[optx]);
     }
 
+    if (opt_C && !indexfile) { usage ("'-C' requires '-I'"); }
+    if (indexfile && njobs > 0) { usage ("can't use '-I' and '-j' together"); }
+    if (watchfile && (indexfile || njobs > 0)) {
+	usage ("can't use '-W' together with '-I' or '-j'");
+    }
+
     /* Establish the configuration settings ... */
     if (opt_d) { pe.add_dot = 1; }
-    if (opt_e) { trav = travdirne; }
+    if (opt_e) { trav = travdirne; flags = TRAV_NOEMPTY; }
     if (opt_f) { pe.cut_prefix = 0; }
-    if (opt_n) { trav = travdirnd; }
+    if (opt_s) { pe.stream = 1; }
+    if (opt_n) { trav = travdirnd; flags = TRAV_NODIRS; }
+    if (opt_S) { pe.sort = 1; if (njobs < 1) { njobs = 1; } }
 
     /* Check for one argument (ignore any remaining ones after the first one)
     * ...
@@ -207,18 +1290,88 @@ int main (int argc, char *argv[])
     }
 
     /* Establish the pathname in the configuration ... */
-    pe.prefix = path;
+    pe.prefix = path; pe.prefixlen = strlen (path);
+
+    /* The watch mode (which ends only with a signal) ... */
+    if (watchfile) {
+	rc = w_run (&pe, path, watchfile, flags);
+	if (pe.obuf) { free (pe.obuf); }
+	if (pe.nbuf) { free (pe.nbuf); }
+	free (pe.prefix); pe.prefix = NULL;
+	return (rc ? 1 : 0);
+    }
 
-    /* Traverse through the directory tree specified by the pathname ... */
-    rc = trav (&buf, &bufsz, path, get_filetype, process_entry, (void *) &pe);
+    /* With an index, only the changed directories are read ... */
+    if (indexfile) {
+	rc = ix_run (&pe, path, indexfile, flags, opt_C);
+	if (pe.obuf) { free (pe.obuf); }
+	if (pe.nbuf) { free (pe.nbuf); }
+	free (pe.prefix); pe.prefix = NULL;
+	return (rc ? 1 : 0);
+    }
+
+    /* Traverse through the directory tree specified by the pathname (either
+    ** directly or with a pool of workers, each one collecting the pathnames
+    ** it finds in it's own list) ...
+    */
+    if (njobs > 0) {
+	ifnull (pes = t_allocv (struct pe_data, njobs)) {
+	    fprintf (stderr, "%s: %s\n", prog, strerror (errno)); exit (1);
+	}
+	for (ix = 0; ix < njobs; ++ix) { pes[ix] = pe; }
+	rc = pwalk (path, njobs, flags, get_filetype, pw_process_entry,
+		    NULL, (void *) pes);
+    } else {
+	rc = trav (&buf, &bufsz, path, get_filetype, process_entry,
+		   (void *) &pe);
+    }
     if (rc) { fprintf (stderr, "%s: %s\n", prog, strerror (errno)); exit (1); }
 
-    /* Write the (resulting) list of pathnames to stdout ... */
-    for (lp = pe.flf; lp; lp = lp->next) { printf ("%s\n", lp->sval); }
+    /* Write the (resulting) list of pathnames (or the remaining content of
+    ** the output buffers) to stdout ...
+    */
+    if (opt_s) {
+	rc = 0;
+	if (pes) {
+	    for (ix = 0; ix < njobs; ++ix) {
+		if (out_flush (&pes[ix])) { rc = -1; }
+		if (pes[ix].obuf) { free (pes[ix].obuf); }
+	    }
+	} else {
+	    rc = out_flush (&pe);
+	}
+	if (rc) {
+	    fprintf (stderr, "%s: %s\n", prog, strerror (errno)); exit (1);
+	}
+    } else if (opt_S) {
+	if (write_sorted (pes, njobs, &pe)) {
+	    fprintf (stderr, "%s: %s\n", prog, strerror (errno)); exit (1);
+	}
+    } else if (pes) {
+	for (ix = 0; ix < njobs; ++ix) {
+	    for (it = pes[ix].names.first; it; it = it->next) {
+		fputs (it->str, stdout); putchar (out_sep);
+	    }
+	}
+    } else {
+	for (it = pe.names.first; it; it = it->next) {
+	    fputs (it->str, stdout); putchar (out_sep);
+	}
+    }
     fflush (stdout);
 
     /* Free the allocated memory ... */
-    slist_free (pe.flf);
+    if (pes) {
+	for (ix = 0; ix < njobs; ++ix) {
+	    sl_free (&pes[ix].names);
+	    pt_free (&pes[ix].tab);
+	    if (pes[ix].nbuf) { free (pes[ix].nbuf); }
+	}
+	free (pes);
+    }
+    sl_free (&pe.names);
+    if (pe.obuf) { free (pe.obuf); }
+    if (pe.nbuf) { free (pe.nbuf); }
     free (pe.prefix); pe.prefix = NULL;
 
     /* Return (indicating success) ... */
@@ -13,12 +13,31 @@
 ** brackets and the tags) are included into the generated file.
 **
 ** Synopsis:
-**    hgen -o outfile template [headerfile...]
+**    hgen [-u] [-MD] [-MF depfile] [-MP] -o outfile template [headerfile...]
 **
 ** If '-o outfile' is not supplied, the result is written to stdout ...
 **
+** With '-u', the result is generated in memory and 'outfile' is replaced
+** (atomically, via a temporary file in the same directory) only if its
+** content differs from the result, so the modification time of an unchanged
+** output file is kept.
+**
+** With '-MD' (or '-MF depfile'), a 'make' rule listing the template and all
+** header files actually inserted as the dependencies of 'outfile' is written
+** to 'depfile' (default: 'outfile.d'); '-MP' adds an empty rule for each of
+** these files.
+**
+**    hgen [-u] [-MD] [-MP] [-j N] [-C cachefile] -b manifest
+**
+** The batch mode ('-b') generates all output files listed in 'manifest' in
+** one process, scanning each header file only once (see 'run_batch()'
+** below); '-j N' generates up to N output files in parallel, and
+** '-C cachefile' keeps the scanned export sections between the runs.
+**
 */
 
+#define _GNU_SOURCE
+
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -27,13 +46,20 @@
 #include <errno.h>
 #include <stdarg.h>
 #include <limits.h>
+#include <pthread.h>
+#include <sys/uio.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 
+#include "lib/arena.c"
+#include "lib/arena_strndup.c"
 #include "lib/bn.c"
 #include "lib/fmt.c"
-#include "lib/haseol.c"
-#include "lib/int2str.c"
 #include "lib/isws.c"
+#include "lib/mapfile.c"
 #include "lib/printarg.c"
+#include "lib/strhash.c"
+#include "lib/strlist.c"
 
 #define PROG "hgen"
 
@@ -48,16 +74,6 @@
 */
 #define ERRSTR (strerror (errno))
 
-/* Because i didn't want to handle dynamically allocated lines, i set a
-** maximum line length here. This means that the maximum length of all lines
-** in a header template file cannot exceed the value of `LMAX` (defined here).
-*/
-#if NAME_MAX < 1024
-#define LMAX 1024
-#else
-#define LMAX NAME_MAX
-#endif
-
 /* Marker for the beginning of a section to be exported from the local header
 ** file to output header file.
 */
@@ -70,6 +86,12 @@
 #define ENDTAG "/*##END##*/"
 #define ENDTAG_LEN (sizeof(ENDTAG) - 1)
 
+/* The common prefix of both markers (which is searched for in the header
+** files).
+*/
+#define TAGPFX "/*##"
+#define TAGPFX_LEN (sizeof(TAGPFX) - 1)
+
 /* Marker of the insert point for a specific header file.
 ** OLDER SCHEME: Used for template files consisting of a set of `#include`
 ** preprocessor statements. The name in the `#include` file will be directly
@@ -93,33 +115,442 @@
 */
 static const char *prog;
 
-/* Small function for testing the given line ending with an EOL marker
-** (OS-agnostic).
+/* Write the (non-negative) line number `lc` as a decimal number (with the
+** digits generated directly into `out`, from the end) ...
 */
-static int isateol (const char *s)
+static const char *line2str (int lc, char *out, size_t outsz)
 {
-    while (isws (*s)) { ++s; }
-    if (*s == '\r') {
-	if (!*++s) { return 2; }
-	if (*s == '\n') { return 3; }
-    } else if (*s == '\n') {
-	return 1;
-    }
-    return 0;
+    char tmp[16], *p = tmp + sizeof(tmp);
+    unsigned int v = (unsigned int) lc;
+    size_t len;
+    if (lc < 0) { errno = EINVAL; return NULL; }
+    *--p = '\0';
+    do { *--p = (char) ('0' + v % 10); v /= 10; } while (v > 0);
+    len = (size_t) (tmp + sizeof(tmp) - p);
+    if (len > outsz) { errno = ENOBUFS; return NULL; }
+    memcpy (out, p, len);
+    return out;
 }
 
-static const char *line2str (int lc, char *out, size_t outsz)
+/* The marker lines which are generated for each header file and each of
+** it's export sections. Their formats are parsed only once (by
+** `init_markers()`, before any output is generated).
+*/
+#define LINE_MARKER "# line $1 \"$2\"\n"
+#define FROM_MARKER "/* From: $1 ($2) */\n# line $2 \"$1\"\n"
+#define END_MARKER "/* End $1 (S2) */\n"
+#define EOF_MARKER "/* End $1 ($2) <EOF> */\n"
+
+static struct fmt_spec line_marker, from_marker, end_marker, eof_marker;
+
+static void init_markers (void)
 {
-    if (lc < 0) { errno = EINVAL; return NULL; }
-    return int2str (lc, out, outsz, false);
+    if (fmt_compile (&line_marker, LINE_MARKER)
+    ||  fmt_compile (&from_marker, FROM_MARKER)
+    ||  fmt_compile (&end_marker, END_MARKER)
+    ||  fmt_compile (&eof_marker, EOF_MARKER)) {
+	fmt_print (stderr, "$1: $2\n", prog, ERRSTR);
+	exit (70);
+    }
 }
 
 /* Insert a '#line' preprocessor command into the outfile ... */
 static void line_to (const char *ofname, int lc, FILE *out)
 {
-    char numbuf[32];
+    char numbuf[16];
     line2str (lc, numbuf, sizeof(numbuf));
-    fmt_print (out, "# line $1 \"$2\"\n", numbuf, ofname);
+    fmt_cprint (out, &line_marker, numbuf, ofname);
+}
+
+/* OUTPUT VECTOR for the parts of a header file which are to be exported.
+** The parts are not copied, but written directly from the (mapped) header
+** file with a few `writev()` calls (together with the generated marker
+** lines, which are allocated from the arena `texts`).
+*/
+struct outvec {
+    struct iovec *iov;
+    size_t count, size;
+    struct arena texts;
+};
+
+#define OUTVEC_INIT { NULL, 0, 0, ARENA_INIT }
+
+static void ov_add (struct outvec *ov, const char *data, size_t len)
+{
+    if (len == 0) { return; }
+    if (ov->count >= ov->size) {
+	size_t nsz = (ov->size ? 2 * ov->size : 64);
+	struct iovec *niov = t_realloc (struct iovec, ov->iov, nsz);
+	if (!niov) {
+	    fmt_print (stderr, "$1: $2\n", prog, ERRSTR);
+	    exit (71);
+	}
+	ov->iov = niov; ov->size = nsz;
+    }
+    ov->iov[ov->count].iov_base = (void *) data;
+    ov->iov[ov->count].iov_len = len;
+    ++ov->count;
+}
+
+/* Append a marker line (generated from the pre-parsed format `spec` and the
+** file name `infile` and line number `lc` (if >= 0) as it's arguments) to
+** the output vector. The line is generated directly into it's (exactly
+** sized) place in the arena `texts` ...
+*/
+static void ov_mark (struct outvec *ov, const struct fmt_spec *spec,
+		     const char *infile, int lc)
+{
+    char numbuf[16], *text;
+    const char *args[2] = { infile, numbuf };
+    size_t len;
+    int argc = 1;
+    if (lc >= 0) { line2str (lc, numbuf, sizeof(numbuf)); argc = 2; }
+    len = fmt_clen (spec, argc, args);
+    if (!(text = arena_alloc (&ov->texts, len + 1))) {
+	fmt_print (stderr, "$1: $2\n", prog, ERRSTR);
+	exit (71);
+    }
+    ov_add (ov, text, fmt_cformat (text, spec, argc, args));
+}
+
+/* Write the collected parts to `out` (writing them through the stdio
+** functions only if `out` has no file descriptor) and empty the output
+** vector. Returns 0 on success and -1 (with `errno` set) on failure.
+*/
+static int ov_flush (struct outvec *ov, FILE *out)
+{
+    struct iovec *iov = ov->iov;
+    size_t n = ov->count;
+    ssize_t wr;
+    int fd = fileno (out), rc = 0;
+    if (fd < 0) {
+	for (; n > 0; ++iov, --n) {
+	    if (fwrite (iov->iov_base, 1, iov->iov_len, out) != iov->iov_len) {
+		rc = -1; break;
+	    }
+	}
+    } else if (fflush (out)) {
+	rc = -1;
+    } else {
+	while (n > 0) {
+	    if ((wr = writev (fd, iov, (n > IOV_MAX ? IOV_MAX : n))) < 0) {
+		if (errno == EINTR) { continue; }
+		rc = -1; break;
+	    }
+	    while (n > 0 && (size_t) wr >= iov->iov_len) {
+		wr -= (ssize_t) iov->iov_len; ++iov; --n;
+	    }
+	    if (n > 0) {
+		iov->iov_base = (char *) iov->iov_base + wr;
+		iov->iov_len -= (size_t) wr;
+	    }
+	}
+    }
+    ov->count = 0; arena_free (&ov->texts);
+    return rc;
+}
+
+static void ov_free (struct outvec *ov)
+{
+    cfree (ov->iov); ov->count = ov->size = 0;
+    arena_free (&ov->texts);
+}
+
+/* Return the number of lines terminated within `p` .. `end` ... */
+static int count_lines (const char *p, const char *end)
+{
+    int n = 0;
+    while (p < end && (p = memchr (p, '\n', (size_t) (end - p)))) {
+	++n; ++p;
+    }
+    return n;
+}
+
+/* Return the beginning of the next line (behind `p`) ... */
+static const char *next_line (const char *p, const char *end)
+{
+    const char *q = memchr (p, '\n', (size_t) (end - p));
+    return (q ? q + 1 : end);
+}
+
+/* Return the next line in `p` .. `end` which begins with the common prefix
+** of the markers (or `end` if there is none). `base` is the beginning of
+** the header file.
+*/
+static const char *next_marker (const char *base, const char *p,
+				const char *end)
+{
+    const char *q;
+    while (p < end && (q = memmem (p, (size_t) (end - p), TAGPFX,
+				   TAGPFX_LEN))) {
+	if (q == base || q[-1] == '\n') { return q; }
+	p = q + TAGPFX_LEN;
+    }
+    return end;
+}
+
+/* Check if the line `p` consists of the marker `tag` (optionally followed
+** by blanks) ...
+*/
+static bool is_marker (const char *p, const char *end,
+		       const char *tag, size_t taglen)
+{
+    if ((size_t) (end - p) < taglen || memcmp (p, tag, taglen) != 0) {
+	return false;
+    }
+    p += taglen; while (p < end && isws (*p)) { ++p; }
+    if (p >= end) { return false; }
+    if (*p == '\r') { return (p + 1 == end || p[1] == '\n'); }
+    return *p == '\n';
+}
+
+/* Collect the parts of the header file `infile` (with the content `data`
+** of the length `size`) which are enclosed into BEGINTAG and ENDTAG - and
+** the lines marking them - in the output vector `ov`. `*_lines` is set to
+** the number of lines this adds to the line counter of the template. Returns
+** 0 on success and -1 if the last section isn't terminated.
+*/
+static int export_parts (const char *infile, const char *data, size_t size,
+			 struct outvec *ov, int *_lines)
+{
+    const char *base = data, *end = data + size, *p = data, *q;
+    const char *sect = NULL, *counted = data;
+    bool inserting = false;
+    int lc = 0, tlc = 0, rc = 0;
+    /* (`lc` is the number of lines before `counted`) */
+    while ((q = next_marker (base, p, end)) < end) {
+	p = next_line (q, end);
+	if (is_marker (q, end, BEGINTAG, BEGINTAG_LEN)) {
+	    lc += count_lines (counted, q); counted = q;
+	    if (inserting) {
+		ov_add (ov, sect, (size_t) (q - sect));
+	    } else {
+		ov_mark (ov, &from_marker, infile, lc + 2);
+		++tlc;
+	    }
+	    inserting = true; sect = p;
+	} else if (is_marker (q, end, ENDTAG, ENDTAG_LEN)) {
+	    if (inserting) {
+		ov_add (ov, sect, (size_t) (q - sect));
+		ov_mark (ov, &end_marker, infile, -1);
+		++tlc;
+	    }
+	    inserting = false;
+	}
+    }
+    lc += count_lines (counted, end);
+    if (end > base && end[-1] != '\n') { ++lc; }
+    tlc += lc;
+    if (inserting) {
+	ov_add (ov, sect, (size_t) (end - sect));
+	ov_mark (ov, &eof_marker, infile, lc);
+	++tlc; rc = -1;
+    }
+    *_lines = tlc;
+    return rc;
+}
+
+/* CACHE of the export sections of the header files (batch mode). Each
+** header file is scanned only once; the text `copy_header_parts()` writes
+** for it is stored together with the number of lines this adds to the line
+** counter of the template, the result of `export_parts()` and the
+** modification time and size of the file, so an entry can be persisted
+** (`-C cachefile`) and re-used as long as the file remains unchanged.
+*/
+struct hdr_parts {
+    const char *path;
+    char *text;
+    size_t len;
+    long long mtime, size;
+    long mtime_ns;
+    int lines, rc;
+    bool valid, used;
+};
+
+struct hdr_cache {
+    struct strhash index;	/* path -> position in `v` */
+    struct hdr_parts *v;
+    size_t count, size;
+};
+
+#define HDR_CACHE_INIT { STRHASH_INIT, NULL, 0, 0 }
+
+#define HDR_CACHE_MAGIC "hgen-cache 1\n"
+#define HDR_CACHE_MAGIC_LEN (sizeof(HDR_CACHE_MAGIC) - 1)
+
+/* The cache `copy_header_parts()` uses (only in the batch mode). It isn't
+** modified while the output files are generated, so the workers need no
+** locking for reading it.
+*/
+static struct hdr_cache *hcache = NULL;
+
+static struct hdr_parts *hc_find (struct hdr_cache *hc, const char *path)
+{
+    struct sh_entry *e = sh_lookup (&hc->index, path);
+    return (e ? &hc->v[e->value] : NULL);
+}
+
+/* Return the (new or already existing) entry of `path` ... */
+static struct hdr_parts *hc_add (struct hdr_cache *hc, const char *path)
+{
+    struct hdr_parts *hp;
+    struct sh_entry *e;
+    int is_new = 0;
+    if (hc->count >= hc->size) {
+	size_t nsz = (hc->size ? 2 * hc->size : 256);
+	if (!(hp = t_realloc (struct hdr_parts, hc->v, nsz))) { return NULL; }
+	hc->v = hp; hc->size = nsz;
+    }
+    if (!(e = sh_insert (&hc->index, path, (int) hc->count, &is_new))) {
+	return NULL;
+    }
+    if (! is_new) { return &hc->v[e->value]; }
+    hp = &hc->v[hc->count++]; memset (hp, 0, sizeof(*hp));
+    hp->path = e->key;
+    return hp;
+}
+
+/* (Re-)scan the header file of the entry `hp` - unless the entry is still
+** valid. A header file which can't be read leaves the entry invalid, so the
+** error is reported when the file is processed.
+*/
+static void hc_scan (struct hdr_parts *hp)
+{
+    struct outvec ov = OUTVEC_INIT;
+    struct mapfile mf;
+    struct stat sb;
+    size_t ix;
+    char *p;
+    if (stat (hp->path, &sb)) { hp->valid = false; return; }
+    if (hp->valid && hp->mtime == (long long) sb.st_mtim.tv_sec
+    &&  hp->mtime_ns == sb.st_mtim.tv_nsec
+    &&  hp->size == (long long) sb.st_size) {
+	return;
+    }
+    hp->valid = false; cfree (hp->text); hp->len = 0;
+    if (mf_open (&mf, hp->path)) { return; }
+    hp->rc = export_parts (hp->path, mf.data, mf.size, &ov, &hp->lines);
+    for (ix = 0; ix < ov.count; ++ix) { hp->len += ov.iov[ix].iov_len; }
+    if ((hp->text = p = malloc (hp->len + 1))) {
+	for (ix = 0; ix < ov.count; ++ix) {
+	    memcpy (p, ov.iov[ix].iov_base, ov.iov[ix].iov_len);
+	    p += ov.iov[ix].iov_len;
+	}
+	hp->mtime = (long long) sb.st_mtim.tv_sec;
+	hp->mtime_ns = sb.st_mtim.tv_nsec;
+	hp->size = (long long) sb.st_size;
+	hp->valid = true;
+    }
+    ov_free (&ov); mf_close (&mf);
+}
+
+/* Load the persisted cache `path` (a missing file is an empty cache). Each
+** entry consists of a line
+**    path TAB mtime.ns TAB size TAB lines TAB rc TAB length
+** followed by `length` bytes of text. Returns 0 on success and -1 if the
+** file couldn't be read or has an invalid format.
+*/
+static int hc_load (struct hdr_cache *hc, const char *path)
+{
+    struct mapfile mf;
+    struct hdr_parts *hp;
+    const char *p, *end, *q;
+    char *line = NULL, *fld[6], *r;
+    long long len;
+    int ix, rc = -1;
+    if (mf_open (&mf, path)) { return (errno == ENOENT ? 0 : -1); }
+    p = mf.data; end = p + mf.size;
+    if (mf.size < HDR_CACHE_MAGIC_LEN
+    ||  memcmp (p, HDR_CACHE_MAGIC, HDR_CACHE_MAGIC_LEN) != 0) {
+	goto CLEANUP;
+    }
+    p += HDR_CACHE_MAGIC_LEN;
+    while (p < end) {
+	if (!(q = memchr (p, '\n', (size_t) (end - p)))) { goto CLEANUP; }
+	if (!(r = realloc (line, (size_t) (q - p) + 1))) { goto CLEANUP; }
+	line = r; memcpy (line, p, (size_t) (q - p)); line[q - p] = '\0';
+	p = q + 1;
+	for (ix = 0, r = line; ix < 6; ++ix) {
+	    fld[ix] = r;
+	    if (ix < 5) {
+		if (!(r = strchr (r, '\t'))) { goto CLEANUP; }
+		*r++ = '\0';
+	    }
+	}
+	len = strtoll (fld[5], NULL, 10);
+	if (len < 0 || len > (long long) (end - p)) { goto CLEANUP; }
+	if (!(hp = hc_add (hc, fld[0]))) { goto CLEANUP; }
+	cfree (hp->text);
+	if (!(hp->text = malloc ((size_t) len + 1))) { goto CLEANUP; }
+	memcpy (hp->text, p, (size_t) len); hp->len = (size_t) len;
+	p += len;
+	hp->mtime = strtoll (fld[1], &r, 10);
+	hp->mtime_ns = (*r == '.' ? strtol (r + 1, NULL, 10) : 0);
+	hp->size = strtoll (fld[2], NULL, 10);
+	hp->lines = (int) strtol (fld[3], NULL, 10);
+	hp->rc = (int) strtol (fld[4], NULL, 10);
+	hp->valid = true;
+    }
+    rc = 0;
+CLEANUP:
+    cfree (line); mf_close (&mf);
+    if (rc) { errno = EINVAL; }
+    return rc;
+}
+
+/* Write the (valid) entries of the cache into the memory stream `out` ... */
+static void hc_dump (struct hdr_cache *hc, FILE *out)
+{
+    struct hdr_parts *hp;
+    size_t ix;
+    fputs (HDR_CACHE_MAGIC, out);
+    for (ix = 0; ix < hc->count; ++ix) {
+	hp = &hc->v[ix];
+	if (! hp->valid || strpbrk (hp->path, "\t\n")) { continue; }
+	fprintf (out, "%s\t%lld.%09ld\t%lld\t%d\t%d\t%zu\n", hp->path,
+		 hp->mtime, hp->mtime_ns, hp->size, hp->lines, hp->rc,
+		 hp->len);
+	fwrite (hp->text, 1, hp->len, out);
+    }
+}
+
+static void hc_free (struct hdr_cache *hc)
+{
+    size_t ix;
+    for (ix = 0; ix < hc->count; ++ix) { cfree (hc->v[ix].text); }
+    cfree (hc->v); hc->count = hc->size = 0;
+    sh_free (&hc->index);
+}
+
+/* DEPENDENCIES of an output file ('-MD'): the template and each header file
+** whose export sections were inserted (in the order of their first use).
+** The list is per thread, as the workers of the batch mode generate
+** different output files concurrently; `deps` is NULL if no dependencies
+** are to be collected.
+*/
+struct deplist {
+    struct strlist names;
+    struct strhash seen;
+};
+
+#define DEPLIST_INIT { STRLIST_INIT, STRHASH_INIT }
+
+static __thread struct deplist *deps = NULL;
+
+static void dep_add (const char *name)
+{
+    int is_new = 0;
+    if (! deps) { return; }
+    if (! sh_insert (&deps->seen, name, 0, &is_new)
+    ||  (is_new && ! sl_append (&deps->names, name))) {
+	fmt_print (stderr, "$1: $2\n", prog, ERRSTR);
+	exit (71);
+    }
+}
+
+static void dep_free (struct deplist *dl)
+{
+    sl_free (&dl->names); sh_free (&dl->seen);
 }
 
 /* Copy each part of 'infile' which is enclosed into BEGINTAG and ENDTAG into
@@ -130,66 +561,44 @@ static void line_to (const char *ofname, int lc, FILE *out)
 ** (even zero). The only thing important here is that each of these sections
 ** must begin with the export marker and end with the end marker.
 **
-** The line size in the template file is limited to `LMAX` bytes, but this
-** doesn't mean that parts of the header files inserted are in any way limited.
+** The header file is mapped into memory and only searched for the markers;
+** the parts between them are written directly from the mapped file, so
+** their lines aren't limited in any way. In the batch mode, the text of a
+** header file is taken from the cache (`hcache`) if it is there.
 ** 
 */
 static int copy_header_parts (const char *infile, const char *tfname,
 			      int *_tlc, FILE *out)
 {
-    FILE *in;
-    bool inserting = false;
-    int lc = 0, tlc = *_tlc, waseol;
-    char line[1024], numbuf[32];
-    if (!(in = fopen (infile, "r"))) {
-	line2str (tlc, numbuf, sizeof(numbuf));
+    struct mapfile mf = { NULL, 0, 0 };
+    struct outvec ov = OUTVEC_INIT;
+    struct hdr_parts *hp;
+    int lines = 0, rc;
+    char numbuf[32];
+    if (hcache && (hp = hc_find (hcache, infile)) && hp->used && hp->valid) {
+	ov_add (&ov, hp->text, hp->len);
+	lines = hp->lines; rc = hp->rc;
+	dep_add (infile);
+    } else if (mf_open (&mf, infile) == 0) {
+	rc = export_parts (infile, mf.data, mf.size, &ov, &lines);
+	dep_add (infile);
+    } else {
+	line2str (*_tlc, numbuf, sizeof(numbuf));
 	fmt_print (stderr, "$1: in $2(line $3): $4, $5\n",
 			    prog, tfname, numbuf, infile, ERRSTR);
 	fmt_print (out, "#error \"$1\" - $2\n", infile, ERRSTR);
-	*_tlc = tlc;
 	return -1;
     }
-    waseol = 1;
-    while (fgets (line, sizeof(line), in)) {
-	++lc;
-	if (waseol) {
-	    ++tlc;
-	    if (streqn (line, BEGINTAG, BEGINTAG_LEN) &&
-		isateol (line + BEGINTAG_LEN)) {
-		if (! inserting) {
-		    line2str (lc + 1, numbuf, sizeof(numbuf));
-		    fmt_print (out, "/* From: $1 ($2) */\n", infile, numbuf);
-		    line_to (infile, lc + 1, out);
-		    ++tlc;
-		}
-		inserting = true;
-	    } else if (streqn (line, ENDTAG, ENDTAG_LEN) &&
-		       isateol (line + ENDTAG_LEN)) {
-		if (inserting) {
-		    line2str (lc - 1, numbuf, sizeof(numbuf));
-		    fmt_print (out, "/* End $1 (S2) */\n", infile, numbuf);
-		    ++tlc;
-		}
-		inserting = false;
-	    } else {
-		if (inserting) { fputs (line, out); }
-		//if (tf) { fputs (line, out); }
-	    }
-	    waseol = haseol (line);
-	} else {
-	    if (inserting) { fputs (line, out); }
-	    //if (tf) { fputs (line, out); }
-	    waseol = haseol (line);
-	}
-    }
-    fclose (in);
-    if (inserting) {
-	line2str (lc, numbuf, sizeof(numbuf));
-	fmt_print (out, "/* End $1 ($2) <EOF> */\n", infile, numbuf);
-	++tlc; *_tlc = tlc; errno = EOVERFLOW; return -1;
+    *_tlc += lines;
+    if (ov_flush (&ov, out)) {
+	fmt_print (stderr, "$1: $2: writing the output failed - $3\n",
+			   prog, infile, ERRSTR);
+	rc = -1;
+    } else if (rc) {
+	errno = EOVERFLOW;
     }
-    *_tlc = tlc;
-    return 0;
+    ov_free (&ov); mf_close (&mf);
+    return rc;
 }
 
 static const char *find_file (const char *file,
@@ -204,70 +613,34 @@ static const char *find_file (const char *file,
     return NULL;
 }
 
-/* LIST TYPE for collecting the template lines.
+/* The TEMPLATE is read into one buffer, where each line (including it's line
+** terminator) is followed by a NUL character, so the lines can be processed
+** as strings. `lines[ix]` is the position of the line `ix` in this buffer,
+** `lines[count]` the position behind the last line; `maxlen` is the length
+** of the longest line. The length of the lines isn't limited.
 */
-typedef struct lines *lines_t;
-struct lines {
-    lines_t next;
-    bool continued;
-    char text[1];
+struct template {
+    char *text;
+    size_t *lines;
+    size_t count, maxlen;
 };
 
-/* Add a line (or line continuation) to the given list of lines.
-** Lines seemingly too long will be splitted into multiple entries with the
-** `continued` flag of the first line and all continuations (save from the
-** last one) being set.
-*/
-static void add_line (lines_t *_first, lines_t *_last, const char *text,
-		      bool cl)
-{
-    lines_t res = (lines_t) malloc (sizeof (struct lines) + strlen (text) + 1);
-    if (!res) {
-	fmt_print (stderr, "$1: $2\n", prog, ERRSTR);
-	exit (71);
-    }
-    res->next = (lines_t) NULL;
-    res->continued = cl;
-    strcpy (res->text, text);
-    if (*_first) { (*_last)->next = res; } else { (*_first) = res; }
-    (*_last) = res;
-}
-
-/* Deallocate the complete list of lines. The given parameter (if not `NULL`)
-** must point to a pointer variable pointing to a line list. This parameter is
-** an in/out parameter, meaning; the variable pointed to by it will be set to
-** `NULL` at the end of this function.
-** The error state (`errno`) is preserved.
-*/
-static void free_lines (lines_t *_first)
-{
-    if (_first) {
-	int ec = errno;
-	while (*_first) {
-	    lines_t next = (*_first)->next;
-	    (*_first)->next = (lines_t) NULL;
-	    memset ((*_first)->text, 0, strlen ((*_first)->text));
-	    free ((*_first));
-	    *_first = next;
-	}
-	errno = ec;
-    }
-}
+#define TEMPLATE_INIT { NULL, NULL, 0, 0 }
+#define tpl_line(t, ix) ((t)->text + (t)->lines[ix])
+#define tpl_linelen(t, ix) ((t)->lines[(ix) + 1] - (t)->lines[ix] - 1)
 
-/* Read a header template from a given file and store it in a list whose
-** starting element is returned through the parameter `out`.
-** Any line which is too long is splitted, but a warning about this case
-** is written to `stderr`. This functions returns either `-1` (if opening
-** the template file failed), or the number of lines recognised as too long
-** (which should be `0` in normal circumstances).
+/* Read a header template from a given file into `t`. Returns `0` on
+** success and `-1` (with an error message written) if the template file
+** couldn't be read.
 */
-static int read_template (const char *tfname, lines_t *_out)
+static int read_template (const char *tfname, struct template *t)
 {
-    int ec, errc;	/* errno saver, error counter */
-    FILE *tf;
-    lines_t first = (lines_t) NULL, last = (lines_t) NULL;
-    char line[LMAX + 20], numbuf[32]; int lc;
-    if (!(tf = fopen (tfname, "r"))) {
+    struct mapfile mf;
+    const char *p, *q, *end;
+    size_t n, ix, len;
+    char *r;
+    int ec;
+    if (mf_open (&mf, tfname)) {
 	ec = errno;
 	fmt_print (stderr,
 		   "$1: Attempt to open the template file failed - $2\n",
@@ -275,62 +648,36 @@ static int read_template (const char *tfname, lines_t *_out)
 	errno = ec;
 	return -1;
     }
-    lc = 0; errc = 0;
-    while (fgets (line, sizeof(line), tf)) {
-	int eol = haseol (line);
-	++lc; add_line (&first, &last, line, (eol == 0));
-	if (! eol) {
-	    line2str (lc, numbuf, sizeof(numbuf));
-	    fmt_print (stderr, "$1($2): WARNING! Line too long ...\n",
-			       tfname, numbuf);
-	    ++errc;
-	    while (fgets (line, sizeof(line), tf)) {
-		eol = haseol (line);
-		add_line (&first, &last, line, (eol == 0));
-		if (eol > 0) { break; }
-	    }
-	}
+    end = mf.data + mf.size;
+    n = (size_t) count_lines (mf.data, end);
+    if (mf.size > 0 && end[-1] != '\n') { ++n; }
+    t->text = malloc (mf.size + n + 1);
+    t->lines = t_allocv (size_t, n + 1);
+    if (!t->text || !t->lines) {
+	fmt_print (stderr, "$1: $2\n", prog, ERRSTR);
+	exit (71);
     }
-    fclose (tf);
-    /* The `continued` flag of the (last part of the) last line should always
-    ** be reset - evfen if the line doesn't contain a line terminator. In the
-    ** M$ world, this seems to be the regular case.
-    **
-    ** ATTENTION! the lines list of the template may be empty, so last
-    ** can have a `NULL` value. So, only if `last` is not `NULL`, the
-    ** `continued` can be modified.
-    */
-    if (last) { last->continued = false; }
-    *_out = first;
-    return errc;	// Return the number 
+    t->maxlen = 0;
+    for (p = mf.data, r = t->text, ix = 0; p < end; ++ix, p = q) {
+	q = next_line (p, end); len = (size_t) (q - p);
+	t->lines[ix] = (size_t) (r - t->text);
+	memcpy (r, p, len); r[len] = '\0'; r += len + 1;
+	if (len > t->maxlen) { t->maxlen = len; }
+    }
+    t->lines[ix] = (size_t) (r - t->text); t->count = ix;
+    mf_close (&mf);
+    return 0;
 }
 
-/* Send the remaining lines of the template (after the last import marker was
-** found) to the given file `out` or simply skip them.
-** The schema is as follows:
-**   During reading the line (`read_template()`) lines longer than the maximum
-**   buffer length are split, so that for all parts without a line terminator
-**   (EOL) the `continued` flag is set. If the (part of) the line containing
-**   the line terminator is found, its `continued` flag is reset - indicating
-**   that the line is now complete.
-*/
-static lines_t process_remaining (lines_t cline, int skip_text, FILE *out)
+static void free_template (struct template *t)
 {
-    if (cline) {
-	if (skip_text) {
-	    while (cline && cline->continued) { cline = cline->next; }
-	} else {
-	    while (cline && cline->continued) {
-		fputs (cline->text, out);
-		cline = cline->next;
-	    }
-	    // print the remaining part of the line
-	    if (cline) { fputs (cline->text, out); }
-	}
-	// Skip the remaining part of the line
-	if (cline) { cline = cline->next; }
-    }
-    return cline;
+    cfree (t->text); cfree (t->lines); t->count = t->maxlen = 0;
+}
+
+/* Write the line `ix` of the template to the given file `out` ... */
+static void put_line (const struct template *t, size_t ix, FILE *out)
+{
+    fwrite (tpl_line (t, ix), 1, tpl_linelen (t, ix), out);
 }
 
 #if 0
@@ -432,7 +779,7 @@ static int chk_include_stmt (const char *line,
 /* Write an `#error` directive about an invalid `#include` line to the
 ** output file `out`.
 */
-static void invalid_include (FILE *out, int lc, bool is_import, int ec,
+static void invalid_include (FILE *out, bool is_import, int ec,
 			     const char *ifname)
 {
     const char *impincl = (is_import ? "#import" : "#include");
@@ -464,14 +811,21 @@ static void invalid_include (FILE *out, int lc, bool is_import, int ec,
 ** of `tfname` in the template file is replaced with the name of the
 ** output file ...
 */
-static int import_via_tag (lines_t cline,
+static int import_via_tag (const struct template *t,
 			   size_t filesc, char *const *files,
 			   const char *ofname, FILE *out)
 {
     int errs = 0, lc = 0, isinc;
     bool need_skip = false, tag_processed = false, is_import = false;
-    char ifname[LMAX + 1];
-    while (cline) {
+    char *ifname;
+    const char *line;
+    size_t lx;
+    if (!(ifname = malloc (t->maxlen + 1))) {
+	fmt_print (stderr, "$1: $2\n", prog, ERRSTR);
+	exit (71);
+    }
+    for (lx = 0; lx < t->count; ++lx) {
+	line = tpl_line (t, lx);
 	++lc;
 	/* Deactivate each '#include "file"' or '#include <file>'-line
 	** where 'file' is found in the list of files to be (partially)
@@ -480,8 +834,7 @@ static int import_via_tag (lines_t cline,
 	** error line ...
 	*/
 	need_skip = false;
-	isinc = chk_include_stmt (cline->text, ifname, sizeof(ifname),
-				  &is_import);
+	isinc = chk_include_stmt (line, ifname, t->maxlen + 1, &is_import);
 	if (isinc == 0) {
 	    const char *ifn = ifname;
 	    int ec = 0;
@@ -495,19 +848,19 @@ static int import_via_tag (lines_t cline,
 		} else if (is_import) {
 		    ec = EPERM;
 		}
-		invalid_include (out, lc, is_import, ec, ifn);
+		invalid_include (out, is_import, ec, ifn);
 		fflush (out);
 	    }
 	} else if (isinc < 0) {
 	    const char *ifn = ifname;
 	    need_skip = true;
 	    if (errno == EINVAL) { ifn = NULL; }
-	    invalid_include (out, lc, is_import, errno, ifn);
+	    invalid_include (out, is_import, errno, ifn);
 	    fflush (out);
-	} else if (is_import_tag (cline->text)) {
+	} else if (is_import_tag (line)) {
 	    need_skip = true;
 	    if (! tag_processed) {
-		for (int ix = 0; ix < filesc; ++ix) {
+		for (size_t ix = 0; ix < filesc; ++ix) {
 		    const char *ifn = files[ix];
 		    if (copy_header_parts (ifn, ofname, &lc, out)) { ++errs; }
 		}
@@ -517,23 +870,30 @@ static int import_via_tag (lines_t cline,
 	} else {
 	    need_skip = false;
 	}
-	cline = process_remaining (cline, need_skip, out);
+	if (! need_skip) { put_line (t, lx, out); }
     }
+    free (ifname);
     return errs;
 }
 
 
-static int import_via_include (lines_t cline,
+static int import_via_include (const struct template *t,
 			       size_t filesc, char *const *files,
 			       const char *ofname, FILE *out)
 {
     bool is_import = false, need_skip = false;;
-    char ifname[LMAX + 1];
+    char *ifname;
+    const char *line;
     int lc = 0, errs = 0, isinc;
-    while (cline) {
+    size_t lx;
+    if (!(ifname = malloc (t->maxlen + 1))) {
+	fmt_print (stderr, "$1: $2\n", prog, ERRSTR);
+	exit (71);
+    }
+    for (lx = 0; lx < t->count; ++lx) {
+	line = tpl_line (t, lx);
 	++lc;
-	isinc = chk_include_stmt (cline->text, ifname, sizeof(ifname),
-				  &is_import);
+	isinc = chk_include_stmt (line, ifname, t->maxlen + 1, &is_import);
 	if (isinc == 0) {
 	    /* A valid `#import` or `#include` statement was found. */
 	    const char *ifn = NULL;
@@ -545,48 +905,35 @@ static int import_via_include (lines_t cline,
 	    if (ifn) {
 		if (copy_header_parts (ifn, ofname, &lc, out)) { ++errs; }
 		line_to (ofname, lc, out);
-		need_skip = true;	// Skip the remaining parts of the line.
-	    } else {
+	    } else if (is_import) {
 		/* Converting an `#import` statement into an equivalent
 		** `#include` statement, because `#import` was never really
 		** supported by the C/C++ standards.
 		*/
-		int pos = 0;
-		(void) is_include_cmd (cline->text, &is_import, &pos);
-		if (is_import) {
-		    int blanks = pos - 7;
-		    fputc ('#', out);
-		    while (blanks-- > 0) { fputc (' ', out); }
-		    fputs ("include", out);
-		    fputs (cline->text + pos, out);
-		} else {
-		    fputs (cline->text, out);
-		}
-		/* The (first part of) the line is now processed. Any
-		** remaining parts are processed with `process_remaining()`.
-		*/
-		cline = cline->next;
-		need_skip = false;
+		const char *p = line;
+		while (isws (*++p));
+		fwrite (line, 1, (size_t) (p - line), out);
+		fputs ("include", out);
+		fputs (p + 6, out);
+	    } else {
+		put_line (t, lx, out);
 	    }
+	    need_skip = true;	// The line is processed.
 	} else if (isinc < 0) {
 	    /* An error occurred. In this case, an `#error` pre-processor
 	    ** command should be inserted instead of the broken line.
 	    */
-	    invalid_include (out, lc, is_import, errno, ifname);
-	    need_skip = true;	// Skip the remaining parts of the line.
-	} else if (isinc > 0) {
+	    invalid_include (out, is_import, errno, ifname);
+	    need_skip = true;	// Skip the line.
+	} else {
 	    /* No error, but a normal line of the template (no `#import` or
-	    ** `#include` preprocessor statement. This should be handled
-	    ** through `process_remaining()`, so `need_skip` must be set to
-	    ** false, here.
+	    ** `#include` preprocessor statement), which is copied.
 	    */
 	    need_skip = false;
 	}
-	/* Process the remaining parts of a line - either by writing
-	** them out, or by simply skipping them.
-	*/
-	cline = process_remaining (cline, need_skip, out);
+	if (! need_skip) { put_line (t, lx, out); }
     }
+    free (ifname);
     return errs;
 }
 
@@ -596,30 +943,28 @@ static int import_via_include (lines_t cline,
 static int write_header_file (const char *tfname, const char *ofname,
 			      int filesc, char *const *files, FILE *out)
 {
-    int lc = 0, errs = 0, impmode = 0;
+    int errs = 0, impmode = 0;
     char numbuf[32];
-    lines_t template = (lines_t) NULL, cline;
-    if (read_template (tfname, &template)) {
-	free_lines (&template); return -1;
-    }
-    lc = 0; cline = template;
+    struct template template = TEMPLATE_INIT;
+    size_t lx;
+    if (read_template (tfname, &template)) { return -1; }
+    dep_add (tfname);
     /* Searching for an import tag in the template. If such a tag is found,
     ** all other import tags are ignored and the `#include` lines are inserted
     ** verbosely into the output file.
     ** In the first step, the number of import tags within the template is
     ** counted.
     */
-    while (cline) {
-	if (is_import_tag (cline->text)) {
+    for (lx = 0; lx < template.count; ++lx) {
+	if (is_import_tag (tpl_line (&template, lx))) {
 	    if (impmode > 0) {
-		line2str (lc, numbuf, sizeof(numbuf));
+		line2str ((int) lx + 1, numbuf, sizeof(numbuf));
 		fmt_print (stderr,
 		    "$1($2): Ignoring further occurrences of the import tag.\n",
 		    tfname, numbuf);
 	    }
 	    ++impmode;
 	}
-	cline = process_remaining (cline, 1, out);
     }
     if (impmode > 0) {
 	/* Create an output file where all include-files given as arguments
@@ -630,18 +975,381 @@ static int write_header_file (const char *tfname, const char *ofname,
 	** of `tfname` in the template file is replaced with the name of the
 	** output file ...
 	*/
-	errs = import_via_tag (template, filesc, files, ofname, out);
+	errs = import_via_tag (&template, filesc, files, ofname, out);
     } else {
 	/* Revert to the original mode of action ... */
-	errs = import_via_include (template, filesc, files, ofname, out);
+	errs = import_via_include (&template, filesc, files, ofname, out);
     }
 
     /* Free the "memory" version of the template file ... */
-    free_lines (&template);
+    free_template (&template);
     /* Return the number of errors occured while inserting ... */
     return errs;
 }
 
+/* Write `len` bytes of `data` to the file descriptor `fd` ... */
+static int write_all (int fd, const char *data, size_t len)
+{
+    ssize_t wr;
+    while (len > 0) {
+	if ((wr = write (fd, data, len)) < 0) {
+	    if (errno == EINTR) { continue; }
+	    return -1;
+	}
+	data += wr; len -= (size_t) wr;
+    }
+    return 0;
+}
+
+/* Replace the file `path` with `data` (of the length `len`) - but (if
+** `changed_only` is set) only if the content of `path` differs from `data`.
+** The new content is written to a temporary file in the same directory,
+** which is then renamed to `path`. The permissions of an existing `path`
+** are kept. Returns 1 if `path` was replaced, 0 if it was left unchanged and
+** -1 (with `errno` set) on error.
+*/
+static int update_file (const char *path, const char *data, size_t len,
+			bool changed_only)
+{
+    struct mapfile mf;
+    struct stat sb;
+    mode_t mode;
+    char *tmp;
+    int fd, ec;
+    if (! changed_only) {
+	/* (No comparison) */
+    } else if (mf_open (&mf, path) == 0) {
+	bool same = (mf.size == len && memcmp (mf.data, data, len) == 0);
+	mf_close (&mf);
+	if (same) { return 0; }
+    } else if (errno != ENOENT) {
+	return -1;
+    }
+    if (stat (path, &sb) == 0) {
+	mode = sb.st_mode & 07777;
+    } else {
+	mode = umask (0); umask (mode); mode = 0666 & ~mode;
+    }
+    if (!(tmp = malloc (strlen (path) + 8))) { return -1; }
+    strcpy (tmp, path); strcat (tmp, ".XXXXXX");
+    if ((fd = mkstemp (tmp)) < 0) { ec = errno; goto ERROUT; }
+    if (write_all (fd, data, len) || fchmod (fd, mode)) {
+	ec = errno; close (fd); unlink (tmp); goto ERROUT;
+    }
+    if (close (fd) || rename (tmp, path)) {
+	ec = errno; unlink (tmp); goto ERROUT;
+    }
+    free (tmp);
+    return 1;
+ERROUT:
+    free (tmp); errno = ec;
+    return -1;
+}
+
+/* Write a name to a dependency file (escaping the characters which are
+** special for `make`) ...
+*/
+static void put_depname (const char *name, FILE *out)
+{
+    const char *p;
+    for (p = name; *p; ++p) {
+	if (*p == ' ' || *p == '#') {
+	    fputc ('\\', out);
+	} else if (*p == '$') {
+	    fputc ('$', out);
+	}
+	fputc (*p, out);
+    }
+}
+
+/* Write the dependencies `dl` of `target` as a `make` rule into `depfile`
+** (and - if `phony` is set - an empty rule for each dependency, so `make`
+** doesn't fail if one of them is removed). Returns 0 on success and -1
+** (with an error message written) on failure.
+*/
+static int write_depfile (const char *depfile, const char *target,
+			  struct deplist *dl, bool phony)
+{
+    struct sl_item *it;
+    char *buf = NULL;
+    size_t bufsz = 0;
+    FILE *out;
+    int rc;
+    if (!(out = open_memstream (&buf, &bufsz))) {
+	fmt_print (stderr, "$1: $2\n", prog, ERRSTR);
+	exit (71);
+    }
+    put_depname (target, out); fputc (':', out);
+    for (it = dl->names.first; it; it = it->next) {
+	fputs (" \\\n ", out); put_depname (it->str, out);
+    }
+    fputc ('\n', out);
+    for (it = (phony ? dl->names.first : NULL); it; it = it->next) {
+	fputc ('\n', out); put_depname (it->str, out); fputs (":\n", out);
+    }
+    fclose (out);
+    if ((rc = update_file (depfile, buf, bufsz, true)) < 0) {
+	fmt_print (stderr, "$1: $2 - $3\n", prog, depfile, ERRSTR);
+    }
+    free (buf);
+    return (rc < 0 ? -1 : 0);
+}
+
+/* Return the name of the default dependency file of `output` (with `.d`
+** appended) ...
+*/
+static char *depfile_of (const char *output)
+{
+    char *res = malloc (strlen (output) + 3);
+    if (!res) {
+	fmt_print (stderr, "$1: $2\n", prog, ERRSTR);
+	exit (71);
+    }
+    strcpy (res, output); strcat (res, ".d");
+    return res;
+}
+
+/* BATCH MODE: generate a set of output files (given in a manifest file) in
+** one process. Each line of the manifest (except for empty lines and lines
+** beginning with a `#`) describes one output file:
+**    output-header header-template [header-file...]
+** (with the names separated by blanks). All header files named in the
+** manifest are scanned first (in parallel), filling the cache of export
+** sections; then the output files are generated (in parallel, each one by
+** one worker) from the cache.
+*/
+struct hgen_job {
+    const char *output, *template;
+    int filesc;
+    char **files;
+};
+
+struct hgen_batch {
+    struct hgen_job *jobs;
+    int njobs;
+    size_t *scan;	/* positions of the cache entries to be scanned */
+    int nscan;
+    bool update, depend, phony;
+    pthread_mutex_t lock;
+    int next, errs;
+};
+
+/* Read the manifest `path`; the names are allocated from the arena `pool`.
+** Returns the number of jobs or -1 on error.
+*/
+static int read_manifest (const char *path, struct arena *pool,
+			  struct hgen_job **_jobs)
+{
+    struct mapfile mf;
+    struct hgen_job *jobs = NULL, *nj, *job;
+    const char *p, *end, *eol, *q;
+    char *names[4096], numbuf[32];
+    int njobs = 0, jobssz = 0, lc = 0, nn;
+    if (mf_open (&mf, path)) {
+	fmt_print (stderr, "$1: $2 - $3\n", prog, path, ERRSTR);
+	return -1;
+    }
+    for (p = mf.data, end = p + mf.size; p < end; p = eol) {
+	eol = next_line (p, end); ++lc; nn = 0;
+	while (p < eol) {
+	    while (p < eol && (isws (*p) || *p == '\r' || *p == '\n')) {
+		++p;
+	    }
+	    if (p >= eol || (nn == 0 && *p == '#')) { break; }
+	    q = p;
+	    while (q < eol && ! isws (*q) && *q != '\r' && *q != '\n') {
+		++q;
+	    }
+	    if (nn >= (int) (sizeof(names) / sizeof(names[0]))
+	    ||  !(names[nn++] = arena_strndup (pool, p, (size_t) (q - p)))) {
+		goto NOMEM;
+	    }
+	    p = q;
+	}
+	if (nn == 0) { continue; }
+	if (nn < 2) {
+	    line2str (lc, numbuf, sizeof(numbuf));
+	    fmt_print (stderr, "$1: $2($3): missing header template\n",
+			       prog, path, numbuf);
+	    goto ERROUT;
+	}
+	if (njobs >= jobssz) {
+	    jobssz = (jobssz ? 2 * jobssz : 64);
+	    if (!(nj = t_realloc (struct hgen_job, jobs, jobssz))) {
+		goto NOMEM;
+	    }
+	    jobs = nj;
+	}
+	job = &jobs[njobs++];
+	job->output = names[0]; job->template = names[1];
+	job->filesc = nn - 2;
+	job->files = arena_alloc (pool, (size_t) (nn - 1) * sizeof(char *));
+	if (! job->files) { goto NOMEM; }
+	memcpy (job->files, names + 2, (size_t) (nn - 2) * sizeof(char *));
+	job->files[nn - 2] = NULL;
+    }
+    mf_close (&mf);
+    *_jobs = jobs;
+    return njobs;
+NOMEM:
+    fmt_print (stderr, "$1: $2\n", prog, ERRSTR);
+ERROUT:
+    mf_close (&mf); cfree (jobs);
+    return -1;
+}
+
+static pthread_mutex_t out_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Return the next item (< `n`) a worker has to process, or -1 ... */
+static int next_item (struct hgen_batch *b, int n)
+{
+    int ix;
+    pthread_mutex_lock (&b->lock);
+    ix = b->next++;
+    pthread_mutex_unlock (&b->lock);
+    return (ix < n ? ix : -1);
+}
+
+static void *scan_worker (void *arg)
+{
+    struct hgen_batch *b = (struct hgen_batch *) arg;
+    int ix;
+    while ((ix = next_item (b, b->nscan)) >= 0) {
+	hc_scan (&hcache->v[b->scan[ix]]);
+    }
+    return NULL;
+}
+
+/* Generate one output file (in memory) and write it ... */
+static void *gen_worker (void *arg)
+{
+    struct hgen_batch *b = (struct hgen_batch *) arg;
+    struct hgen_job *job;
+    char *obuf = NULL;
+    size_t obufsz = 0;
+    struct deplist dl = DEPLIST_INIT;
+    char *depfile;
+    FILE *out;
+    int ix, errs, rc;
+    if (b->depend) { deps = &dl; }
+    while ((ix = next_item (b, b->njobs)) >= 0) {
+	job = &b->jobs[ix]; rc = -1;
+	if (!(out = open_memstream (&obuf, &obufsz))) {
+	    fmt_print (stderr, "$1: $2\n", prog, ERRSTR);
+	    errs = 1;
+	} else {
+	    errs = write_header_file (job->template, job->output,
+				      job->filesc, job->files, out);
+	    fclose (out);
+	    /* (Without a template, the output file is left alone) */
+	    if (errs >= 0) {
+		rc = update_file (job->output, obuf, obufsz, b->update);
+	    }
+	    if (errs >= 0 && rc < 0) {
+		fmt_print (stderr, "$1: $2 - $3\n", prog, job->output, ERRSTR);
+		++errs;
+	    }
+	    if (b->depend && errs >= 0 && rc >= 0) {
+		depfile = depfile_of (job->output);
+		if (write_depfile (depfile, job->output, &dl, b->phony)) {
+		    ++errs;
+		}
+		free (depfile);
+	    }
+	    if (b->depend) { dep_free (&dl); }
+	    free (obuf); obuf = NULL; obufsz = 0;
+	}
+	pthread_mutex_lock (&out_lock);
+	if (rc >= 0) {
+	    fmt_print (stdout, "Creating $1 ... $2\n", job->output,
+			       (rc ? "done." : "unchanged."));
+	}
+	if (errs != 0) { ++b->errs; }
+	pthread_mutex_unlock (&out_lock);
+    }
+    deps = NULL;
+    return NULL;
+}
+
+/* Run `worker()` in `nworkers` threads (or - if only one worker is wanted or
+** no thread could be started - in the main thread) ...
+*/
+static void run_workers (int nworkers, void *(*worker) (void *),
+			 struct hgen_batch *b)
+{
+    pthread_t *tids = NULL;
+    int nw = 0, ix;
+    b->next = 0;
+    if (nworkers > 1 && (tids = t_allocv (pthread_t, nworkers))) {
+	for (nw = 0; nw < nworkers; ++nw) {
+	    if (pthread_create (&tids[nw], NULL, worker, b)) { break; }
+	}
+	for (ix = 0; ix < nw; ++ix) { pthread_join (tids[ix], NULL); }
+    }
+    if (nw == 0) { worker (b); }
+    cfree (tids);
+}
+
+static int run_batch (const char *manifest, const char *cachefile,
+		      int nworkers, bool update, bool depend, bool phony)
+{
+    struct arena pool = ARENA_INIT;
+    struct hdr_cache cache = HDR_CACHE_INIT;
+    struct hgen_batch b;
+    struct hdr_parts *hp;
+    char *cbuf = NULL;
+    size_t cbufsz = 0;
+    FILE *cout;
+    int ix, fx;
+    memset (&b, 0, sizeof(b));
+    b.update = update; b.depend = depend; b.phony = phony;
+    if ((b.njobs = read_manifest (manifest, &pool, &b.jobs)) < 0) {
+	arena_free (&pool); return -1;
+    }
+    if (cachefile && hc_load (&cache, cachefile)) {
+	fmt_print (stderr, "$1: $2 - $3 (ignored)\n", prog, cachefile,
+			   ERRSTR);
+	hc_free (&cache);
+    }
+    /* Collect the (distinct) header files of all jobs ... */
+    for (ix = 0, fx = 1; ix < b.njobs; ++ix) { fx += b.jobs[ix].filesc; }
+    if (!(b.scan = t_allocv (size_t, fx))) {
+	fmt_print (stderr, "$1: $2\n", prog, ERRSTR);
+	exit (71);
+    }
+    for (ix = 0; ix < b.njobs; ++ix) {
+	for (fx = 0; fx < b.jobs[ix].filesc; ++fx) {
+	    if (!(hp = hc_add (&cache, b.jobs[ix].files[fx]))) {
+		fmt_print (stderr, "$1: $2\n", prog, ERRSTR);
+		exit (71);
+	    }
+	    if (hp->used) { continue; }
+	    hp->used = true;
+	    b.scan[b.nscan++] = (size_t) (hp - cache.v);
+	}
+    }
+    hcache = &cache;
+    pthread_mutex_init (&b.lock, NULL);
+    run_workers (nworkers, scan_worker, &b);
+    run_workers (nworkers, gen_worker, &b);
+    pthread_mutex_destroy (&b.lock);
+    hcache = NULL;
+    if (cachefile) {
+	if (!(cout = open_memstream (&cbuf, &cbufsz))) {
+	    fmt_print (stderr, "$1: $2\n", prog, ERRSTR);
+	    exit (71);
+	}
+	hc_dump (&cache, cout); fclose (cout);
+	if (update_file (cachefile, cbuf, cbufsz, true) < 0) {
+	    fmt_print (stderr, "$1: $2 - $3\n", prog, cachefile, ERRSTR);
+	    ++b.errs;
+	}
+	free (cbuf);
+    }
+    hc_free (&cache); cfree (b.scan); cfree (b.jobs); arena_free (&pool);
+    return b.errs;
+}
+
 static void usage (const char *fmt, ...)
 {
     if (fmt) {
@@ -652,16 +1360,44 @@ static void usage (const char *fmt, ...)
 	exit (64);
     }
     fmt_print (stdout,
-	       "Usage: $1 [-v] [-c directory] [-o out-header] header-template"
-	       " header-file...\n"
+	       "Usage: $1 [-u] [-v] [-c directory] [-MD] [-MF depfile] [-MP]"
+	       "\n           [-o out-header] header-template header-file...\n"
+	       "       $1 [-u] [-c directory] [-MD] [-MP] [-j N] [-C cachefile]"
+	       " -b manifest\n"
 	       "       $1 [-h]\n"
 	       "\nOptions/Arguments:"
 	       "\n  -h (alt: -help, --help)"
 	       "\n    Write this text to stdout and terminate."
+	       "\n  -b manifest (alt: --batch=manifest)"
+	       "\n    Generate all output files listed in 'manifest' (one per"
+	       " line, as"
+	       "\n    'out-header header-template header-file...'), scanning"
+	       " each header"
+	       "\n    file only once."
+	       "\n  -C cachefile (alt: --cache=cachefile)"
+	       "\n    Keep the scanned header files in 'cachefile' (batch mode"
+	       " only); only"
+	       "\n    the header files which were changed are scanned again."
 	       "\n  -c directory (alt: --chdir=directory)"
 	       "\n    Change into 'directory' before performing any action."
+	       "\n  -MD"
+	       "\n    Write the template and the header files used as the"
+	       " dependencies of"
+	       "\n    'out-header' to 'out-header.d' (a 'make' rule)."
+	       "\n  -MF depfile"
+	       "\n    Like '-MD', but write the dependencies to 'depfile'."
+	       "\n  -MP"
+	       "\n    Add an empty 'make' rule for each dependency."
+	       "\n  -j N (alt: --jobs=N)"
+	       "\n    Generate up to N output files in parallel (batch mode"
+	       " only)."
 	       "\n  -o out-header (alt: --output=out-header)"
 	       "\n    Write result to 'out-header' (instead of stdout)."
+	       "\n  -u (alt: --update)"
+	       "\n    Replace 'out-header' only if the result differs from it's"
+	       " current"
+	       "\n    content (keeping the modification time of an unchanged"
+	       " file)."
 	       "\n  header-template"
 	       "\n    The template file which is used as a boilerplate for"
 	       " generating the"
@@ -688,7 +1424,7 @@ static int nvopt (const char *sopt, const char *lopt,
 		  int argc, char **argv,
 		  int *_optx)
 {
-    size_t optlen = strlen (sopt);
+    size_t optlen = (lopt ? strlen (lopt) : 0);
     char *ov = argv[*_optx];
     if (sopt) {
 	if (*ov != '-') { return 0; }
@@ -767,9 +1503,15 @@ int main (int argc, char *argv[])
     char *outfile = NULL, *tfname, **files, *dir = NULL, *v;
     char **non_optv = NULL;
     int non_optc = 0, nox;
-    int verbose = 0;
+    int verbose = 0, update = 0, rc, nworkers = 1;
+    char *manifest = NULL, *cachefile = NULL, *depfile = NULL;
+    bool depend = false, phony = false;
+    struct deplist dl = DEPLIST_INIT;
+    char *obuf = NULL;
+    size_t obufsz = 0;
 
     prog = bn (*argv); if (! prog) { prog = PROG; }
+    init_markers ();
 
     if (!(non_optv = malloc ((argc + 1) * sizeof(char *)))) {
 	fmt_print (stderr, "$1: Failed to allocate memory\n", prog);
@@ -803,6 +1545,38 @@ int main (int argc, char *argv[])
 	    if (outfile) { usage ("ambiguous option '--outfile'"); }
 	    outfile = v; continue;
 	}
+	if ((v = soptarg ("b", argc, argv, &optc))
+	||  (v = loptarg ("batch", argc, argv, &optc))) {
+	    if (manifest) { usage ("ambiguous option '-b'"); }
+	    manifest = v; continue;
+	}
+	if ((v = soptarg ("C", argc, argv, &optc))
+	||  (v = loptarg ("cache", argc, argv, &optc))) {
+	    if (cachefile) { usage ("ambiguous option '-C'"); }
+	    cachefile = v; continue;
+	}
+	if ((v = soptarg ("j", argc, argv, &optc))
+	||  (v = loptarg ("jobs", argc, argv, &optc))) {
+	    char *p;
+	    long lv = strtol (v, &p, 10);
+	    if (p == v || *p || lv < 1 || lv > 1024) {
+		usage ("invalid argument for option '-j'");
+	    }
+	    nworkers = (int) lv; continue;
+	}
+	if (nvopt ("MD", NULL, argc, argv, &optc)) {
+	    depend = true; continue;
+	}
+	if ((v = soptarg ("MF", argc, argv, &optc))) {
+	    if (depfile) { usage ("ambiguous option '-MF'"); }
+	    depfile = v; depend = true; continue;
+	}
+	if (nvopt ("MP", NULL, argc, argv, &optc)) {
+	    phony = true; continue;
+	}
+	if (nvopt ("u", "update", argc, argv, &optc)) {
+	    update = 1; continue;
+	}
 	if (nvopt ("v", "verbose", argc, argv, &optc)) {
 	    verbose = 1; continue;
 	}
@@ -816,7 +1590,27 @@ int main (int argc, char *argv[])
     }
     non_optv[non_optc] = NULL;
 
+    if (manifest) {
+	if (outfile || depfile || non_optc > 0) {
+	    usage ("no output or dependency file or other arguments allowed"
+		   " with '-b'");
+	}
+	if (dir && chdir (dir) != 0) {
+	    fmt_print (stderr, "$1: Changing into directory '$2' failed - $3\n",
+			       prog, dir, ERRSTR);
+	    exit (1);
+	}
+	return (run_batch (manifest, cachefile, nworkers, update, depend,
+			   phony) ? 1 : 0);
+    }
+    if (cachefile || nworkers > 1) {
+	usage ("the options '-C' and '-j' are allowed only with '-b'");
+    }
+
     if (non_optc < 1) { usage ("missing argument(s)"); }
+    if (depend && ! outfile) {
+	usage ("the options '-MD' and '-MF' require an output file ('-o')");
+    }
 
     nox = 0; tfname = non_optv[nox++];
 
@@ -842,7 +1636,15 @@ int main (int argc, char *argv[])
 			   (outfile ? outfile : "in <stdout>"));
     }
 
-    if (outfile) {
+    if (outfile && update) {
+	/* The result is compared with the current content of `outfile`
+	** before replacing it ...
+	*/
+	if (!(out = open_memstream (&obuf, &obufsz))) {
+	    fmt_print (stderr, "$1: $2\n", prog, ERRSTR);
+	    exit (71);
+	}
+    } else if (outfile) {
 	if (!(out = fopen (outfile, "w"))) {
 	    fmt_print (stderr, "$1: $2 - $3\n", prog, outfile, ERRSTR);
 	    exit (1);
@@ -852,10 +1654,28 @@ int main (int argc, char *argv[])
     }
 
     filesc = non_optc - nox; files = &non_optv[nox];
+    if (depend) { deps = &dl; }
     errs = write_header_file (tfname, outfile, filesc, files, out);
+    deps = NULL;
 
-    if (outfile) { fclose (out); out = NULL; }
-    if (!verbose) { fputs (" done.\n", stdout); }
+    rc = 1;
+    if (outfile) {
+	fclose (out); out = NULL;
+	if (update) {
+	    if ((rc = update_file (outfile, obuf, obufsz, true)) < 0) {
+		fmt_print (stderr, "$1: $2 - $3\n", prog, outfile, ERRSTR);
+		exit (1);
+	    }
+	    free (obuf);
+	}
+    }
+    if (!verbose) { fputs ((rc ? " done.\n" : " unchanged.\n"), stdout); }
+    if (depend && errs >= 0) {
+	char *dfname = (depfile ? depfile : depfile_of (outfile));
+	if (write_depfile (dfname, outfile, &dl, phony)) { ++errs; }
+	if (dfname != depfile) { free (dfname); }
+    }
+    dep_free (&dl);
 
     return (errs > 0 ? 1 : 0);
 }
@@ -42,7 +42,7 @@ char *abspath (const char *path)
 	}
 	p = pbCopy (res, wd); p = pbCopy (p, "/"); pbCopy (p, path);
     }
-    if (!trans_path (res, res)) { free (res); res = NULL; }
+    if (trans_path (res, res)) { free (res); res = NULL; }
     return res;
 }
 
@@ -11,6 +11,8 @@
 ** allows for (partially) interactive operations ...
 **
 */
+#define _GNU_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -23,6 +25,9 @@
 #include <signal.h>
 #include <fcntl.h>
 #include <time.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <fnmatch.h>
 
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -41,6 +46,11 @@
 #include "lib/ask.c"
 #include "lib/regfile.c"
 #include "lib/which2.c"
+#include "lib/elfstrip.c"
+#include "lib/idcache.c"
+#include "lib/idc_user_byname.c"
+#include "lib/idc_group_byname.c"
+#include "lib/dirread.c"
 
 static void
 usage (const char *format, ...)
@@ -52,18 +62,35 @@ usage (const char *format, ...)
 	fputs ("\n", stderr);
 	exit (64);
     }
-    printf ("Usage: %s [-clpqQsvz] [-m mode] [-o owner] [-g group] file..."
-	    " target\n"
-	    "       %s [-clpqQsvz] [-m mode] [-o owner] [-g group] -t dir"
-	    " file...\n"
+    printf ("Usage: %s [-aclpqQrsTvz] [-D dir] [-j jobs] [-m mode] [-o owner]"
+	    " [-g group]\n"
+	    "           [-R rules] [-X pattern]... file... target\n"
+	    "       %s [-aclpqQrsTvz] [-D dir] [-j jobs] [-m mode] [-o owner]"
+	    " [-g group]\n"
+	    "           [-R rules] [-X pattern]... -t dir file...\n"
 	    "       %s [-qQv] -d [-m mode] [-o owner] [-g group] directory\n"
 	    "       %s -h\n"
 	    "\nOptions:"
+	    "\n  -a  Like '-r', but keep symbolic links (see '-l') and the"
+	    " ownership and"
+	    "\n      timestamps of the entries of the installed directories."
 	    "\n  -c  ignored (kept for compatibility reasons)"
 	    "\n  -d  Install a target directory."
+	    "\n  -D dir"
+	    "\n      Together with '-s': write the debugging information removed"
+	    " from an ELF"
+	    "\n      object to 'dir/<target-path>.debug' (leading '/' removed)"
+	    " and add a"
+	    "\n      '.gnu_debuglink' to the stripped target file."
 	    "\n  -g group"
 	    "\n      Change the group of the target file to 'group'."
 	    "\n  -h  Display this message and terminate."
+	    "\n  -j jobs"
+	    "\n      Install (upto) 'jobs' files concurrently if more than one"
+	    " file is to be"
+	    "\n      installed into a target directory. The messages of '-v'"
+	    " are written"
+	    "\n      (completely) after each file is installed."
 	    "\n  -l  keep symbolic links (don't follow them during the"
 	    " installation but"
 	    "\n      recreate them in the target directory)."
@@ -79,12 +106,41 @@ usage (const char *format, ...)
 	    " normal operation"
 	    "\n    would be copying of the source files into the target"
 	    " directory."
+	    "\n  -R rules"
+	    "\n      Read rules for installing directories from the file"
+	    " 'rules'. Each line"
+	    "\n      of this file is either 'pattern exclude' or"
+	    " 'pattern mode [owner [group]]'"
+	    "\n      ('-' means: no override). Entries whose pathname"
+	    " (relative to the"
+	    "\n      installed directory) or - if 'pattern' contains no '/'"
+	    " - whose name"
+	    "\n      matches 'pattern' are excluded or installed with the"
+	    " given mode/owner/"
+	    "\n      group. The first matching rule (or '-X' pattern) is"
+	    " used."
+	    "\n  -r  Install directories (recursively). The mode given with"
+	    " '-m' applies"
+	    "\n      only to the files in these directories. A symbolic link"
+	    " to one of the"
+	    "\n      directories containing it is recreated (not followed)."
 	    "\n  -Q  Don't overwrite an existing file; display an error"
 	    "\n  -q  Ask for an existing file being overwritten"
 	    " message instead"
-	    "\n  -s  Discard the symbols from a target (object-)file. This"
-	    " operation is not"
-	    "\n      possible without the 'strip' program being installed."
+	    "\n  -s  Discard the symbols from a target (object-)file. ELF"
+	    " executables and"
+	    "\n      shared libraries are stripped while being copied; for any"
+	    " other type of"
+	    "\n      object files, the 'strip' program is used (if installed)."
+	    "\n  -T  Install all files or none of them: the files are"
+	    " installed under"
+	    "\n      temporary names first and replace the target files"
+	    " (after being synced"
+	    "\n      to disk at once) only if all of them could be installed."
+	    "\n  -X pattern"
+	    "\n      Exclude the matching entries of installed directories"
+	    " (like a rule"
+	    "\n      'pattern exclude'; see '-R')."
 	    "\n  -v  Display a message for each file being installed."
 	    "\n  -z  Compress a target file. This operation is not possible"
 	    " without the 'gzip'"
@@ -94,13 +150,37 @@ usage (const char *format, ...)
     exit (0);
 }
 
+/* Number of files being installed concurrently ('-j'), and the lock which
+** serializes the (buffered) output and the queries of these workers ...
+*/
+static int njobs = 1;
+static pthread_mutex_t out_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* If not NULL, 'vout()' writes into this (per thread) buffer instead of
+** 'stdout'; the content is then written at once when the installation of
+** the current file is complete ...
+*/
+static __thread FILE *vmsg = NULL;
+
+/* The name of the target file while it is staged ('-T'); used in the
+** messages instead of the (temporary) name of the staged file ...
+*/
+static __thread const char *staged_for = NULL;
+
+static const char *dname (const char *file)
+{
+    return (staged_for ? staged_for : file);
+}
+
 static void emesg (int exit_code, const char *format, ...)
 {
     int ec = errno;
     va_list args;
+    flockfile (stderr);
     fprintf (stderr, "%s: ", prog);
     va_start (args, format); vfprintf (stderr, format, args); va_end (args);
     fputs ("\n", stderr);
+    funlockfile (stderr);
     if (exit_code > 0) { exit (exit_code); }
     errno = ec;
 }
@@ -114,8 +194,12 @@ static void vout (const char *format, ...)
 {
     int ec = errno;
     va_list args;
-    va_start (args, format); vfprintf (stdout, format, args); va_end (args);
-    fflush (stdout);
+    if (vmsg) {
+	va_start (args, format); vfprintf (vmsg, format, args); va_end (args);
+    } else {
+	va_start (args, format); vfprintf (stdout, format, args); va_end (args);
+	fflush (stdout);
+    }
     errno = ec;
 }
 
@@ -189,6 +273,13 @@ static unsigned long x2ul (const char *s, const char **_p, int base)
 }
 
 
+static int is_dir (const char *path, int err);
+static void add_tree_rule (const char *pattern, int exclude, const char *mode,
+			   const char *user, const char *group);
+static void load_tree_rules (const char *file);
+static void journal_rollback (void);
+static int journal_commit (int verbose);
+
 static int
 install_directory (int optflags,
 		   const char *mode, const char *user, const char *group,
@@ -208,6 +299,26 @@ static int install_files (int opt_flags, const char *mode,
 #define OPT_KEEPLINK (32)
 #define OPT_INSTPATH  (64)
 #define OPT_RMDST (128)
+#define OPT_RECURSIVE (256)
+#define OPT_PRESERVE (512)
+#define OPT_TRANSACT (1024)
+
+/* Target directory for the debugging information removed with '-s' ... */
+static const char *debug_dir = NULL;
+
+/* A rule for the installation of a directory tree ('-X', '-R'). An entry
+** matches a rule if it's pathname (relative to the top of the tree) or -
+** if the rule's pattern contains no '/' - the entry's name matches the
+** pattern (see 'fnmatch()'). The first matching rule is used ...
+*/
+struct tree_rule {
+    const char *pattern;
+    int exclude;
+    const char *mode, *user, *group;
+};
+
+static struct tree_rule *tree_rules = NULL;
+static size_t tree_rulesc = 0, tree_rulesz = 0;
 
 int main (int argc, char *argv[])
 {
@@ -219,7 +330,8 @@ int main (int argc, char *argv[])
     set_prog (argc, argv);
 
     opterr = 0;
-    while ((opt = getopt (argc, argv, "+:Qcdg:hlm:o:pqst:vz")) != -1) {
+    while ((opt = getopt (argc, argv, "+:D:QR:TX:acdg:hj:lm:o:pqrst:vz"))
+	   != -1) {
 	switch (opt) {
 	    case 'Q':
 		/* Query mode 1 - Don't overwrite existing files */
@@ -228,10 +340,29 @@ int main (int argc, char *argv[])
 			   opt);
 		}
 		optflags |= OPT_QUERY1; break;
+	    case 'R':
+		/* Read the rules for installing directory trees ... */
+		load_tree_rules (optarg); break;
+	    case 'T':
+		/* Install all files or none of them ... */
+		optflags |= OPT_TRANSACT; break;
+	    case 'X':
+		/* Exclude the matching entries of directory trees ... */
+		add_tree_rule (optarg, 1, NULL, NULL, NULL); break;
+	    case 'a':
+		/* Install directory trees, keeping symbolic links, the
+		** ownership and the timestamps of the source entries ...
+		*/
+		optflags |= OPT_RECURSIVE|OPT_KEEPLINK|OPT_PRESERVE; break;
 	    case 'c':
 		/* Only for compatibility reasons, but ignored */
 		break;
 	    case 'd': dirmode = 1; break;
+	    case 'D':
+		/* Split the debugging information (only with '-s') ... */
+		if (debug_dir) { usage ("ambiguous '-D' option"); }
+		debug_dir = optarg;
+		break;
 	    case 'g':
 		/* Set the group for the installed files ... */
 		if (group) { usage ("ambiguous '-g' option"); }
@@ -240,6 +371,16 @@ int main (int argc, char *argv[])
 	    case 'h':
 		/* Write a usage message and terminate. */
 		usage (NULL); break;
+	    case 'j': {
+		/* Install multiple files concurrently ... */
+		const char *p;
+		unsigned long lv = x2ul (optarg, &p, 10);
+		if (! p || *p != '\0' || lv < 1 || lv > 256) {
+		    usage ("invalid argument for '-%c' (1..256 expected)", opt);
+		}
+		njobs = (int) lv;
+		break;
+	    }
 	    case 'l':
 		/* Copy symbolic links as symbolic links and not the files
 		** they point to ...
@@ -271,17 +412,20 @@ int main (int argc, char *argv[])
 			   opt);
 		}
 		optflags |= OPT_QUERY2; break;
+	    case 'r':
+		/* Install directories (recursively) ... */
+		optflags |= OPT_RECURSIVE; break;
 	    case 's':
 		/* Strip a regular file if it is a program or shared library
 		** file ...
 		*/
-		if (stripcmd) {
+		if (optflags & OPT_STRIP) {
 		    usage ("Ambiguous ose of the option '-%c'", opt);
 		}
-		if (!stripcmd && !(stripcmd = which ("strip"))) {
-		    usage ("option '-s' not available; check if the 'strip'"
-			   " program is installed!");
-		}
+		/* ELF objects are stripped internally; the 'strip' program
+		** is required only for any other object file format ...
+		*/
+		stripcmd = which ("strip");
 		optflags |= OPT_STRIP; break;
 	    case 't':
 		/* Set a target directory explicitely ... */
@@ -313,12 +457,35 @@ int main (int argc, char *argv[])
 	    default: usage ("invalid option '-%c'", optopt);
 	}
     }
+    if (debug_dir) {
+	if (! (optflags & OPT_STRIP)) { usage ("'-D' requires '-s'"); }
+	if (is_dir (debug_dir, 0) <= 0) {
+	    usage ("'%s' is no directory", debug_dir);
+	}
+    }
+    if ((optflags & OPT_RECURSIVE) != 0 && (optflags & OPT_COMPRESS) != 0) {
+	usage ("The options '-z' and '-r'/'-a' are mutually exclusive");
+    }
+    if (tree_rulesc > 0 && (optflags & OPT_RECURSIVE) == 0) {
+	usage ("'-R' and '-X' require '-r' or '-a'");
+    }
     if (dirmode) {
+	if ((optflags & OPT_TRANSACT) != 0) {
+	    usage ("The options '-d' and '-T' are mutually exclusive");
+	}
 	rc = install_directory (optflags, mode, user, group, stripcmd, gzipcmd,
 				argc - optind, &argv[optind]);
     } else {
 	rc = install_files (optflags, mode, user, group, stripcmd, gzipcmd,
 			    tdir, argc - optind, &argv[optind]);
+	if ((optflags & OPT_TRANSACT) != 0) {
+	    if (rc) {
+		emesg (0, "Installation failed; rolling back");
+		journal_rollback ();
+	    } else {
+		rc = journal_commit ((optflags & OPT_VERBOSE) != 0);
+	    }
+	}
     }
     return (rc ? 1 : 0);
 }
@@ -441,6 +608,78 @@ static int copy_file (int opt_flags,
 		      const char *mode, const char *user, const char *group,
 		      const char *stripcmd, const char *gzipcmd,
 		      const char *src, const char *dst);
+static void init_tempids (void);
+
+/* The (shared) state of the workers which install the files of a
+** multi-file installation concurrently ('-j') ...
+*/
+struct install_jobs {
+    int opt_flags;
+    const char *mode, *user, *group, *stripcmd, *gzipcmd, *tdir;
+    int filesc;
+    char **files;
+    pthread_mutex_t lock;
+    int next, errs;
+};
+
+struct install_worker {
+    struct install_jobs *jobs;
+    pthread_t tid;
+    int id;
+};
+
+/* The number of the current worker (used for distinguishing the names of
+** saved files; 0 for the main thread) ...
+*/
+static __thread int worker_id = 0;
+
+/* Install one file into the target directory, buffering the (verbose)
+** messages of this installation if 'buffered' is true. These messages are
+** written at once (as a unit) when the installation is complete ...
+*/
+static int install_one (struct install_jobs *jobs, const char *file,
+			int buffered)
+{
+    int rc;
+    char *mbuf = NULL; size_t mbufsz = 0;
+    if (buffered && (jobs->opt_flags & OPT_VERBOSE) != 0) {
+	vmsg = open_memstream (&mbuf, &mbufsz);
+    }
+    rc = copy_to_dir (jobs->opt_flags, jobs->mode, jobs->user, jobs->group,
+		      jobs->stripcmd, jobs->gzipcmd, file, jobs->tdir);
+    if (vmsg) {
+	int ec = errno;
+	fclose (vmsg); vmsg = NULL;
+	if (mbuf) {
+	    pthread_mutex_lock (&out_lock);
+	    fwrite (mbuf, 1, mbufsz, stdout); fflush (stdout);
+	    pthread_mutex_unlock (&out_lock);
+	    free (mbuf);
+	}
+	errno = ec;
+    }
+    return rc;
+}
+
+static void *install_worker (void *arg)
+{
+    struct install_worker *self = (struct install_worker *) arg;
+    struct install_jobs *jobs = self->jobs;
+    int ix;
+    worker_id = self->id;
+    for (;;) {
+	pthread_mutex_lock (&jobs->lock);
+	ix = jobs->next++;
+	pthread_mutex_unlock (&jobs->lock);
+	if (ix >= jobs->filesc) { break; }
+	if (install_one (jobs, jobs->files[ix], 1)) {
+	    pthread_mutex_lock (&jobs->lock);
+	    ++jobs->errs;
+	    pthread_mutex_unlock (&jobs->lock);
+	}
+    }
+    return NULL;
+}
 
 static int
 install_files (int opt_flags, 
@@ -467,15 +706,41 @@ install_files (int opt_flags,
 	if (last_is_dir > 0) { tdir = files[filesc - 1]; --filesc; }
     }
     if (tdir) {
-	int ix, errs = 0;
-	const char *file;
-	for (ix = 0; ix < filesc; ++ix) {
-	    file = files[ix];
-	    rc = copy_to_dir (opt_flags, mode, user, group,
-			      stripcmd, gzipcmd, file, tdir);
-	    if (rc) { ++errs; }
-	}
-	if (errs > 0) { rc = -1; }
+	int ix, nw = 0;
+	struct install_jobs jobs;
+	struct install_worker *workers = NULL;
+	jobs.opt_flags = opt_flags; jobs.mode = mode;
+	jobs.user = user; jobs.group = group;
+	jobs.stripcmd = stripcmd; jobs.gzipcmd = gzipcmd; jobs.tdir = tdir;
+	jobs.filesc = filesc; jobs.files = files;
+	jobs.next = 0; jobs.errs = 0;
+	if (njobs > filesc) { njobs = filesc; }
+	if (njobs > 1 && (workers = t_allocv (struct install_worker, njobs))) {
+	    /* The names of saved files must be the same in all workers ...
+	    */
+	    init_tempids ();
+	    pthread_mutex_init (&jobs.lock, NULL);
+	    for (nw = 0; nw < njobs; ++nw) {
+		workers[nw].jobs = &jobs; workers[nw].id = nw + 1;
+		if (pthread_create (&workers[nw].tid, NULL,
+				    install_worker, &workers[nw])) {
+		    break;
+		}
+	    }
+	}
+	if (nw > 0) {
+	    for (ix = 0; ix < nw; ++ix) {
+		pthread_join (workers[ix].tid, NULL);
+	    }
+	} else {
+	    /* Sequential installation (no '-j' or no worker available) ...
+	    */
+	    for (ix = 0; ix < filesc; ++ix) {
+		if (install_one (&jobs, files[ix], 0)) { ++jobs.errs; }
+	    }
+	}
+	if (workers) { pthread_mutex_destroy (&jobs.lock); free (workers); }
+	rc = (jobs.errs > 0 ? -1 : 0);
     } else {
 	rc = copy_file (opt_flags, mode, user, group, stripcmd, gzipcmd,
 			files[filesc - 2], files[filesc - 1]);
@@ -509,13 +774,16 @@ static int _do_cmd (const char *cmdprog, ...)
 	    return -1;
 	case 0:  {	/* CHILD */
 	    execve (cmd[0], (char **) cmd, environ);
-	    exit (99);
+	    /* (No 'exit()' in a child of a multi-threaded process) */
+	    _exit (99);
 	}
 	default: {	/* PARENT */
 	    int wstat;
 	    waitpid (pid, &wstat, 0);
 	    if (WIFSIGNALED (wstat)) {
-		emesg (0, "'%s' - %s", cmdprog, strsignal (WTERMSIG (wstat)));
+		/* ('strsignal()' isn't thread-safe) */
+		emesg (0, "'%s' terminated by signal %d", cmdprog,
+		       WTERMSIG (wstat));
 		return -1;
 	    }
 	    if (WIFEXITED (wstat)) {
@@ -529,6 +797,12 @@ static int _do_cmd (const char *cmdprog, ...)
     }
 }
 
+/* The user/group names are resolved via the (not thread-safe) identity
+** cache; the workers of a concurrent installation must use it mutually
+** exclusive ...
+*/
+static pthread_mutex_t db_lock = PTHREAD_MUTEX_INITIALIZER;
+
 /* Convert the string 'user' into a user id. The string may be given either
 ** as a numerical user id (which is returned directly) or as a user name which
 ** is searched in the 'passwd' user database ...
@@ -545,9 +819,11 @@ static uid_t get_user (const char *user)
 	if (lv > max) { return -1; }
 	res = (uid_t) lv;
     } else {
-	struct passwd *pwe = getpwnam (user);
-	if (! pwe) { int ec = errno; errno = ec; return -1; }
-	res = pwe->pw_uid;
+	int rc, ec;
+	pthread_mutex_lock (&db_lock);
+	rc = idc_user_byname (user, &res); ec = errno;
+	pthread_mutex_unlock (&db_lock);
+	if (rc) { errno = ec; return -1; }
     }
     return res;
 }
@@ -568,9 +844,11 @@ static gid_t get_group (const char *group)
 	if (lv > max) { return -1; }
 	res = (gid_t) lv;
     } else {
-	struct group *gre = getgrnam (group);
-	if (! gre) { int ec = errno; errno = ec; return -1; }
-	res = gre->gr_gid;
+	int rc, ec;
+	pthread_mutex_lock (&db_lock);
+	rc = idc_group_byname (group, &res); ec = errno;
+	pthread_mutex_unlock (&db_lock);
+	if (rc) { errno = ec; return -1; }
     }
     return res;
 }
@@ -732,7 +1010,7 @@ static int tmp_id2 = -1;
 static int get_rand (void)
 {
     int fd;
-    if ((fd = open ("/dev/urandom", O_RDONLY)) < 0) {
+    if ((fd = open ("/dev/urandom", O_RDONLY|O_CLOEXEC)) < 0) {
 	time_t t; unsigned int seed;
 	time (&t);
 	if (sizeof(t) > sizeof(seed)) {
@@ -794,9 +1072,19 @@ static int expand_buffer (char **_buf, size_t *_bufsz, size_t newsz)
     return 0;
 }
 
-static char *tmpf = NULL;
-static size_t tmpfsz = 0;
+static __thread char *tmpf = NULL;
+static __thread size_t tmpfsz = 0;
+
+static void init_tempids (void)
+{
+    if (tmp_id1 == 0) { tmp_id1 = (int) getpid (); }
+    if (tmp_id2 < 0) { tmp_id2 = get_rand (); }
+}
 
+/* Generate the name a file is saved under during its replacement. The names
+** generated in the workers of a concurrent installation get the worker's
+** number appended, because they may save files in the same directory ...
+*/
 static const char *gen_tempname (const char *file)
 {
     int pl;
@@ -805,10 +1093,16 @@ static const char *gen_tempname (const char *file)
     if (p) { sz = (size_t) (p - file); p = file; } else { p = "."; sz = 1; }
     pl = (int) sz;
     sz += strlen (prog) + sizeof(tmp_id1)*3 + sizeof(tmp_id2)*2 + 4;
+    sz += sizeof(worker_id)*3 + 1;
     if (expand_buffer (&tmpf, &tmpfsz, sz + 1)) { return NULL; }
-    if (tmp_id1 == 0) { tmp_id1 = (int) getpid (); }
-    if (tmp_id2 < 0) { tmp_id2 = get_rand (); }
-    snprintf (tmpf, tmpfsz, "%.*s/%s.%d%%%x", pl, p, prog, tmp_id1, tmp_id2);
+    init_tempids ();
+    if (worker_id > 0) {
+	snprintf (tmpf, tmpfsz, "%.*s/%s.%d%%%x-%d", pl, p, prog,
+		  tmp_id1, tmp_id2, worker_id);
+    } else {
+	snprintf (tmpf, tmpfsz, "%.*s/%s.%d%%%x", pl, p, prog,
+		  tmp_id1, tmp_id2);
+    }
     return tmpf;
 }
 
@@ -836,6 +1130,236 @@ static int remove_saved (const char *file)
     return unlink (saved_as);
 }
 
+/* The journal of a transactional installation ('-T'). All files are
+** installed ("staged") under temporary names in their target directories
+** first, and each of these is recorded here together with it's final name.
+** If all files could be staged, the data of all of them is synced to disk at
+** once, and the staged files then replace the target files (whose old
+** versions are kept until all replacements are done). If anything fails,
+** all replacements done so far are undone and all staged files (and all
+** directories which were created) are removed ...
+*/
+#define J_FILE 0
+#define J_DIR 1
+
+struct jentry {
+    int type, state, saved;
+    char *staged, *target;
+};
+
+static struct jentry *journal = NULL;
+static size_t journalc = 0, journalsz = 0;
+static unsigned long stage_seq = 0;
+static pthread_mutex_t journal_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Generate a (unique) name for staging a file in the directory given by the
+** first 'dirlen' characters of 'dir' (or - if 'dir' is NULL - a name relative
+** to the target directory) ...
+*/
+static char *stage_name (const char *dir, int dirlen)
+{
+    char *res;
+    unsigned long seq;
+    size_t sz = (dir ? (size_t) dirlen + 1 : 0);
+    sz += strlen (prog) + sizeof(tmp_id1)*3 + sizeof(seq)*3 + 5;
+    if (! (res = (char *) malloc (sz))) { return NULL; }
+    pthread_mutex_lock (&journal_lock);
+    seq = ++stage_seq;
+    pthread_mutex_unlock (&journal_lock);
+    init_tempids ();
+    if (dir) {
+	snprintf (res, sz, "%.*s/.%s.%d.%lu", dirlen, dir, prog, tmp_id1, seq);
+    } else {
+	snprintf (res, sz, ".%s.%d.%lu", prog, tmp_id1, seq);
+    }
+    return res;
+}
+
+/* Generate the staging name for the target file 'dst' ... */
+static char *stage_path (const char *dst)
+{
+    const char *p = strrchr (dst, '/');
+    if (! p) { return stage_name (".", 1); }
+    return stage_name (dst, (int) (p - dst));
+}
+
+/* Record the staged file (or - with 'type' J_DIR - the newly created
+** directory) 'staged' which is to be installed as 'target'. Both strings
+** are copied ...
+*/
+static int journal_add (int type, const char *staged, const char *target)
+{
+    int rc = -1;
+    struct jentry *je;
+    pthread_mutex_lock (&journal_lock);
+    if (journalc >= journalsz) {
+	size_t newsz = (journalsz > 0 ? 2 * journalsz : 64);
+	if (! (je = t_realloc (struct jentry, journal, newsz))) { goto ERROUT; }
+	journal = je; journalsz = newsz;
+    }
+    je = &journal[journalc];
+    je->type = type; je->state = 0; je->saved = 0;
+    if (! (je->staged = strdup (staged))) { goto ERROUT; }
+    if (! (je->target = (target ? strdup (target) : NULL)) && target) {
+	cfree (je->staged); goto ERROUT;
+    }
+    ++journalc; rc = 0;
+ERROUT:
+    pthread_mutex_unlock (&journal_lock);
+    return rc;
+}
+
+static char *backup_name (const char *staged)
+{
+    size_t sz = strlen (staged) + 2;
+    char *res = (char *) malloc (sz);
+    if (res) { snprintf (res, sz, "%s~", staged); }
+    return res;
+}
+
+/* Undo all replacements done so far and remove all staged files and the
+** created directories (in reverse order) ...
+*/
+static void journal_rollback (void)
+{
+    size_t ix = journalc;
+    char *bkp;
+    while (ix-- > 0) {
+	struct jentry *je = &journal[ix];
+	if (je->type == J_DIR) { rmdir (je->staged); continue; }
+	if (je->saved) {
+	    /* Restore the old version. If the target wasn't replaced yet, the
+	    ** backup is a hard link to it (and 'rename()' would be a no-op), so
+	    ** only the backup is removed ...
+	    */
+	    if ((bkp = backup_name (je->staged))) {
+		struct stat bsb, tsb;
+		if (! lstat (bkp, &bsb) && ! lstat (je->target, &tsb)
+		&&  bsb.st_dev == tsb.st_dev && bsb.st_ino == tsb.st_ino) {
+		    unlink (bkp);
+		} else {
+		    rename (bkp, je->target);
+		}
+		free (bkp);
+	    }
+	} else if (je->state > 0) {
+	    /* No old version; remove the installed file ... */
+	    unlink (je->target);
+	}
+	if (je->state == 0) { unlink (je->staged); }
+    }
+}
+
+static int strpcmp (const void *a, const void *b)
+{
+    return strcmp (*(const char * const *) a, *(const char * const *) b);
+}
+
+/* Sync the directories containing the journal entries (or - with 'data'
+** true - the file systems these directories are located on). Each directory
+** (file system) is synced only once ...
+*/
+static int journal_sync (int data)
+{
+    size_t ix, dirsc = 0;
+    char **dirs, *p;
+    dev_t *devs = NULL;
+    size_t devsc = 0;
+    int rc = 0, fd;
+    struct stat sb;
+    if (journalc == 0) { return 0; }
+    if (! (dirs = t_allocv (char *, journalc))) { return -1; }
+    for (ix = 0; ix < journalc; ++ix) {
+	if (! (dirs[dirsc] = strdup (journal[ix].staged))) {
+	    rc = -1; goto ERROUT;
+	}
+	if ((p = strrchr (dirs[dirsc], '/'))) { *p = '\0'; }
+	++dirsc;
+    }
+    qsort (dirs, dirsc, sizeof(char *), strpcmp);
+    if (data && ! (devs = t_allocv (dev_t, dirsc + 1))) {
+	rc = -1; goto ERROUT;
+    }
+    for (ix = 0; ix < dirsc; ++ix) {
+	size_t jx;
+	if (ix > 0 && ! strcmp (dirs[ix], dirs[ix - 1])) { continue; }
+	if ((fd = open (dirs[ix], O_RDONLY|O_DIRECTORY)) < 0) {
+	    rc = -1; goto ERROUT;
+	}
+	if (data) {
+	    if (fstat (fd, &sb)) { close (fd); rc = -1; goto ERROUT; }
+	    for (jx = 0; jx < devsc; ++jx) {
+		if (devs[jx] == sb.st_dev) { break; }
+	    }
+	    if (jx >= devsc) {
+		devs[devsc++] = sb.st_dev;
+#ifdef __linux__
+		if (syncfs (fd)) { close (fd); rc = -1; goto ERROUT; }
+#else
+		sync ();
+#endif
+	    }
+	} else if (fsync (fd)) {
+	    close (fd); rc = -1; goto ERROUT;
+	}
+	close (fd);
+    }
+ERROUT:
+    if (devs) { free (devs); }
+    while (dirsc-- > 0) { free (dirs[dirsc]); }
+    free (dirs);
+    return rc;
+}
+
+/* Commit the transaction: sync the staged files, replace the target files
+** with them, sync the directories, and remove the old versions of the
+** replaced files ...
+*/
+static int journal_commit (int verbose)
+{
+    size_t ix;
+    char *bkp;
+    struct jentry *je;
+    if (verbose) {
+	vout ("Committing %lu entries ...", (unsigned long) journalc);
+    }
+    if (journal_sync (1)) { goto ERROUT; }
+    for (ix = 0; ix < journalc; ++ix) {
+	je = &journal[ix];
+	if (je->type != J_FILE) { continue; }
+	if (! (bkp = backup_name (je->staged))) { goto ERROUT; }
+	/* Keep the old version (if any) until the transaction is done ... */
+	if (link (je->target, bkp) == 0) {
+	    je->saved = 1;
+	} else if (errno == EXDEV || errno == EPERM || errno == ENOTSUP) {
+	    /* Hard links aren't supported here; move the old version
+	    ** instead ...
+	    */
+	    if (rename (je->target, bkp)) { free (bkp); goto ERROUT; }
+	    je->saved = 1;
+	} else if (errno != ENOENT) {
+	    free (bkp); goto ERROUT;
+	}
+	free (bkp);
+	if (rename (je->staged, je->target)) { goto ERROUT; }
+	je->state = 1;
+    }
+    if (journal_sync (0)) { goto ERROUT; }
+    for (ix = 0; ix < journalc; ++ix) {
+	je = &journal[ix];
+	if (je->type != J_FILE) { continue; }
+	if ((bkp = backup_name (je->staged))) { unlink (bkp); free (bkp); }
+    }
+    DONE;
+    return 0;
+ERROUT:
+    FAILED;
+    emesg (0, "Committing the installation failed - %s; rolling back",
+	   current_error ());
+    journal_rollback ();
+    return -1;
+}
+
 static int rc_check (int rc, int flags, const char *fn, const char *file)
 {
     int ec = errno;
@@ -889,7 +1413,7 @@ static int recreate_special (int opt_flags, const char *mode,
 			  S_ISFIFO (sp->st_mode) ? "named pipe " :
 			  S_ISSOCK (sp->st_mode) ? "local socket " :
 						   "");
-	vout ("Installing %s%s ...", ft, file);
+	vout ("Installing %s%s ...", ft, dname (file));
     }
     ft = sp->st_mode & S_IFMT;
     switch (ft) {
@@ -928,8 +1452,8 @@ static int recreate_special (int opt_flags, const char *mode,
 }
 
 
-static char *ltarget = NULL;
-size_t ltargetsz = 0;
+static __thread char *ltarget = NULL;
+static __thread size_t ltargetsz = 0;
 
 static int recreate_link (int opt_flags, const char *mode,
 			  const char *user, const char *group,
@@ -938,7 +1462,7 @@ static int recreate_link (int opt_flags, const char *mode,
     uid_t uid; gid_t gid; mode_t pmask;
     int rc, verbose = (opt_flags & OPT_VERBOSE) != 0;
     size_t sz = (size_t) sp->st_size;
-    if (verbose) { vout ("Installing symbolic link %s ...", dst); }
+    if (verbose) { vout ("Installing symbolic link %s ...", dname (dst)); }
     if (expand_buffer (&ltarget, &ltargetsz, sz + 1)) { return -1; }
     memset (ltarget, 0, ltargetsz);
     if (readlink (src, ltarget, ltargetsz - 1) < 0) {
@@ -973,16 +1497,115 @@ static int recreate_link (int opt_flags, const char *mode,
     return 0;
 }
 
+/* Create the missing parent directories of the (debug) file 'path' whose
+** first 'skip' bytes (the debug directory) are known to exist. With
+** 'transact' true, the created directories are recorded in the journal ...
+*/
+static int make_parents (char *path, size_t skip, int transact)
+{
+    char *p = path + skip;
+    int rc;
+    for (;;) {
+	while (*p == '/') { ++p; }
+	while (*p && *p != '/') { ++p; }
+	if (!*p) { break; }
+	*p = '\0';
+	if ((rc = mkdir (path, 0755)) == 0 && transact
+	&&  journal_add (J_DIR, path, NULL)) {
+	    int ec = errno; rmdir (path); *p = '/'; errno = ec; return -1;
+	}
+	if (rc && (errno != EEXIST || is_dir (path, 0) <= 0)) {
+	    *p = '/'; return -1;
+	}
+	*p = '/';
+    }
+    return 0;
+}
+
+/* Write the stripped version of the ELF object opened as 'sfd' to 'dfd' and
+** the removed debugging information to '<debug_dir>/<dst>.debug' (if '-D'
+** was specified). Leading '/', './' and '../' are removed from 'dst', so
+** two targets with the same basename don't share the same debug file.
+** With 'transact' true ('-T'), the debug file is staged and recorded in the
+** journal like the target file itself. Returns 1 if the source is no ELF
+** object which can be stripped internally (nothing was written in this
+** case) ...
+*/
+static int strip_to (int sfd, int dfd, const char *dst, int transact)
+{
+    int rc, ec, dbgfd = -1;
+    char *dbgpath = NULL, *dbgstaged = NULL, *p;
+    size_t dbgpathsz = 0;
+    if (debug_dir) {
+	const char *name = dst;
+	for (;;) {
+	    while (*name == '/') { ++name; }
+	    if (strncmp (name, "./", 2) == 0) {
+		name += 2;
+	    } else if (strncmp (name, "../", 3) == 0) {
+		name += 3;
+	    } else {
+		break;
+	    }
+	}
+	if (!(p = append (dbgpath, dbgpathsz, NULL, debug_dir))
+	||  !(p = append (dbgpath, dbgpathsz, p, "/"))
+	||  !(p = append (dbgpath, dbgpathsz, p, name))
+	||  !(p = append (dbgpath, dbgpathsz, p, ".debug"))) {
+	    return -1;
+	}
+	if (make_parents (dbgpath, strlen (debug_dir), transact)
+	||  (transact && ! (dbgstaged = stage_path (dbgpath)))) {
+	    ec = errno; cfree (dbgpath); errno = ec; return -1;
+	}
+	p = (dbgstaged ? dbgstaged : dbgpath);
+	dbgfd = open (p, O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, 0644);
+	if (dbgfd < 0) {
+	    ec = errno;
+	    if (dbgstaged) { free (dbgstaged); }
+	    cfree (dbgpath); errno = ec; return -1;
+	}
+    }
+    /* The '.gnu_debuglink' always refers to the final name of the debug
+    ** file ...
+    */
+    rc = elf_strip (sfd, dfd, dbgfd, dbgpath);
+    if (dbgfd >= 0) {
+	ec = errno;
+	if (close (dbgfd) && rc == 0) { ec = errno; rc = -1; }
+	if (rc == 0 && dbgstaged && journal_add (J_FILE, dbgstaged, dbgpath)) {
+	    ec = errno; rc = -1;
+	}
+	if (rc != 0) { unlink (p); }
+	if (dbgstaged) { free (dbgstaged); }
+	cfree (dbgpath); errno = ec;
+    }
+    return rc;
+}
+
+/* 'fopen()' with the close-on-exec flag set, so the file isn't inherited by
+** the 'strip'/'gzip' commands other worker threads ('-j') run meanwhile ...
+*/
+static FILE *fopen_cx (const char *path, int flags, const char *fmode)
+{
+    FILE *fp;
+    int fd = open (path, flags|O_CLOEXEC, 0666), ec;
+    if (fd < 0) { return NULL; }
+    if (! (fp = fdopen (fd, fmode))) { ec = errno; close (fd); errno = ec; }
+    return fp;
+}
+
 static int copy_to (int opt_flags, const char *mode,
 		    const char *user, const char *group,
-		    const char *src, struct stat *sp, const char *dst)
+		    const char *src, struct stat *sp, const char *dst,
+		    int *_stripped)
 {
     uid_t uid; gid_t gid; mode_t pmask;
     int rc, verbose = (opt_flags & OPT_VERBOSE) != 0, pc = 0;
     int rm_dst = (opt_flags & OPT_RMDST) != 0;
     FILE *sfp, *dfp;
     char buf[8192]; size_t rlen, wlen;
-    if (verbose) { vout ("Installing file %s as %s", src, dst); }
+    if (verbose) { vout ("Installing file %s as %s", src, dname (dst)); }
     if ((uid = get_user (user)) < 0) {
 	if (verbose) { vout (" failed (invalid user)\n"); }
 	return -1;
@@ -995,7 +1618,7 @@ static int copy_to (int opt_flags, const char *mode,
 	if (verbose) { vout (" failed (invalid mode)\n"); }
 	return -1;
     }
-    if (! (sfp = fopen (src, "rb"))) {
+    if (! (sfp = fopen_cx (src, O_RDONLY, "rb"))) {
 	if (verbose) { vout (" ... failed (%s)\n", current_error ()); }
 	return -1;
     }
@@ -1004,16 +1627,29 @@ static int copy_to (int opt_flags, const char *mode,
 	    vout (" rename() failed (%s)\n", current_error ()); return -1;
 	}
     }
-    if (! (dfp = fopen (dst, "wb"))) {
+    if (! (dfp = fopen_cx (dst, O_WRONLY|O_CREAT|O_TRUNC, "wb"))) {
 	int ec = errno;
 	fclose (sfp); restore_file (dst);
 	if (verbose) { vout (" ... failed (%s)\n", strerror (ec)); }
 	return -1;
     }
+    *_stripped = 0;
+    if ((opt_flags & OPT_STRIP) != 0) {
+	/* Strip ELF objects while copying them ... */
+	rc = strip_to (fileno (sfp), fileno (dfp), dname (dst),
+		       staged_for != NULL);
+	if (rc < 0) {
+	    int ec = errno;
+	    fclose (dfp); fclose (sfp); restore_file (dst);
+	    if (verbose) { vout (" ... strip failed (%s)\n", strerror (ec)); }
+	    errno = ec; return -1;
+	}
+	*_stripped = (rc == 0);
+    }
     wlen = 0;
-    while ((rlen = fread (buf, 1, sizeof(buf), sfp)) > 0) {
+    while (! *_stripped && (rlen = fread (buf, 1, sizeof(buf), sfp)) > 0) {
 	if ((wlen = fwrite (buf, 1, rlen, dfp)) != rlen) { break; }
-	if (verbose) { 
+	if (verbose && ! vmsg) {
 	    const char *alive = "|/-\\"; /* alt: ".oOo" (heartbeat alike) */
 	    vout ("%c\b", alive[pc]); pc = (pc + 1) % strlen (alive);
 	}
@@ -1032,6 +1668,544 @@ static int copy_to (int opt_flags, const char *mode,
     return 0;
 }
 
+/* Installation of directory trees ('-r', '-a'). The source tree is traversed
+** relative to the file descriptors of the directories (source and target)
+** and every entry is installed under a temporary name first which is then
+** renamed to the entry's name; the directories get their final permissions
+** (and ownership) after their content was installed ...
+*/
+
+static void add_tree_rule (const char *pattern, int exclude, const char *mode,
+			   const char *user, const char *group)
+{
+    struct tree_rule *r;
+    if (tree_rulesc >= tree_rulesz) {
+	size_t newsz = (tree_rulesz > 0 ? 2 * tree_rulesz : 16);
+	r = t_realloc (struct tree_rule, tree_rules, newsz);
+	if (! r) { emesg (1, "%s", current_error ()); }
+	tree_rules = r; tree_rulesz = newsz;
+    }
+    r = &tree_rules[tree_rulesc++];
+    r->pattern = pattern; r->exclude = exclude;
+    r->mode = mode; r->user = user; r->group = group;
+}
+
+/* Read the rules from 'file'. Each (non-empty, non-comment) line of this
+** file has the form
+**   pattern exclude
+** or
+**   pattern mode [owner [group]]
+** where a '-' as 'mode', 'owner' or 'group' means: no override (the value
+** from the command line or - with '-a' - from the source entry is used) ...
+*/
+static void load_tree_rules (const char *file)
+{
+    FILE *fp;
+    char line[1024], *p, *f[4];
+    int lc = 0, nf;
+    mode_t m;
+    if (! (fp = fopen (file, "r"))) {
+	emesg (1, "'%s' - %s", file, current_error ());
+    }
+    while (fgets (line, sizeof(line), fp)) {
+	++lc;
+	if (! strchr (line, '\n') && ! feof (fp)) {
+	    emesg (1, "%s(%d): line too long", file, lc);
+	}
+	p = line; nf = 0; f[2] = f[3] = NULL;
+	for (;;) {
+	    while (isspace (*p)) { ++p; }
+	    if (*p == '\0' || *p == '#') { break; }
+	    if (nf >= 4) { emesg (1, "%s(%d): too many fields", file, lc); }
+	    f[nf++] = p;
+	    while (*p && ! isspace (*p)) { ++p; }
+	    if (*p) { *p++ = '\0'; }
+	}
+	if (nf == 0) { continue; }
+	if (nf < 2) { emesg (1, "%s(%d): missing mode", file, lc); }
+	while (nf-- > 0) {
+	    if (! (f[nf] = strdup (f[nf]))) {
+		emesg (1, "%s", current_error ());
+	    }
+	}
+	if (! strcmp (f[1], "exclude")) {
+	    add_tree_rule (f[0], 1, NULL, NULL, NULL); continue;
+	}
+	if (! strcmp (f[1], "-")) {
+	    f[1] = NULL;
+	} else if ((m = get_mode (0, f[1])) == S_IFMT) {
+	    emesg (1, "%s(%d): invalid mode '%s'", file, lc, f[1]);
+	}
+	if (! f[2] || ! strcmp (f[2], "-")) {
+	    f[2] = NULL;
+	} else if (get_user (f[2]) == (uid_t) -1) {
+	    emesg (1, "%s(%d): invalid user '%s'", file, lc, f[2]);
+	}
+	if (! f[3] || ! strcmp (f[3], "-")) {
+	    f[3] = NULL;
+	} else if (get_group (f[3]) == (gid_t) -1) {
+	    emesg (1, "%s(%d): invalid group '%s'", file, lc, f[3]);
+	}
+	add_tree_rule (f[0], 0, f[1], f[2], f[3]);
+    }
+    if (ferror (fp)) { emesg (1, "'%s' - %s", file, current_error ()); }
+    fclose (fp);
+}
+
+static const struct tree_rule *find_tree_rule (const char *relpath,
+					       const char *name)
+{
+    size_t ix;
+    for (ix = 0; ix < tree_rulesc; ++ix) {
+	const struct tree_rule *r = &tree_rules[ix];
+	if (strchr (r->pattern, '/')) {
+	    if (! fnmatch (r->pattern, relpath, FNM_PATHNAME)) { return r; }
+	} else if (! fnmatch (r->pattern, name, 0)) {
+	    return r;
+	}
+    }
+    return NULL;
+}
+
+/* The state of a tree installation ... */
+/* The directories of the current (source) path; a symbolic link to one of
+** them is installed as a symbolic link instead of being descended into
+** (which would never end) ...
+*/
+struct tree_anc {
+    dev_t dev; ino_t ino;
+    const struct tree_anc *up;
+};
+
+struct tree_ctx {
+    int opt_flags;
+    const char *mode, *user, *group;
+    const char *dst;
+    dev_t dst_dev; ino_t dst_ino;
+    char *rel; size_t relsz, rellen;
+    const struct tree_anc *anc;
+    int errs;
+};
+
+static int tree_onpath (struct tree_ctx *ctx, struct stat *sp)
+{
+    const struct tree_anc *a;
+    for (a = ctx->anc; a; a = a->up) {
+	if (a->dev == sp->st_dev && a->ino == sp->st_ino) { return 1; }
+    }
+    return 0;
+}
+
+static void tree_failed (struct tree_ctx *ctx, int verbose_started)
+{
+    if (verbose_started) {
+	vout (" failed (%s)\n", current_error ());
+    } else {
+	emesg (0, "Installing %s/%s failed - %s",
+	       ctx->dst, ctx->rel, current_error ());
+    }
+    ++ctx->errs;
+}
+
+/* Set the permissions, the ownership and (with '-a') the timestamps of the
+** (target) entry 'name' in the directory 'dirfd' ...
+*/
+static int tree_attrs (struct tree_ctx *ctx, const struct tree_rule *rule,
+		       int dirfd, const char *name, struct stat *sp)
+{
+    int preserve = (ctx->opt_flags & OPT_PRESERVE) != 0;
+    const char *m, *u, *g;
+    uid_t uid = (uid_t) -1; gid_t gid = (gid_t) -1;
+    mode_t pmask;
+    /* The mode from the command line applies only to the non-directory
+    ** entries ...
+    */
+    m = (rule && rule->mode ? rule->mode :
+	 S_ISDIR (sp->st_mode) ? NULL : ctx->mode);
+    u = (rule && rule->user ? rule->user : ctx->user);
+    g = (rule && rule->group ? rule->group : ctx->group);
+    if (u) {
+	if ((uid = get_user (u)) == (uid_t) -1) { errno = EINVAL; return -1; }
+    } else if (preserve) {
+	uid = sp->st_uid;
+    }
+    if (g) {
+	if ((gid = get_group (g)) == (gid_t) -1) {
+	    errno = EINVAL; return -1;
+	}
+    } else if (preserve) {
+	gid = sp->st_gid;
+    }
+    if (uid != (uid_t) -1 || gid != (gid_t) -1) {
+	if (fchownat (dirfd, name, uid, gid, AT_SYMLINK_NOFOLLOW)) {
+	    return -1;
+	}
+    }
+    if (! S_ISLNK (sp->st_mode)) {
+	if ((pmask = get_mode (sp->st_mode, m)) == S_IFMT) {
+	    errno = EINVAL; return -1;
+	}
+	if (fchmodat (dirfd, name, pmask & 07777, 0)) { return -1; }
+    }
+    if (preserve) {
+	struct timespec ts[2];
+	ts[0] = sp->st_atim; ts[1] = sp->st_mtim;
+	if (utimensat (dirfd, name, ts, AT_SYMLINK_NOFOLLOW)) { return -1; }
+    }
+    return 0;
+}
+
+static int copy_fd (int sfd, int dfd)
+{
+    char buf[65536];
+    ssize_t rlen, wlen, off;
+    while ((rlen = read (sfd, buf, sizeof(buf))) != 0) {
+	if (rlen < 0) {
+	    if (errno == EINTR) { continue; }
+	    return -1;
+	}
+	for (off = 0; off < rlen; off += wlen) {
+	    if ((wlen = write (dfd, buf + off, (size_t) (rlen - off))) < 0) {
+		if (errno != EINTR) { return -1; }
+		wlen = 0;
+	    }
+	}
+    }
+    return 0;
+}
+
+/* Return the pathname of the entry 'name' in the (target) directory of the
+** current entry ('-T') ...
+*/
+static char *tree_path (struct tree_ctx *ctx, const char *name)
+{
+    const char *p = strrchr (ctx->rel, '/');
+    int dl = (p ? (int) (p - ctx->rel) : 0);
+    size_t sz = strlen (ctx->dst) + dl + strlen (name) + 3;
+    char *res = (char *) malloc (sz);
+    if (! res) { return NULL; }
+    if (p) {
+	snprintf (res, sz, "%s/%.*s/%s", ctx->dst, dl, ctx->rel, name);
+    } else {
+	snprintf (res, sz, "%s/%s", ctx->dst, name);
+    }
+    return res;
+}
+
+/* Create the non-directory entry 'name' (of the source directory 'sfd') as
+** temporary file 'tmpn' in the target directory 'dfd' ...
+*/
+static int tree_create (struct tree_ctx *ctx, int sfd, int dfd,
+			const char *name, struct stat *sp, const char *tmpn)
+{
+    int ifd, ofd, rc, ec;
+    switch (sp->st_mode & S_IFMT) {
+	case S_IFREG:
+	    ifd = openat (sfd, name, O_RDONLY|O_CLOEXEC);
+	    if (ifd < 0) { return -1; }
+	    ofd = openat (dfd, tmpn, O_WRONLY|O_CREAT|O_EXCL|O_CLOEXEC, 0600);
+	    if (ofd < 0) { ec = errno; close (ifd); errno = ec; return -1; }
+	    rc = 1;
+	    if ((ctx->opt_flags & OPT_STRIP) != 0) {
+		/* Only ELF objects are stripped here; the external 'strip'
+		** program isn't applied to the (data) files of a tree ...
+		*/
+		char *tp = tree_path (ctx, name);
+		rc = (tp ? strip_to (ifd, ofd, tp,
+				     (ctx->opt_flags & OPT_TRANSACT) != 0)
+			 : -1);
+		if (tp) { ec = errno; free (tp); errno = ec; }
+		if (rc == 1 && lseek (ifd, 0, SEEK_SET) < 0) { rc = -1; }
+	    }
+	    if (rc == 1) { rc = copy_fd (ifd, ofd); }
+	    ec = errno;
+	    if (close (ofd) && rc == 0) { ec = errno; rc = -1; }
+	    close (ifd);
+	    if (rc) { unlinkat (dfd, tmpn, 0); }
+	    errno = ec; return rc;
+	case S_IFLNK: {
+	    size_t sz = (size_t) sp->st_size;
+	    ssize_t len;
+	    if (expand_buffer (&ltarget, &ltargetsz, sz + 2)) { return -1; }
+	    if ((len = readlinkat (sfd, name, ltarget, ltargetsz - 1)) < 0) {
+		return -1;
+	    }
+	    ltarget[len] = '\0';
+	    return symlinkat (ltarget, dfd, tmpn);
+	}
+	case S_IFBLK: case S_IFCHR: case S_IFIFO: case S_IFSOCK:
+	    return mknodat (dfd, tmpn, sp->st_mode & (S_IFMT|0600),
+			    sp->st_rdev);
+	default:
+	    errno = EINVAL; return -1;
+    }
+}
+
+static int tree_dir (struct tree_ctx *ctx, int sfd, int dfd);
+
+/* Record the (staged) entry 'tmpn' which is to be installed as 'name' - or
+** (if 'tmpn' is NULL) the created directory 'name' - in the journal ...
+*/
+static int tree_journal (struct tree_ctx *ctx, const char *tmpn,
+			 const char *name)
+{
+    int rc = -1, ec;
+    char *tp = NULL, *np;
+    if (! (np = tree_path (ctx, name))) { return -1; }
+    if (! tmpn) {
+	rc = journal_add (J_DIR, np, NULL);
+    } else if ((tp = tree_path (ctx, tmpn))) {
+	rc = journal_add (J_FILE, tp, np);
+    }
+    ec = errno;
+    if (tp) { free (tp); }
+    free (np); errno = ec;
+    return rc;
+}
+
+static int tree_entry (struct tree_ctx *ctx, int sfd, int dfd,
+		       const char *name)
+{
+    int verbose = (ctx->opt_flags & OPT_VERBOSE) != 0;
+    int follow = (ctx->opt_flags & OPT_KEEPLINK) == 0;
+    int transact = (ctx->opt_flags & OPT_TRANSACT) != 0;
+    const struct tree_rule *rule = find_tree_rule (ctx->rel, name);
+    char *tmpn;
+    struct stat sb, db;
+    int exists, rc;
+    if (rule && rule->exclude) { return 0; }
+    if (fstatat (sfd, name, &sb, (follow ? 0 : AT_SYMLINK_NOFOLLOW))) {
+	tree_failed (ctx, 0); return -1;
+    }
+    if (S_ISDIR (sb.st_mode) && tree_onpath (ctx, &sb)) {
+	/* A loop (like 'up -> ..'); install the link itself, as 'cp -r'
+	** does ...
+	*/
+	if (fstatat (sfd, name, &sb, AT_SYMLINK_NOFOLLOW)) {
+	    tree_failed (ctx, 0); return -1;
+	}
+	if (S_ISDIR (sb.st_mode)) {
+	    errno = ELOOP; tree_failed (ctx, 0); return -1;
+	}
+    }
+    exists = ! fstatat (dfd, name, &db, AT_SYMLINK_NOFOLLOW);
+    if (S_ISDIR (sb.st_mode)) {
+	struct tree_anc anc;
+	int nsfd, ndfd, rc;
+	/* Don't install the target tree into itself ... */
+	if (sb.st_dev == ctx->dst_dev && sb.st_ino == ctx->dst_ino) {
+	    return 0;
+	}
+	if (verbose) {
+	    vout ("Installing directory %s/%s ...", ctx->dst, ctx->rel);
+	}
+	if (exists && ! S_ISDIR (db.st_mode)) {
+	    errno = ENOTDIR; tree_failed (ctx, verbose); return -1;
+	}
+	if (! exists) {
+	    if (mkdirat (dfd, name, 0700)) {
+		tree_failed (ctx, verbose); return -1;
+	    }
+	    if (transact && tree_journal (ctx, NULL, name)) {
+		int ec = errno;
+		unlinkat (dfd, name, AT_REMOVEDIR); errno = ec;
+		tree_failed (ctx, verbose); return -1;
+	    }
+	}
+	nsfd = openat (sfd, name, O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+	if (nsfd < 0) {
+	    tree_failed (ctx, verbose); return -1;
+	}
+	ndfd = openat (dfd, name, O_RDONLY|O_DIRECTORY|O_NOFOLLOW|O_CLOEXEC);
+	if (ndfd < 0) {
+	    tree_failed (ctx, verbose); close (nsfd); return -1;
+	}
+	if (verbose) { vout (" done\n"); }
+	anc.dev = sb.st_dev; anc.ino = sb.st_ino; anc.up = ctx->anc;
+	ctx->anc = &anc;
+	rc = tree_dir (ctx, nsfd, ndfd);
+	ctx->anc = anc.up;
+	close (ndfd); close (nsfd);
+	if (tree_attrs (ctx, rule, dfd, name, &sb)) {
+	    tree_failed (ctx, 0); return -1;
+	}
+	return rc;
+    }
+    if (verbose) { vout ("Installing %s/%s ...", ctx->dst, ctx->rel); }
+    if (exists) {
+	if (S_ISDIR (db.st_mode)) {
+	    errno = EISDIR; tree_failed (ctx, verbose); return -1;
+	}
+	if ((ctx->opt_flags & OPT_QUERY1) != 0) {
+	    errno = EEXIST; tree_failed (ctx, verbose); return -1;
+	}
+	if ((ctx->opt_flags & OPT_QUERY2) != 0) {
+	    int ok;
+	    pthread_mutex_lock (&out_lock);
+	    ok = ask (-1, "Ok to overwrite %s/%s", ctx->dst, ctx->rel);
+	    pthread_mutex_unlock (&out_lock);
+	    if (! ok) {
+		errno = EEXIST; tree_failed (ctx, verbose); return -1;
+	    }
+	}
+    }
+    /* The staged entries ('-T') are renamed when the transaction is
+    ** committed ...
+    */
+    if (transact) {
+	tmpn = stage_name (NULL, 0);
+    } else {
+	const char *tn = gen_tempname (name);
+	tmpn = (tn ? strdup (tn) : NULL);
+    }
+    if (! tmpn || tree_create (ctx, sfd, dfd, name, &sb, tmpn)) {
+	tree_failed (ctx, verbose); cfree (tmpn); return -1;
+    }
+    if ((rc = tree_attrs (ctx, rule, dfd, tmpn, &sb)) == 0) {
+	rc = (transact ? tree_journal (ctx, tmpn, name)
+		       : renameat (dfd, tmpn, dfd, name));
+    }
+    if (rc) {
+	int ec = errno;
+	unlinkat (dfd, tmpn, 0); errno = ec;
+	tree_failed (ctx, verbose); free (tmpn); return -1;
+    }
+    free (tmpn);
+    if (verbose) { vout (" done\n"); }
+    return 0;
+}
+
+static int tree_dir (struct tree_ctx *ctx, int sfd, int dfd)
+{
+    int fd, rc = 0, nr;
+    struct dirread dr;
+    struct dr_entry de;
+    size_t rellen = ctx->rellen;
+    dr_init (&dr, 0);
+    if ((fd = fcntl (sfd, F_DUPFD_CLOEXEC, 0)) < 0) {
+	tree_failed (ctx, 0); return -1;
+    }
+    if (dr_fdopen (&dr, fd)) {
+	tree_failed (ctx, 0); dr_free (&dr); return -1;
+    }
+    while ((nr = dr_next (&dr, &de)) > 0) {
+	const char *name = de.name;
+	size_t sz;
+	sz = rellen + strlen (name) + 2;
+	if (expand_buffer (&ctx->rel, &ctx->relsz, sz)) {
+	    tree_failed (ctx, 0); rc = -1; break;
+	}
+	sz = rellen + (rellen > 0);
+	if (rellen > 0) { ctx->rel[rellen] = '/'; }
+	strcpy (ctx->rel + sz, name);
+	ctx->rellen = sz + strlen (name);
+	if (tree_entry (ctx, sfd, dfd, name)) { rc = -1; }
+	ctx->rellen = rellen; ctx->rel[rellen] = '\0';
+    }
+    if (nr < 0) { tree_failed (ctx, 0); rc = -1; }
+    dr_free (&dr);
+    return rc;
+}
+
+/* Install the directory tree 'src' as 'dst'. Errors in single entries
+** don't terminate this operation, but let it fail after all other entries
+** were installed ...
+*/
+static int install_tree (int opt_flags, const char *mode,
+			 const char *user, const char *group,
+			 const char *src, const char *dst)
+{
+    int verbose = (opt_flags & OPT_VERBOSE) != 0;
+    int sfd, dfd;
+    struct stat sb, db;
+    struct tree_ctx ctx;
+    struct tree_anc root;
+    if (verbose) { vout ("Installing directory %s as %s ...", src, dst); }
+    if ((sfd = open (src, O_RDONLY|O_DIRECTORY|O_CLOEXEC)) < 0) {
+	FAILED; return -1;
+    }
+    if (fstat (sfd, &sb)) { FAILED; close (sfd); return -1; }
+    if (mkdir (dst, 0700) == 0) {
+	if ((opt_flags & OPT_TRANSACT) != 0 && journal_add (J_DIR, dst, NULL)) {
+	    FAILED; rmdir (dst); close (sfd); return -1;
+	}
+    } else if (errno != EEXIST) {
+	FAILED; close (sfd); return -1;
+    }
+    dfd = open (dst, O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+    if (dfd < 0 || fstat (dfd, &db)) {
+	FAILED; if (dfd >= 0) { close (dfd); } close (sfd); return -1;
+    }
+    DONE;
+    memset (&ctx, 0, sizeof(ctx));
+    ctx.opt_flags = opt_flags;
+    ctx.mode = mode; ctx.user = user; ctx.group = group;
+    ctx.dst = dst; ctx.dst_dev = db.st_dev; ctx.dst_ino = db.st_ino;
+    if (expand_buffer (&ctx.rel, &ctx.relsz, 256)) {
+	FAILED; close (dfd); close (sfd); return -1;
+    }
+    ctx.rel[0] = '\0';
+    root.dev = sb.st_dev; root.ino = sb.st_ino; root.up = NULL;
+    ctx.anc = &root;
+    tree_dir (&ctx, sfd, dfd);
+    close (dfd); close (sfd);
+    if (tree_attrs (&ctx, NULL, AT_FDCWD, dst, &sb)) {
+	emesg (0, "Installing %s failed - %s", dst, current_error ());
+	++ctx.errs;
+    }
+    cfree (ctx.rel);
+    return (ctx.errs > 0 ? -1 : 0);
+}
+
+static int copy_file (int opt_flags,
+		      const char *mode, const char *user, const char *group,
+		      const char *stripcmd, const char *gzipcmd,
+		      const char *src, const char *dst);
+
+/* Install 'src' under a temporary name (in the target directory) and record
+** it in the journal for being renamed to 'dst' when the transaction is
+** committed ('-T') ...
+*/
+static int stage_file (int opt_flags,
+		       const char *mode, const char *user, const char *group,
+		       const char *stripcmd, const char *gzipcmd,
+		       const char *src, const char *dst)
+{
+    int rc, ec;
+    char *staged, *gzstaged = NULL, *gzdst = NULL, *p;
+    size_t gzstagedsz = 0, gzdstsz = 0;
+    struct stat sb;
+    if (! (staged = stage_path (dst))) { return -1; }
+    staged_for = dst;
+    rc = copy_file (opt_flags & ~OPT_TRANSACT, mode, user, group,
+		    stripcmd, gzipcmd, src, staged);
+    staged_for = NULL;
+    if (rc) {
+	ec = errno; unlink (staged); free (staged); errno = ec; return rc;
+    }
+    if ((opt_flags & OPT_COMPRESS) != 0
+    &&  lstat (staged, &sb) && errno == ENOENT) {
+	/* The file was compressed ... */
+	if (!(p = append (gzstaged, gzstagedsz, NULL, staged))
+	||  !(p = append (gzstaged, gzstagedsz, p, ".gz"))
+	||  !(p = append (gzdst, gzdstsz, NULL, dst))
+	||  !(p = append (gzdst, gzdstsz, p, ".gz"))) {
+	    rc = -1;
+	} else {
+	    rc = journal_add (J_FILE, gzstaged, gzdst);
+	}
+	if (rc && gzstaged) { unlink (gzstaged); }
+    } else {
+	rc = journal_add (J_FILE, staged, dst);
+	if (rc) { unlink (staged); }
+    }
+    ec = errno;
+    if (gzstaged) { free (gzstaged); }
+    if (gzdst) { free (gzdst); }
+    free (staged); errno = ec;
+    return rc;
+}
+
 /* Was ist zu tun?
 ** 1. Feststellen, um was fürt einen Typ von Datei es sich handelt.
 ** 2. Reguläre Dateien kopieren.
@@ -1049,7 +2223,12 @@ static int copy_file (int opt_flags,
 		      const char *src, const char *dst)
 {
     int rc = 0, allow_xcmd = 0, verbose = (opt_flags & OPT_VERBOSE) != 0;
+    int stripped = 0;
     struct stat sb;
+    if ((opt_flags & OPT_RECURSIVE) != 0
+    &&  stat (src, &sb) == 0 && S_ISDIR (sb.st_mode)) {
+	return install_tree (opt_flags, mode, user, group, src, dst);
+    }
     if (lstat (dst, &sb) == 0) {
 	if ((opt_flags & OPT_QUERY1) != 0) {
 	    errno = EEXIST;
@@ -1058,7 +2237,12 @@ static int copy_file (int opt_flags,
 	    }
 	    return -1;
 	} else if ((opt_flags & OPT_QUERY2) != 0) {
-	    if (! ask (-1, "Ok to overwrite %s", dst)) {
+	    int ok;
+	    /* Only one worker may query the user at a time ... */
+	    pthread_mutex_lock (&out_lock);
+	    ok = ask (-1, "Ok to overwrite %s", dst);
+	    pthread_mutex_unlock (&out_lock);
+	    if (! ok) {
 		errno = EEXIST;
 		if (verbose) {
 		    vout ("Installing '%s' failed (%s)\n",
@@ -1067,7 +2251,11 @@ static int copy_file (int opt_flags,
 		return -1;
 	    }
 	}
-	opt_flags |= OPT_RMDST;
+	if ((opt_flags & OPT_TRANSACT) == 0) { opt_flags |= OPT_RMDST; }
+    }
+    if ((opt_flags & OPT_TRANSACT) != 0) {
+	return stage_file (opt_flags, mode, user, group, stripcmd, gzipcmd,
+			   src, dst);
     }
     if (lstat (src, &sb)) { return -1; }
     switch (sb.st_mode & S_IFMT) {
@@ -1083,16 +2271,19 @@ static int copy_file (int opt_flags,
 				    &sb, dst);
 	    } else {
 		allow_xcmd = 1;
-		rc = copy_to (opt_flags, mode, user, group, src, &sb, dst);
+		rc = copy_to (opt_flags, mode, user, group, src, &sb, dst,
+			      &stripped);
 	    }
 	    break;
 	case S_IFREG:
 	    allow_xcmd = 1;
-	    rc = copy_to (opt_flags, mode, user, group, src, &sb, dst);
+	    rc = copy_to (opt_flags, mode, user, group, src, &sb, dst,
+			  &stripped);
 	    break;
-	case S_IFDIR:	/* Directory */
-	    /* Not implemented (yet) ... */
-	    errno = EINVAL; return -1;
+	case S_IFDIR:	/* Directory (only with '-r' or '-a') */
+	    errno = EISDIR;
+	    emesg (0, "'%s' is a directory (use '-r' for installing it)", src);
+	    return -1;
 	default:
 	    errno = EINVAL; return -1;
     }
@@ -1103,9 +2294,17 @@ static int copy_file (int opt_flags,
 	return rc;
     }
     if (! allow_xcmd) { return 0; }
-    if ((opt_flags & OPT_STRIP) != 0) {
-	rc = do_cmd (stripcmd, dst);
-	if (rc) { emesg (0, "WARNING! '%s %s' failed", stripcmd, dst); rc = 0; }
+    if ((opt_flags & OPT_STRIP) != 0 && ! stripped) {
+	/* No ELF object (or none which can be stripped internally) ... */
+	if (stripcmd) {
+	    rc = do_cmd (stripcmd, dst);
+	    if (rc) {
+		emesg (0, "WARNING! '%s %s' failed", stripcmd, dst); rc = 0;
+	    }
+	} else {
+	    emesg (0, "WARNING! '%s' not stripped (no 'strip' program found)",
+		   dst);
+	}
     }
     if ((opt_flags & OPT_COMPRESS) != 0) {
 	rc = do_cmd (gzipcmd, "-f", dst);
@@ -1115,8 +2314,8 @@ static int copy_file (int opt_flags,
 }
 
 
-static size_t pathsz = 0;
-static char *path = NULL;
+static __thread size_t pathsz = 0;
+static __thread char *path = NULL;
 
 static int copy_to_dir (int opt_flags, const char *mode,
 			const char *user, const char *group,
@@ -0,0 +1,104 @@
+/* lib/arena.c
+**
+** $Id$
+**
+** Author: Boris Jakubith
+** E-Mail: runkharr@googlemail.com
+** Copyright: (c) 2026, Boris Jakubith <runkharr@googlemail.com>
+** License: GNU General Public License, version 2
+**
+** A simple arena ("bump") allocator. Memory is taken from large blocks by
+** advancing a pointer; single allocations can't be freed, but all memory
+** of an arena is released with one call. The blocks grow (doubling their
+** size, up to ARENA_MAXBLOCK) as the arena grows; allocations larger than a
+** quarter of the current block size get a block of their own.
+**
+** Synopsis:
+**    struct arena a = ARENA_INIT;
+**
+**    void *p = arena_alloc (&a, size);
+**    arena_free (&a);
+**
+** The memory returned by 'arena_alloc()' is aligned like that of
+** 'malloc()'. After 'arena_free()', the arena can be used again. Strings
+** are copied into an arena with 'arena_strdup()' ('lib/arena_strdup.c')
+** and 'arena_strndup()' ('lib/arena_strndup.c').
+**
+** Return values: 'arena_alloc()' returns NULL (with 'errno' set) if no
+** memory could be allocated.
+**
+*/
+#ifndef ARENA_C
+#define ARENA_C
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "lib/mrmacs.c"
+
+#define ARENA_BLOCKSZ 65536
+#define ARENA_MAXBLOCK (4 * 1024 * 1024)
+#define ARENA_ALIGN (2 * sizeof(void *))
+
+struct arena_block {
+    struct arena_block *next;
+};
+
+struct arena {
+    struct arena_block *blocks;
+    char *ptr;
+    size_t avail, blocksz;
+};
+
+#define ARENA_INIT { NULL, NULL, 0, 0 }
+
+/* (The size of a block header, rounded up to the alignment) */
+#define ARENA_HDRSZ \
+    ((sizeof(struct arena_block) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+
+static void *arena_alloc (struct arena *a, size_t size)
+{
+    struct arena_block *b;
+    char *p;
+    size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+    if (size == 0) { size = ARENA_ALIGN; }
+    if (size > a->avail) {
+	size_t bsz;
+	if (a->blocksz == 0) { a->blocksz = ARENA_BLOCKSZ; }
+	if (size > a->blocksz / 4) {
+	    /* A block of it's own (inserted behind the current block, so the
+	    ** remaining space of the current block can still be used) ...
+	    */
+	    ifnull (b = (struct arena_block *) malloc (ARENA_HDRSZ + size)) {
+		return NULL;
+	    }
+	    if (a->blocks) {
+		b->next = a->blocks->next; a->blocks->next = b;
+	    } else {
+		b->next = NULL; a->blocks = b;
+	    }
+	    return (char *) b + ARENA_HDRSZ;
+	}
+	bsz = a->blocksz;
+	ifnull (b = (struct arena_block *) malloc (ARENA_HDRSZ + bsz)) {
+	    return NULL;
+	}
+	b->next = a->blocks; a->blocks = b;
+	a->ptr = (char *) b + ARENA_HDRSZ; a->avail = bsz;
+	if (a->blocksz < ARENA_MAXBLOCK) { a->blocksz *= 2; }
+    }
+    p = a->ptr; a->ptr += size; a->avail -= size;
+    return (void *) p;
+}
+
+static void arena_free (struct arena *a)
+{
+    struct arena_block *b;
+    int ec = errno;
+    while ((b = a->blocks)) { a->blocks = b->next; free (b); }
+    a->ptr = NULL; a->avail = 0;
+    errno = ec;
+}
+
+#endif /*ARENA_C*/
@@ -0,0 +1,32 @@
+/* lib/arena_strdup.c
+**
+** $Id$
+**
+** Author: Boris Jakubith
+** E-Mail: runkharr@googlemail.com
+** Copyright: (c) 2026, Boris Jakubith <runkharr@googlemail.com>
+** License: GNU General Public License, version 2
+**
+** Synopsis:
+**    char *s = arena_strdup (&a, str);
+**
+** Copies the string 'str' into the arena 'a' ('lib/arena.c'). Returns the
+** copy, or NULL (with 'errno' set) if no memory could be allocated.
+**
+*/
+#ifndef ARENA_STRDUP_C
+#define ARENA_STRDUP_C
+
+#include <string.h>
+
+#include "lib/arena.c"
+
+static char *arena_strdup (struct arena *a, const char *s)
+{
+    size_t len = strlen (s) + 1;
+    char *p;
+    ifnull (p = (char *) arena_alloc (a, len)) { return NULL; }
+    return (char *) memcpy (p, s, len);
+}
+
+#endif /*ARENA_STRDUP_C*/
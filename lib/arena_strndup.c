@@ -0,0 +1,35 @@
+/* lib/arena_strndup.c
+**
+** $Id$
+**
+** Author: Boris Jakubith
+** E-Mail: runkharr@googlemail.com
+** Copyright: (c) 2026, Boris Jakubith <runkharr@googlemail.com>
+** License: GNU General Public License, version 2
+**
+** Synopsis:
+**    char *s = arena_strndup (&a, str, len);
+**
+** Copies (at most) 'len' characters of 'str' into the arena 'a'
+** ('lib/arena.c') and terminates the copy with a NUL character. Returns the
+** copy, or NULL (with 'errno' set) if no memory could be allocated.
+**
+*/
+#ifndef ARENA_STRNDUP_C
+#define ARENA_STRNDUP_C
+
+#include <string.h>
+
+#include "lib/arena.c"
+
+static char *arena_strndup (struct arena *a, const char *s, size_t len)
+{
+    char *p;
+    const char *q = (const char *) memchr (s, '\0', len);
+    if (q) { len = (size_t) (q - s); }
+    ifnull (p = (char *) arena_alloc (a, len + 1)) { return NULL; }
+    memcpy (p, s, len); p[len] = '\0';
+    return p;
+}
+
+#endif /*ARENA_STRNDUP_C*/
@@ -0,0 +1,185 @@
+/* lib/dirread.c
+**
+** $Id$
+**
+** Author: Boris Jakubith
+** E-Mail: runkharr@googlemail.com
+** Copyright: (c) 2026, Boris Jakubith <runkharr@googlemail.com>
+** License: GNU General Public License, version 2
+**
+** A directory reader which fetches the entries of a directory in bulk. On
+** Linux, the 'getdents64' system call is invoked directly with a large
+** buffer (64 KiB by default, instead of the few KiB 'readdir()' uses), so
+** a directory with many entries is read with a fraction of the system
+** calls. The entries are returned as (name, type, inode) tuples pointing
+** into this buffer; nothing is copied. The buffer is kept when a directory
+** is closed, so one reader can be used for any number of directories (one
+** after another). On other systems, 'fdopendir()'/'readdir()' are used.
+**
+** Synopsis:
+**    struct dirread dr;
+**    struct dr_entry de;
+**
+**    dr_init (&dr, bufsz);
+**    rc = dr_fdopen (&dr, fd);  (or: rc = dr_open (&dr, path);)
+**    while ((rc = dr_next (&dr, &de)) > 0) {
+**        ... de.name, de.type (DT_...), de.ino ...
+**    }
+**    dr_close (&dr);
+**    ...
+**    dr_free (&dr);
+**
+** 'bufsz' is the size of the buffer (0 selects the default size). The buffer
+** is allocated by the first 'dr_open()'/'dr_fdopen()'. 'dr_fdopen()' takes
+** over the file descriptor 'fd', which is closed by 'dr_close()'.
+** 'dr_next()' skips the '.' and '..' entries; the name it returns is valid
+** only until the next call of 'dr_next()' or 'dr_close()'. The type is
+** DT_UNKNOWN if the file system doesn't supply it. 'dr_open()' (which opens
+** the directory 'path' itself) is in 'lib/dr_open.c'.
+**
+** Return values:
+**   'dr_open()', 'dr_fdopen()', 'dr_close()': 0 on success and -1 (with
+**   'errno' set) on failure; 'dr_next()': 1 if an entry was returned, 0 at
+**   the end of the directory and -1 (with 'errno' set) on failure.
+**
+*/
+#ifndef DIRREAD_C
+#define DIRREAD_C
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+
+#include <sys/types.h>
+
+#ifdef __linux__
+# include <sys/syscall.h>
+#endif
+
+#include "lib/mrmacs.c"
+
+#if defined(__linux__) && defined(SYS_getdents64)
+# define DR_GETDENTS 1
+#endif
+
+#define DIRREAD_BUFSZ 65536
+
+struct dirread {
+    int fd;
+    char *buf;
+    size_t bufsz, pos, len;
+#ifndef DR_GETDENTS
+    DIR *dp;
+#endif
+};
+
+struct dr_entry {
+    const char *name;
+    unsigned char type;
+    ino_t ino;
+};
+
+#ifdef DR_GETDENTS
+/* The layout of the records 'getdents64' writes into the buffer ... */
+struct dr_dirent64 {
+    unsigned long long d_ino;
+    long long d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[1];
+};
+#endif
+
+static void dr_init (struct dirread *dr, size_t bufsz)
+{
+    dr->fd = -1; dr->buf = NULL;
+    dr->bufsz = (bufsz > 0 ? bufsz : DIRREAD_BUFSZ);
+    dr->pos = dr->len = 0;
+#ifndef DR_GETDENTS
+    dr->dp = NULL;
+#endif
+}
+
+static int dr_fdopen (struct dirread *dr, int fd)
+{
+#ifdef DR_GETDENTS
+    if (! dr->buf) {
+	ifnull (dr->buf = (char *) malloc (dr->bufsz)) {
+	    int ec = errno; close (fd); errno = ec; return -1;
+	}
+    }
+#else
+    ifnull (dr->dp = fdopendir (fd)) {
+	int ec = errno; close (fd); errno = ec; return -1;
+    }
+#endif
+    dr->fd = fd; dr->pos = dr->len = 0;
+    return 0;
+}
+
+static int dr_next (struct dirread *dr, struct dr_entry *de)
+{
+#ifdef DR_GETDENTS
+    struct dr_dirent64 *d;
+    const char *name;
+    long rc;
+    for (;;) {
+	if (dr->pos >= dr->len) {
+	    rc = syscall (SYS_getdents64, dr->fd, dr->buf, dr->bufsz);
+	    if (rc < 0) { return -1; }
+	    if (rc == 0) { return 0; }
+	    dr->pos = 0; dr->len = (size_t) rc;
+	}
+	d = (struct dr_dirent64 *) (dr->buf + dr->pos);
+	dr->pos += d->d_reclen;
+	name = d->d_name;
+	if (*name == '\0') { continue; }
+	if (*name == '.'
+	&&  (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+	    continue;
+	}
+	de->name = name; de->type = d->d_type; de->ino = (ino_t) d->d_ino;
+	return 1;
+    }
+#else
+    struct dirent *d;
+    const char *name;
+    for (;;) {
+	errno = 0;
+	ifnull (d = readdir (dr->dp)) { return (errno ? -1 : 0); }
+	name = d->d_name;
+	if (*name == '\0') { continue; }
+	if (*name == '.'
+	&&  (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+	    continue;
+	}
+	de->name = name; de->type = d->d_type; de->ino = d->d_ino;
+	return 1;
+    }
+#endif
+}
+
+static int dr_close (struct dirread *dr)
+{
+    int rc = 0;
+#ifdef DR_GETDENTS
+    if (dr->fd >= 0) { rc = close (dr->fd); }
+#else
+    if (dr->dp) { rc = closedir (dr->dp); dr->dp = NULL; }
+#endif
+    dr->fd = -1; dr->pos = dr->len = 0;
+    return rc;
+}
+
+static void dr_free (struct dirread *dr)
+{
+    int ec = errno;
+    dr_close (dr);
+    if (dr->buf) { free (dr->buf); dr->buf = NULL; }
+    errno = ec;
+}
+
+#endif /*DIRREAD_C*/
@@ -0,0 +1,32 @@
+/* lib/dr_open.c
+**
+** $Id$
+**
+** Author: Boris Jakubith
+** E-Mail: runkharr@googlemail.com
+** Copyright: (c) 2026, Boris Jakubith <runkharr@googlemail.com>
+** License: GNU General Public License, version 2
+**
+** Synopsis:
+**    rc = dr_open (&dr, path);
+**
+** Opens the directory 'path' for reading with the directory reader 'dr'
+** ('lib/dirread.c'). Returns 0 on success and -1 (with 'errno' set) on
+** failure.
+**
+*/
+#ifndef DR_OPEN_C
+#define DR_OPEN_C
+
+#include <fcntl.h>
+
+#include "lib/dirread.c"
+
+static int dr_open (struct dirread *dr, const char *path)
+{
+    int fd = open (path, O_RDONLY|O_DIRECTORY);
+    if (fd < 0) { return -1; }
+    return dr_fdopen (dr, fd);
+}
+
+#endif /*DR_OPEN_C*/
@@ -0,0 +1,610 @@
+/* lib/elfstrip.c
+**
+** $Id$
+**
+** Author: Boris Jakubith
+** E-Mail: runkharr@googlemail.com
+** Copyright: (c) 2026, Boris Jakubith <runkharr@googlemail.com>
+** License: GNU General Public License, version 2
+**
+** In-process removal of the symbol table and the debugging sections from an
+** ELF object file (executable or shared library). The stripped image is
+** written directly to the destination file, so no external 'strip' program
+** and no second pass over the installed file is required.
+**
+** Synopsis:
+**    int rc = elf_strip (sfd, dfd, dbgfd, dbgname);
+**
+** 'sfd' is the (read-only) descriptor of the source file and 'dfd' the
+** descriptor of the (empty) destination file. If 'dbgfd' is not negative,
+** the removed debugging information is written to this descriptor first
+** (in the same way as 'objcopy --only-keep-debug' does it) and a section
+** '.gnu_debuglink' referring to the basename of 'dbgname' is added to the
+** stripped file.
+**
+** Return values:
+**    0  the stripped image was written to 'dfd' (and 'dbgfd'),
+**    1  the source is no ELF file which can be handled here (neither
+**       executable nor shared library, a foreign byte order or extended
+**       section numbering); nothing was written, the file should be copied
+**       (and probably stripped) in the conventional way,
+**   -1  an error occurred ('errno' describes it).
+**
+*/
+#ifndef ELFSTRIP_C
+#define ELFSTRIP_C
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <elf.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "lib/mrmacs.c"
+
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+# define ES_HOSTDATA ELFDATA2MSB
+#else
+# define ES_HOSTDATA ELFDATA2LSB
+#endif
+
+#define ES_DEBUGLINK ".gnu_debuglink"
+
+/* Output state: the descriptor, the current write position and a running
+** CRC32 (required for the '.gnu_debuglink' section) ...
+*/
+struct es_out {
+    int fd;
+    off_t pos;
+    unsigned int crc;
+};
+
+/* The (already converted) headers of the ELF image being processed. ELF32
+** headers are widened to their ELF64 counterparts, so the remaining code
+** needs only one type of them.
+*/
+struct es_elf {
+    const unsigned char *img;
+    size_t imgsz;
+    int is64;
+    Elf64_Ehdr eh;
+    Elf64_Shdr *sh;
+    const char *shstr;
+    size_t shstrsz;
+};
+
+/* The CRC-32 (polynomial 0xEDB88320) table. It is constant (instead of
+** being filled on the first use), so 'es_crc32()' may be used by several
+** threads at once ...
+*/
+static const unsigned int es_crctab[256] = {
+    0x00000000u, 0x77073096u, 0xEE0E612Cu, 0x990951BAu, 0x076DC419u,
+    0x706AF48Fu, 0xE963A535u, 0x9E6495A3u, 0x0EDB8832u, 0x79DCB8A4u,
+    0xE0D5E91Eu, 0x97D2D988u, 0x09B64C2Bu, 0x7EB17CBDu, 0xE7B82D07u,
+    0x90BF1D91u, 0x1DB71064u, 0x6AB020F2u, 0xF3B97148u, 0x84BE41DEu,
+    0x1ADAD47Du, 0x6DDDE4EBu, 0xF4D4B551u, 0x83D385C7u, 0x136C9856u,
+    0x646BA8C0u, 0xFD62F97Au, 0x8A65C9ECu, 0x14015C4Fu, 0x63066CD9u,
+    0xFA0F3D63u, 0x8D080DF5u, 0x3B6E20C8u, 0x4C69105Eu, 0xD56041E4u,
+    0xA2677172u, 0x3C03E4D1u, 0x4B04D447u, 0xD20D85FDu, 0xA50AB56Bu,
+    0x35B5A8FAu, 0x42B2986Cu, 0xDBBBC9D6u, 0xACBCF940u, 0x32D86CE3u,
+    0x45DF5C75u, 0xDCD60DCFu, 0xABD13D59u, 0x26D930ACu, 0x51DE003Au,
+    0xC8D75180u, 0xBFD06116u, 0x21B4F4B5u, 0x56B3C423u, 0xCFBA9599u,
+    0xB8BDA50Fu, 0x2802B89Eu, 0x5F058808u, 0xC60CD9B2u, 0xB10BE924u,
+    0x2F6F7C87u, 0x58684C11u, 0xC1611DABu, 0xB6662D3Du, 0x76DC4190u,
+    0x01DB7106u, 0x98D220BCu, 0xEFD5102Au, 0x71B18589u, 0x06B6B51Fu,
+    0x9FBFE4A5u, 0xE8B8D433u, 0x7807C9A2u, 0x0F00F934u, 0x9609A88Eu,
+    0xE10E9818u, 0x7F6A0DBBu, 0x086D3D2Du, 0x91646C97u, 0xE6635C01u,
+    0x6B6B51F4u, 0x1C6C6162u, 0x856530D8u, 0xF262004Eu, 0x6C0695EDu,
+    0x1B01A57Bu, 0x8208F4C1u, 0xF50FC457u, 0x65B0D9C6u, 0x12B7E950u,
+    0x8BBEB8EAu, 0xFCB9887Cu, 0x62DD1DDFu, 0x15DA2D49u, 0x8CD37CF3u,
+    0xFBD44C65u, 0x4DB26158u, 0x3AB551CEu, 0xA3BC0074u, 0xD4BB30E2u,
+    0x4ADFA541u, 0x3DD895D7u, 0xA4D1C46Du, 0xD3D6F4FBu, 0x4369E96Au,
+    0x346ED9FCu, 0xAD678846u, 0xDA60B8D0u, 0x44042D73u, 0x33031DE5u,
+    0xAA0A4C5Fu, 0xDD0D7CC9u, 0x5005713Cu, 0x270241AAu, 0xBE0B1010u,
+    0xC90C2086u, 0x5768B525u, 0x206F85B3u, 0xB966D409u, 0xCE61E49Fu,
+    0x5EDEF90Eu, 0x29D9C998u, 0xB0D09822u, 0xC7D7A8B4u, 0x59B33D17u,
+    0x2EB40D81u, 0xB7BD5C3Bu, 0xC0BA6CADu, 0xEDB88320u, 0x9ABFB3B6u,
+    0x03B6E20Cu, 0x74B1D29Au, 0xEAD54739u, 0x9DD277AFu, 0x04DB2615u,
+    0x73DC1683u, 0xE3630B12u, 0x94643B84u, 0x0D6D6A3Eu, 0x7A6A5AA8u,
+    0xE40ECF0Bu, 0x9309FF9Du, 0x0A00AE27u, 0x7D079EB1u, 0xF00F9344u,
+    0x8708A3D2u, 0x1E01F268u, 0x6906C2FEu, 0xF762575Du, 0x806567CBu,
+    0x196C3671u, 0x6E6B06E7u, 0xFED41B76u, 0x89D32BE0u, 0x10DA7A5Au,
+    0x67DD4ACCu, 0xF9B9DF6Fu, 0x8EBEEFF9u, 0x17B7BE43u, 0x60B08ED5u,
+    0xD6D6A3E8u, 0xA1D1937Eu, 0x38D8C2C4u, 0x4FDFF252u, 0xD1BB67F1u,
+    0xA6BC5767u, 0x3FB506DDu, 0x48B2364Bu, 0xD80D2BDAu, 0xAF0A1B4Cu,
+    0x36034AF6u, 0x41047A60u, 0xDF60EFC3u, 0xA867DF55u, 0x316E8EEFu,
+    0x4669BE79u, 0xCB61B38Cu, 0xBC66831Au, 0x256FD2A0u, 0x5268E236u,
+    0xCC0C7795u, 0xBB0B4703u, 0x220216B9u, 0x5505262Fu, 0xC5BA3BBEu,
+    0xB2BD0B28u, 0x2BB45A92u, 0x5CB36A04u, 0xC2D7FFA7u, 0xB5D0CF31u,
+    0x2CD99E8Bu, 0x5BDEAE1Du, 0x9B64C2B0u, 0xEC63F226u, 0x756AA39Cu,
+    0x026D930Au, 0x9C0906A9u, 0xEB0E363Fu, 0x72076785u, 0x05005713u,
+    0x95BF4A82u, 0xE2B87A14u, 0x7BB12BAEu, 0x0CB61B38u, 0x92D28E9Bu,
+    0xE5D5BE0Du, 0x7CDCEFB7u, 0x0BDBDF21u, 0x86D3D2D4u, 0xF1D4E242u,
+    0x68DDB3F8u, 0x1FDA836Eu, 0x81BE16CDu, 0xF6B9265Bu, 0x6FB077E1u,
+    0x18B74777u, 0x88085AE6u, 0xFF0F6A70u, 0x66063BCAu, 0x11010B5Cu,
+    0x8F659EFFu, 0xF862AE69u, 0x616BFFD3u, 0x166CCF45u, 0xA00AE278u,
+    0xD70DD2EEu, 0x4E048354u, 0x3903B3C2u, 0xA7672661u, 0xD06016F7u,
+    0x4969474Du, 0x3E6E77DBu, 0xAED16A4Au, 0xD9D65ADCu, 0x40DF0B66u,
+    0x37D83BF0u, 0xA9BCAE53u, 0xDEBB9EC5u, 0x47B2CF7Fu, 0x30B5FFE9u,
+    0xBDBDF21Cu, 0xCABAC28Au, 0x53B39330u, 0x24B4A3A6u, 0xBAD03605u,
+    0xCDD70693u, 0x54DE5729u, 0x23D967BFu, 0xB3667A2Eu, 0xC4614AB8u,
+    0x5D681B02u, 0x2A6F2B94u, 0xB40BBE37u, 0xC30C8EA1u, 0x5A05DF1Bu,
+    0x2D02EF8Du
+};
+
+static unsigned int es_crc32 (unsigned int crc, const void *p, size_t n)
+{
+    const unsigned char *q = (const unsigned char *) p;
+    crc = ~crc;
+    while (n-- > 0) { crc = es_crctab[(crc ^ *q++) & 0xFF] ^ (crc >> 8); }
+    return ~crc;
+}
+
+static int es_write (struct es_out *o, const void *p, size_t n)
+{
+    const char *q = (const char *) p;
+    ssize_t wlen;
+    o->crc = es_crc32 (o->crc, p, n);
+    while (n > 0) {
+	if ((wlen = write (o->fd, q, n)) < 0) {
+	    if (errno == EINTR) { continue; }
+	    return -1;
+	}
+	q += wlen; n -= (size_t) wlen; o->pos += wlen;
+    }
+    return 0;
+}
+
+/* Fill the output with zeroes up to the position 'to' ...
+*/
+static int es_pad (struct es_out *o, off_t to)
+{
+    static const char zeroes[256];
+    size_t n;
+    while (o->pos < to) {
+	n = (size_t) (to - o->pos);
+	if (n > sizeof(zeroes)) { n = sizeof(zeroes); }
+	if (es_write (o, zeroes, n)) { return -1; }
+    }
+    return 0;
+}
+
+static off_t es_align (off_t pos, Elf64_Xword align)
+{
+    if (align > 1) {
+	pos += (off_t) align - 1; pos -= pos % (off_t) align;
+    }
+    return pos;
+}
+
+static void es_get_shdr (struct es_elf *e, size_t ix, Elf64_Shdr *sh)
+{
+    const unsigned char *p = e->img + e->eh.e_shoff + ix * e->eh.e_shentsize;
+    if (e->is64) {
+	memcpy (sh, p, sizeof(Elf64_Shdr));
+    } else {
+	Elf32_Shdr s32;
+	memcpy (&s32, p, sizeof(s32));
+	sh->sh_name = s32.sh_name; sh->sh_type = s32.sh_type;
+	sh->sh_flags = s32.sh_flags; sh->sh_addr = s32.sh_addr;
+	sh->sh_offset = s32.sh_offset; sh->sh_size = s32.sh_size;
+	sh->sh_link = s32.sh_link; sh->sh_info = s32.sh_info;
+	sh->sh_addralign = s32.sh_addralign; sh->sh_entsize = s32.sh_entsize;
+    }
+}
+
+static int es_put_shdr (struct es_out *o, int is64, const Elf64_Shdr *sh)
+{
+    if (! is64) {
+	Elf32_Shdr s32;
+	s32.sh_name = sh->sh_name; s32.sh_type = sh->sh_type;
+	s32.sh_flags = (Elf32_Word) sh->sh_flags;
+	s32.sh_addr = (Elf32_Addr) sh->sh_addr;
+	s32.sh_offset = (Elf32_Off) sh->sh_offset;
+	s32.sh_size = (Elf32_Word) sh->sh_size;
+	s32.sh_link = sh->sh_link; s32.sh_info = sh->sh_info;
+	s32.sh_addralign = (Elf32_Word) sh->sh_addralign;
+	s32.sh_entsize = (Elf32_Word) sh->sh_entsize;
+	return es_write (o, &s32, sizeof(s32));
+    }
+    return es_write (o, sh, sizeof(Elf64_Shdr));
+}
+
+/* Write the ELF header with the (modified) section header table position,
+** section count and section name table index ...
+*/
+static int es_put_ehdr (struct es_out *o, struct es_elf *e, Elf64_Off shoff,
+			Elf64_Half shnum, Elf64_Half shstrndx)
+{
+    if (e->is64) {
+	Elf64_Ehdr eh;
+	memcpy (&eh, e->img, sizeof(eh));
+	eh.e_shoff = shoff; eh.e_shnum = shnum; eh.e_shstrndx = shstrndx;
+	eh.e_shentsize = sizeof(Elf64_Shdr);
+	return es_write (o, &eh, sizeof(eh));
+    } else {
+	Elf32_Ehdr eh;
+	memcpy (&eh, e->img, sizeof(eh));
+	eh.e_shoff = (Elf32_Off) shoff; eh.e_shnum = shnum;
+	eh.e_shstrndx = shstrndx; eh.e_shentsize = sizeof(Elf32_Shdr);
+	return es_write (o, &eh, sizeof(eh));
+    }
+}
+
+/* Check the image and extract the headers. Returns 1 if the image can't be
+** handled by 'elf_strip()' ...
+*/
+static int es_load (struct es_elf *e)
+{
+    const unsigned char *id = e->img;
+    size_t ix, shdrsz, phdrsz;
+    if (e->imgsz < EI_NIDENT || memcmp (id, ELFMAG, SELFMAG) != 0) {
+	return 1;
+    }
+    if (id[EI_DATA] != ES_HOSTDATA) { return 1; }
+    if (id[EI_CLASS] == ELFCLASS64) {
+	if (e->imgsz < sizeof(Elf64_Ehdr)) { return 1; }
+	e->is64 = 1; memcpy (&e->eh, e->img, sizeof(Elf64_Ehdr));
+	shdrsz = sizeof(Elf64_Shdr); phdrsz = sizeof(Elf64_Phdr);
+    } else if (id[EI_CLASS] == ELFCLASS32) {
+	Elf32_Ehdr eh;
+	if (e->imgsz < sizeof(Elf32_Ehdr)) { return 1; }
+	e->is64 = 0; memcpy (&eh, e->img, sizeof(eh));
+	memcpy (e->eh.e_ident, eh.e_ident, EI_NIDENT);
+	e->eh.e_type = eh.e_type; e->eh.e_ehsize = eh.e_ehsize;
+	e->eh.e_phoff = eh.e_phoff; e->eh.e_phnum = eh.e_phnum;
+	e->eh.e_phentsize = eh.e_phentsize;
+	e->eh.e_shoff = eh.e_shoff; e->eh.e_shnum = eh.e_shnum;
+	e->eh.e_shentsize = eh.e_shentsize; e->eh.e_shstrndx = eh.e_shstrndx;
+	shdrsz = sizeof(Elf32_Shdr); phdrsz = sizeof(Elf32_Phdr);
+    } else {
+	return 1;
+    }
+    /* Only executables and shared libraries; relocatable objects need
+    ** the symbols referenced by their relocations ...
+    */
+    if (e->eh.e_type != ET_EXEC && e->eh.e_type != ET_DYN) { return 1; }
+    if (e->eh.e_shoff == 0 || e->eh.e_shnum == 0
+    ||  e->eh.e_shstrndx == SHN_UNDEF || e->eh.e_shstrndx >= SHN_LORESERVE
+    ||  e->eh.e_shstrndx >= e->eh.e_shnum || e->eh.e_shentsize != shdrsz) {
+	return 1;
+    }
+    if (e->eh.e_shoff > e->imgsz
+    ||  (e->imgsz - e->eh.e_shoff) / shdrsz < e->eh.e_shnum) {
+	return 1;
+    }
+    /* The program headers are copied as 'Elf{32,64}_Phdr' structures, so
+    ** their size must be exactly that of these structures ...
+    */
+    if (e->eh.e_phnum > 0
+    &&  (e->eh.e_phentsize != phdrsz || e->eh.e_phoff > e->imgsz
+    ||   (e->imgsz - e->eh.e_phoff) / phdrsz < e->eh.e_phnum)) {
+	return 1;
+    }
+    ifnull (e->sh = t_allocv (Elf64_Shdr, e->eh.e_shnum)) { return -1; }
+    for (ix = 0; ix < e->eh.e_shnum; ++ix) {
+	es_get_shdr (e, ix, &e->sh[ix]);
+	if (e->sh[ix].sh_type != SHT_NOBITS
+	&&  (e->sh[ix].sh_offset > e->imgsz
+	||   e->imgsz - e->sh[ix].sh_offset < e->sh[ix].sh_size)) {
+	    cfree (e->sh); return 1;
+	}
+    }
+    e->shstr = (const char *) e->img + e->sh[e->eh.e_shstrndx].sh_offset;
+    e->shstrsz = e->sh[e->eh.e_shstrndx].sh_size;
+    return 0;
+}
+
+static const char *es_name (struct es_elf *e, size_t ix)
+{
+    Elf64_Word n = e->sh[ix].sh_name;
+    if (n >= e->shstrsz || ! memchr (e->shstr + n, 0, e->shstrsz - n)) {
+	return "";
+    }
+    return e->shstr + n;
+}
+
+static int es_is_debug (const char *name)
+{
+    return strncmp (name, ".debug", 6) == 0
+	|| strncmp (name, ".zdebug", 7) == 0
+	|| strcmp (name, ".stab") == 0
+	|| strcmp (name, ".stabstr") == 0;
+}
+
+/* Mark the sections to be removed. Only sections without the 'SHF_ALLOC'
+** flag (sections which are not part of the loaded program) are ever removed.
+*/
+static void es_mark_drops (struct es_elf *e, char *drop, int new_debuglink)
+{
+    size_t ix, shnum = e->eh.e_shnum;
+    int changed;
+    for (ix = 1; ix < shnum; ++ix) {
+	Elf64_Shdr *sh = &e->sh[ix];
+	const char *name = es_name (e, ix);
+	if ((sh->sh_flags & SHF_ALLOC) != 0) { continue; }
+	if (sh->sh_type == SHT_SYMTAB) {
+	    drop[ix] = 1;
+	    if (sh->sh_link > 0 && sh->sh_link < shnum
+	    &&  sh->sh_link != e->eh.e_shstrndx
+	    &&  (e->sh[sh->sh_link].sh_flags & SHF_ALLOC) == 0) {
+		drop[sh->sh_link] = 1;
+	    }
+	} else if (es_is_debug (name)) {
+	    drop[ix] = 1;
+	} else if (new_debuglink && strcmp (name, ES_DEBUGLINK) == 0) {
+	    drop[ix] = 1;
+	}
+    }
+    /* Remove (non-allocated) sections which refer to removed ones (e.g.
+    ** the relocations of debugging sections) ...
+    */
+    do {
+	changed = 0;
+	for (ix = 1; ix < shnum; ++ix) {
+	    Elf64_Shdr *sh = &e->sh[ix];
+	    if (drop[ix] || (sh->sh_flags & SHF_ALLOC) != 0) { continue; }
+	    if ((sh->sh_link > 0 && sh->sh_link < shnum && drop[sh->sh_link])
+	    ||  ((sh->sh_type == SHT_REL || sh->sh_type == SHT_RELA)
+	    &&   sh->sh_info > 0 && sh->sh_info < shnum
+	    &&   drop[sh->sh_info])) {
+		drop[ix] = 1; changed = 1;
+	    }
+	}
+    } while (changed);
+}
+
+/* Sections whose contents are kept in the debugging information file: all
+** non-allocated sections and the notes (e.g. the build-id) ...
+*/
+static int es_debug_data (const Elf64_Shdr *sh)
+{
+    if (sh->sh_type == SHT_NOBITS) { return 0; }
+    return (sh->sh_flags & SHF_ALLOC) == 0 || sh->sh_type == SHT_NOTE;
+}
+
+/* Write the removed debugging information in the way 'objcopy
+** --only-keep-debug' does it: all sections are kept (with their original
+** indices), but the contents of the allocated sections (save from the notes)
+** are omitted (they become 'SHT_NOBITS').
+*/
+static int es_write_debug (struct es_elf *e, int dbgfd, unsigned int *_crc)
+{
+    struct es_out o;
+    size_t ix, hdrend = e->eh.e_ehsize;
+    Elf64_Shdr sh;
+    Elf64_Off shoff;
+    off_t pos;
+    o.fd = dbgfd; o.pos = 0; o.crc = 0;
+    if (e->eh.e_phnum > 0) {
+	size_t phend = e->eh.e_phoff + e->eh.e_phnum * e->eh.e_phentsize;
+	if (phend > hdrend) { hdrend = phend; }
+    }
+    /* Pass 1: determine the position of the section header table ... */
+    pos = (off_t) hdrend;
+    for (ix = 1; ix < e->eh.e_shnum; ++ix) {
+	sh = e->sh[ix];
+	if (! es_debug_data (&sh)) { continue; }
+	pos = es_align (pos, sh.sh_addralign) + (off_t) sh.sh_size;
+    }
+    shoff = (Elf64_Off) es_align (pos, 8);
+    /* Pass 2: write everything ... */
+    if (es_put_ehdr (&o, e, shoff, e->eh.e_shnum, e->eh.e_shstrndx)) {
+	return -1;
+    }
+    if (es_write (&o, e->img + o.pos, hdrend - (size_t) o.pos)) { return -1; }
+    for (ix = 1; ix < e->eh.e_shnum; ++ix) {
+	sh = e->sh[ix];
+	if (! es_debug_data (&sh)) { continue; }
+	if (es_pad (&o, es_align (o.pos, sh.sh_addralign))) { return -1; }
+	if (es_write (&o, e->img + sh.sh_offset, sh.sh_size)) { return -1; }
+    }
+    if (es_pad (&o, (off_t) shoff)) { return -1; }
+    pos = (off_t) hdrend;
+    for (ix = 0; ix < e->eh.e_shnum; ++ix) {
+	sh = e->sh[ix];
+	if (ix > 0) {
+	    if (! es_debug_data (&sh)) {
+		sh.sh_type = SHT_NOBITS; sh.sh_offset = (Elf64_Off) pos;
+	    } else {
+		pos = es_align (pos, sh.sh_addralign);
+		sh.sh_offset = (Elf64_Off) pos; pos += (off_t) sh.sh_size;
+	    }
+	}
+	if (es_put_shdr (&o, e->is64, &sh)) { return -1; }
+    }
+    *_crc = o.crc;
+    return 0;
+}
+
+/* Write the stripped image ...
+*/
+static int es_write_stripped (struct es_elf *e, const char *drop, int dfd,
+			      const char *dbglink, unsigned int dbgcrc)
+{
+    struct es_out o;
+    size_t ix, shnum = e->eh.e_shnum, nshnum, keep_end, shstrlen, dllen = 0;
+    size_t *newix = NULL, *oldix = NULL;
+    Elf64_Shdr sh, *nsh = NULL;
+    Elf64_Off shstroff, dloff = 0, shoff;
+    char *shstr = NULL, *p, *dlbuf = NULL;
+    off_t pos;
+    int rc = -1;
+
+    o.fd = dfd; o.pos = 0; o.crc = 0;
+    ifnull (newix = t_allocv (size_t, shnum)) { goto EXIT_POINT; }
+    ifnull (oldix = t_allocv (size_t, shnum + 1)) { goto EXIT_POINT; }
+    ifnull (nsh = t_allocv (Elf64_Shdr, shnum + 1)) { goto EXIT_POINT; }
+
+    /* Everything which is loaded (headers, segments, allocated sections) is
+    ** copied verbatim ...
+    */
+    keep_end = e->eh.e_ehsize;
+    for (ix = 0; ix < e->eh.e_phnum; ++ix) {
+	const unsigned char *php =
+	    e->img + e->eh.e_phoff + ix * e->eh.e_phentsize;
+	size_t end;
+	if (e->is64) {
+	    Elf64_Phdr ph; memcpy (&ph, php, sizeof(ph));
+	    end = ph.p_offset + ph.p_filesz;
+	} else {
+	    Elf32_Phdr ph; memcpy (&ph, php, sizeof(ph));
+	    end = ph.p_offset + ph.p_filesz;
+	}
+	if (end > keep_end) { keep_end = end; }
+    }
+    if (e->eh.e_phnum > 0) {
+	size_t phend = e->eh.e_phoff + e->eh.e_phnum * e->eh.e_phentsize;
+	if (phend > keep_end) { keep_end = phend; }
+    }
+    for (ix = 1; ix < shnum; ++ix) {
+	sh = e->sh[ix];
+	if ((sh.sh_flags & SHF_ALLOC) != 0 && sh.sh_type != SHT_NOBITS
+	&&  sh.sh_offset + sh.sh_size > keep_end) {
+	    keep_end = sh.sh_offset + sh.sh_size;
+	}
+    }
+    if (keep_end > e->imgsz) { errno = EINVAL; goto EXIT_POINT; }
+
+    /* The new section name table; it has the size of the old one plus the
+    ** size of the '.gnu_debuglink' name at most ...
+    */
+    ifnull (shstr = t_allocv (char, e->shstrsz + sizeof(ES_DEBUGLINK) + 1)) {
+	goto EXIT_POINT;
+    }
+    p = shstr; *p++ = '\0';
+
+    /* Build the new section header table ... */
+    memset (&nsh[0], 0, sizeof(Elf64_Shdr));
+    nshnum = 1; pos = (off_t) keep_end;
+    for (ix = 1; ix < shnum; ++ix) {
+	if (drop[ix]) { newix[ix] = 0; continue; }
+	newix[ix] = nshnum; oldix[nshnum] = ix;
+	sh = e->sh[ix];
+	sh.sh_name = (Elf64_Word) (p - shstr);
+	p = stpcpy (p, es_name (e, ix)) + 1;
+	if (ix != e->eh.e_shstrndx && (sh.sh_flags & SHF_ALLOC) == 0
+	&&  sh.sh_offset >= keep_end) {
+	    /* Non-loaded sections behind the loaded part are moved ... */
+	    pos = es_align (pos, sh.sh_addralign);
+	    sh.sh_offset = (Elf64_Off) pos;
+	    if (sh.sh_type != SHT_NOBITS) { pos += (off_t) sh.sh_size; }
+	}
+	nsh[nshnum++] = sh;
+    }
+    if (dbglink) {
+	const char *dlname = strrchr (dbglink, '/');
+	dlname = (dlname ? dlname + 1 : dbglink);
+	dllen = strlen (dlname) + 1; dllen += (4 - dllen % 4) % 4; dllen += 4;
+	ifnull (dlbuf = t_allocv (char, dllen)) { goto EXIT_POINT; }
+	memset (dlbuf, 0, dllen); strcpy (dlbuf, dlname);
+	memcpy (dlbuf + dllen - 4, &dbgcrc, 4);
+	memset (&nsh[nshnum], 0, sizeof(Elf64_Shdr));
+	nsh[nshnum].sh_name = (Elf64_Word) (p - shstr);
+	p = stpcpy (p, ES_DEBUGLINK) + 1;
+	nsh[nshnum].sh_type = SHT_PROGBITS;
+	nsh[nshnum].sh_addralign = 4;
+	nsh[nshnum].sh_size = dllen;
+	++nshnum;
+    }
+    shstrlen = (size_t) (p - shstr);
+
+    /* The section name table and the debuglink are placed at the end ... */
+    shstroff = (Elf64_Off) pos; pos += (off_t) shstrlen;
+    if (dlbuf) {
+	pos = es_align (pos, 4); dloff = (Elf64_Off) pos;
+	nsh[nshnum - 1].sh_offset = dloff; pos += (off_t) dllen;
+    }
+    shoff = (Elf64_Off) es_align (pos, 8);
+
+    /* Fix the links between the sections ... */
+    for (ix = 1; ix < nshnum; ++ix) {
+	Elf64_Shdr *s = &nsh[ix];
+	if (dlbuf && ix == nshnum - 1) { continue; }
+	if (s->sh_link > 0 && s->sh_link < shnum) {
+	    s->sh_link = (Elf64_Word) newix[s->sh_link];
+	}
+	if ((s->sh_type == SHT_REL || s->sh_type == SHT_RELA
+	||   (s->sh_flags & SHF_INFO_LINK) != 0)
+	&&  s->sh_info > 0 && s->sh_info < shnum) {
+	    s->sh_info = (Elf64_Word) newix[s->sh_info];
+	}
+    }
+    ix = newix[e->eh.e_shstrndx];
+    nsh[ix].sh_offset = shstroff; nsh[ix].sh_size = shstrlen;
+
+    /* Write it all ... */
+    if (es_put_ehdr (&o, e, shoff, (Elf64_Half) nshnum, (Elf64_Half) ix)) {
+	goto EXIT_POINT;
+    }
+    if (es_write (&o, e->img + o.pos, keep_end - (size_t) o.pos)) {
+	goto EXIT_POINT;
+    }
+    for (ix = 1; ix < nshnum; ++ix) {
+	sh = nsh[ix];
+	if (sh.sh_type == SHT_NOBITS || sh.sh_offset < keep_end
+	||  sh.sh_offset == shstroff || (dlbuf && ix == nshnum - 1)) {
+	    continue;
+	}
+	if (es_pad (&o, (off_t) sh.sh_offset)) { goto EXIT_POINT; }
+	if (es_write (&o, e->img + e->sh[oldix[ix]].sh_offset, sh.sh_size)) {
+	    goto EXIT_POINT;
+	}
+    }
+    if (es_pad (&o, (off_t) shstroff)) { goto EXIT_POINT; }
+    if (es_write (&o, shstr, shstrlen)) { goto EXIT_POINT; }
+    if (dlbuf) {
+	if (es_pad (&o, (off_t) dloff)) { goto EXIT_POINT; }
+	if (es_write (&o, dlbuf, dllen)) { goto EXIT_POINT; }
+    }
+    if (es_pad (&o, (off_t) shoff)) { goto EXIT_POINT; }
+    for (ix = 0; ix < nshnum; ++ix) {
+	if (es_put_shdr (&o, e->is64, &nsh[ix])) { goto EXIT_POINT; }
+    }
+    rc = 0;
+EXIT_POINT:
+    {
+	int ec = errno;
+	cfree (newix); cfree (oldix); cfree (nsh); cfree (shstr); cfree (dlbuf);
+	errno = ec;
+    }
+    return rc;
+}
+
+static int elf_strip (int sfd, int dfd, int dbgfd, const char *dbgname)
+{
+    struct stat sb;
+    struct es_elf e;
+    char *drop = NULL;
+    void *img;
+    unsigned int dbgcrc = 0;
+    int rc, ec;
+
+    if (fstat (sfd, &sb)) { return -1; }
+    if (! S_ISREG (sb.st_mode) || sb.st_size < EI_NIDENT) { return 1; }
+    img = mmap (NULL, (size_t) sb.st_size, PROT_READ, MAP_PRIVATE, sfd, 0);
+    if (img == MAP_FAILED) { return -1; }
+    memset (&e, 0, sizeof(e));
+    e.img = (const unsigned char *) img; e.imgsz = (size_t) sb.st_size;
+    if ((rc = es_load (&e))) { goto EXIT_POINT; }
+    ifnull (drop = t_allocv (char, e.eh.e_shnum)) { rc = -1; goto EXIT_POINT; }
+    memset (drop, 0, e.eh.e_shnum);
+    es_mark_drops (&e, drop, (dbgfd >= 0));
+    if (dbgfd >= 0 && es_write_debug (&e, dbgfd, &dbgcrc)) {
+	rc = -1; goto EXIT_POINT;
+    }
+    rc = es_write_stripped (&e, drop, dfd, (dbgfd >= 0 ? dbgname : NULL),
+			    dbgcrc);
+EXIT_POINT:
+    ec = errno;
+    cfree (drop); cfree (e.sh);
+    munmap (img, (size_t) sb.st_size);
+    errno = ec;
+    return rc;
+}
+
+#endif /*ELFSTRIP_C*/
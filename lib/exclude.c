@@ -0,0 +1,513 @@
+/* lib/exclude.c
+**
+** $Id$
+**
+** Author: Boris Jakubith
+** E-Mail: runkharr@googlemail.com
+** Copyright: (c) 2026, Boris Jakubith <runkharr@googlemail.com>
+** License: GNU General Public License, version 2
+**
+** The exclude rules which are shared by 'distfile', 'exclude_list' (and via
+** 'exclude_list' by 'srcdist'). The rules are taken from exclude files (one
+** rule per line; empty lines, lines beginning with a '#' and leading white
+** space are ignored) or given directly. A rule is one of
+**
+**    [:]pattern    the pathname matches the glob pattern (see 'lib/rxdfa.c');
+**                  a pattern not beginning with '/', './' or '../' gets the
+**                  prefix './' (and trailing '/'s are removed),
+**    !!string      the pathname is 'string',
+**    !$string      the pathname ends with 'string',
+**    !^string      the pathname begins with 'string',
+**    ![:]string    the pathname contains 'string',
+**    ~regex        the (POSIX extended) regular expression 'regex' matches a
+**                  part of the pathname; '\s', '\d', '\w' (and '\S', '\D',
+**                  '\W') denote the usual character classes, and everything
+**                  between '\Q' and '\E' is matched literally.
+**
+** A pathname matched by a rule is excluded together with everything below it.
+** All rules but the '~' ones are compiled into one DFA ('lib/rxdfa.c'), so a
+** pathname is checked against all of them in one pass.
+**
+** The compiled rules can be kept in a cache file, which is mapped into memory
+** by the next call (instead of compiling the rules again). This file has a
+** version number and contains the modification time and size of each exclude
+** file (and the text of each rule given directly), so it is compiled anew if
+** one of these changed.
+**
+** Synopsis:
+**    struct ex_source src[] = { { "excludes", NULL }, { NULL, "!!./x" } };
+**    struct exclude ex;
+**
+**    rc = ex_open (&ex, cachefile, 2, src);
+**    if (ex_match (&ex, path, strlen (path))) { ... excluded ... }
+**    ex_free (&ex);
+**
+** 'cachefile' may be NULL (no cache file). A missing exclude file counts as
+** an empty one. A relative pathname (not beginning with './' or '../') is
+** matched as if it had the prefix './'.
+**
+** Return values: 'ex_open()' returns 0 on success and -1 (with 'errno' set)
+** on failure; if a regular expression is invalid, 'errno' is set to EINVAL
+** and 'ex.errmsg' describes the error. Failing to write the cache file is
+** not an error, but leaves the reason in 'ex.cache_errno'. 'ex_match()'
+** returns 1 if the pathname is excluded and 0 otherwise.
+**
+*/
+#ifndef EXCLUDE_C
+#define EXCLUDE_C
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <regex.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "lib/mrmacs.c"
+#include "lib/isws.c"
+#include "lib/bgetline.c"
+#include "lib/mapfile.c"
+#include "lib/strlist.c"
+#include "lib/rxdfa.c"
+
+struct ex_source {
+    const char *path;		/* an exclude file, or */
+    const char *rule;		/* a single rule */
+};
+
+struct exclude {
+    struct rxdfa dfa;
+    uint32_t dot;		/* (the state after './') */
+    regex_t *rxv;
+    size_t nrx;
+    char *meta;			/* (the compiled rules) */
+    size_t metalen;
+    struct mapfile mf;		/* (the cache file) */
+    int cache_errno;
+    char errmsg[256];
+};
+
+/* THE CACHE FILE. A header, followed by one record for each source (and
+** for each regular expression) and then the image of the DFA. Each record
+** consists of a 'struct ex_rec' and the NUL-terminated text (the pathname of
+** the exclude file, the rule or the regular expression), padded to a multiple
+** of 8 bytes.
+*/
+#define EX_MAGIC "EXCLUDE\n"
+#define EX_VERSION 1
+#define EX_ORDER 0x01020304
+
+enum { EXR_FILE = 1, EXR_RULE, EXR_REGEX };
+
+struct ex_hdr {
+    char magic[8];
+    uint32_t version, order;
+    uint32_t nsrc, nrx;
+    uint64_t dfa_ofs, dfa_size;
+};
+
+struct ex_rec {
+    int64_t mtime, mtime_ns, size;	/* (size < 0: a missing file) */
+    uint32_t kind, len;
+};
+
+#define EX_ALIGN(n) (((n) + 7) & ~(size_t) 7)
+
+struct ex_buf {
+    char *data;
+    size_t len, size;
+};
+
+static int ex_put (struct ex_buf *b, const void *data, size_t len)
+{
+    if (b->len + len + 1 > b->size) {
+	size_t nsz = (b->size ? 2 * b->size : 1024);
+	char *p;
+	while (nsz < b->len + len + 1) { nsz *= 2; }
+	ifnull (p = t_realloc (char, b->data, nsz)) { return -1; }
+	b->data = p; b->size = nsz;
+    }
+    memcpy (b->data + b->len, data, len); b->len += len;
+    b->data[b->len] = '\0';
+    return 0;
+}
+
+#define ex_puts(b, s) (ex_put ((b), (s), strlen (s)))
+
+static int ex_record (struct ex_buf *b, int kind, const struct stat *sb,
+		      const char *text)
+{
+    static const char zeros[8] = { 0 };
+    struct ex_rec rec;
+    size_t len = strlen (text);
+    memset (&rec, 0, sizeof(rec));
+    rec.kind = (uint32_t) kind; rec.len = (uint32_t) len;
+    if (kind == EXR_FILE) {
+	if (sb) {
+	    rec.mtime = (int64_t) sb->st_mtim.tv_sec;
+	    rec.mtime_ns = (int64_t) sb->st_mtim.tv_nsec;
+	    rec.size = (int64_t) sb->st_size;
+	} else {
+	    rec.size = -1;
+	}
+    }
+    if (ex_put (b, &rec, sizeof(rec)) || ex_put (b, text, len + 1)) {
+	return -1;
+    }
+    return ex_put (b, zeros, EX_ALIGN (len + 1) - (len + 1));
+}
+
+/* THE RULES. Each rule is translated either into a glob pattern (with the
+** characters of a literal string quoted) or into a regular expression ...
+*/
+static int ex_quote (struct ex_buf *b, const char *s)
+{
+    for (; *s; ++s) {
+	if (strchr ("*?[\\", *s) && ex_put (b, "\\", 1)) { return -1; }
+	if (ex_put (b, s, 1)) { return -1; }
+    }
+    return 0;
+}
+
+static const char *ex_class (int class_type, int *_qmode)
+{
+    static const char *word_class = "0-9A-Z_a-z", *digit_class = "0-9";
+    static const char *blank_class = "\t\n\f\r ";
+    static char buf[32];
+    const char *pfx, *x_class;
+    if (*_qmode) {
+	if (class_type == 'E') { *_qmode = 0; return ""; }
+	goto ESCAPED_CHAR;
+    }
+    switch (class_type) {
+	case 's': pfx = "["; x_class = blank_class; break;
+	case 'S': pfx = "[^"; x_class = blank_class; break;
+	case 'd': pfx = "["; x_class = digit_class; break;
+	case 'D': pfx = "[^"; x_class = digit_class; break;
+	case 'w': pfx = "["; x_class = word_class; break;
+	case 'W': pfx = "[^"; x_class = word_class; break;
+	case 'Q': *_qmode = 1; return "";
+	default:  goto ESCAPED_CHAR;
+    }
+    strcpy (buf, pfx); strcat (buf, x_class); strcat (buf, "]");
+    return buf;
+ESCAPED_CHAR:
+    buf[0] = '\\'; buf[1] = (char) class_type; buf[2] = '\0';
+    return buf;
+}
+
+static int ex_unquote (struct ex_buf *b, const char *s)
+{
+    int qmode = 0, rc;
+    for (; *s; ++s) {
+	if (*s == '\\' && s[1]) {
+	    ++s; rc = ex_puts (b, ex_class (*s & 0xFF, &qmode));
+	} else if (qmode && strchr ("()[]{}*+?|^$.", *s)) {
+	    rc = (ex_put (b, "\\", 1) || ex_put (b, s, 1));
+	} else {
+	    rc = ex_put (b, s, 1);
+	}
+	if (rc) { return -1; }
+    }
+    return 0;
+}
+
+static int ex_rule (const char *p, struct strlist *pats, struct strlist *rxs,
+		    struct ex_buf *b)
+{
+    size_t len;
+    int rc;
+    b->len = 0;
+    if (*p == '~') {
+	if (ex_unquote (b, p + 1) || ex_put (b, "", 0)) { return -1; }
+	return (sl_append (rxs, b->data) ? 0 : -1);
+    }
+    if (*p == '!') {
+	++p;
+	if (*p == '!') {
+	    rc = ex_quote (b, p + 1);
+	} else if (*p == '$') {
+	    rc = (ex_put (b, "*", 1) || ex_quote (b, p + 1));
+	} else if (*p == '^') {
+	    rc = (ex_quote (b, p + 1) || ex_put (b, "*", 1));
+	} else {
+	    if (*p == ':') { ++p; }
+	    rc = (ex_put (b, "*", 1) || ex_quote (b, p) || ex_put (b, "*", 1));
+	}
+    } else {
+	if (*p == ':') { ++p; }
+	len = strlen (p);
+	while (len > 1 && p[len - 1] == '/') { --len; }
+	rc = 0;
+	if (*p != '/' && strncmp (p, "./", 2) != 0
+	&&  strncmp (p, "../", 3) != 0) {
+	    rc = ex_put (b, "./", 2);
+	}
+	rc = (rc || ex_put (b, p, len));
+    }
+    if (rc || ex_put (b, "", 0)) { return -1; }
+    return (sl_append (pats, b->data) ? 0 : -1);
+}
+
+/* Read the rules of the exclude file 'path' (recording it's modification
+** time and size - or that it is missing - in 'meta') ...
+*/
+static int ex_read (const char *path, struct ex_buf *meta,
+		    struct strlist *pats, struct strlist *rxs,
+		    struct ex_buf *b)
+{
+    struct stat sb;
+    FILE *file;
+    char *line = NULL, *p;
+    size_t linesz = 0;
+    ssize_t rc;
+    int ec;
+    if (!(file = fopen (path, "rb"))) {
+	if (errno != ENOENT) { return -1; }
+	return ex_record (meta, EXR_FILE, NULL, path);
+    }
+    if (fstat (fileno (file), &sb) || ex_record (meta, EXR_FILE, &sb, path)) {
+	goto ERROUT;
+    }
+    while ((rc = bgetline (file, line, linesz)) >= 0) {
+	p = line; while (isws (*p)) { ++p; }
+	if (*p == '\0' || *p == '#') { continue; }
+	if (ex_rule (p, pats, rxs, b)) { goto ERROUT; }
+    }
+    if (rc < -1 || ferror (file)) { goto ERROUT; }
+    fclose (file); cfree (line);
+    return 0;
+ERROUT:
+    ec = errno; fclose (file); cfree (line); errno = ec;
+    return -1;
+}
+
+static int ex_regcomp (struct exclude *ex, size_t nrx, const char **rxv)
+{
+    size_t ix;
+    int rc;
+    if (nrx == 0) { return 0; }
+    ifnull (ex->rxv = t_allocv (regex_t, nrx)) { return -1; }
+    for (ix = 0; ix < nrx; ++ix) {
+	if ((rc = regcomp (&ex->rxv[ix], rxv[ix], REG_EXTENDED|REG_NOSUB))) {
+	    size_t len;
+	    snprintf (ex->errmsg, sizeof(ex->errmsg), "%s - ", rxv[ix]);
+	    len = strlen (ex->errmsg);
+	    regerror (rc, &ex->rxv[ix], ex->errmsg + len,
+		      sizeof(ex->errmsg) - len);
+	    regfree (&ex->rxv[ix]);
+	    errno = EINVAL; return -1;
+	}
+	ex->nrx = ix + 1;
+    }
+    return 0;
+}
+
+/* Compile the rules (storing the header and the records in 'ex->meta') ... */
+static int ex_compile (struct exclude *ex, size_t nsrc,
+		       const struct ex_source *src)
+{
+    struct strlist pats = STRLIST_INIT, rxs = STRLIST_INIT;
+    struct ex_buf meta = { NULL, 0, 0 }, b = { NULL, 0, 0 };
+    struct ex_hdr hdr;
+    struct sl_item *it;
+    const char **pv = NULL;
+    size_t ix;
+    int rc = -1, ec;
+    memset (&hdr, 0, sizeof(hdr));
+    if (ex_put (&meta, &hdr, sizeof(hdr))) { goto CLEANUP; }
+    for (ix = 0; ix < nsrc; ++ix) {
+	if (src[ix].path) {
+	    if (ex_read (src[ix].path, &meta, &pats, &rxs, &b)) {
+		goto CLEANUP;
+	    }
+	} else if (ex_record (&meta, EXR_RULE, NULL, src[ix].rule)
+	       ||  ex_rule (src[ix].rule, &pats, &rxs, &b)) {
+	    goto CLEANUP;
+	}
+    }
+    for (it = rxs.first; it; it = it->next) {
+	if (ex_record (&meta, EXR_REGEX, NULL, it->str)) { goto CLEANUP; }
+    }
+    ifnull (pv = t_allocv (const char *, pats.count + rxs.count + 1)) {
+	goto CLEANUP;
+    }
+    for (ix = 0, it = pats.first; it; it = it->next) { pv[ix++] = it->str; }
+    if (rxdfa_compile (&ex->dfa, pats.count, pv, RXDFA_SUBTREE)) {
+	goto CLEANUP;
+    }
+    for (ix = 0, it = rxs.first; it; it = it->next) { pv[ix++] = it->str; }
+    if (ex_regcomp (ex, rxs.count, pv)) { goto CLEANUP; }
+    memcpy (hdr.magic, EX_MAGIC, sizeof(hdr.magic));
+    hdr.version = EX_VERSION; hdr.order = EX_ORDER;
+    hdr.nsrc = (uint32_t) nsrc; hdr.nrx = (uint32_t) rxs.count;
+    hdr.dfa_ofs = meta.len; hdr.dfa_size = ex->dfa.size;
+    memcpy (meta.data, &hdr, sizeof(hdr));
+    ex->meta = meta.data; ex->metalen = meta.len; meta.data = NULL;
+    rc = 0;
+CLEANUP:
+    ec = errno;
+    cfree (pv); cfree (meta.data); cfree (b.data);
+    sl_free (&pats); sl_free (&rxs);
+    errno = ec;
+    return rc;
+}
+
+/* Map the cache file and check if it is up to date (returns 0 if so) ... */
+static int ex_load (struct exclude *ex, const char *cachefile, size_t nsrc,
+		    const struct ex_source *src)
+{
+    const struct ex_hdr *hdr;
+    const struct ex_rec *rec;
+    const char *data, *text, **rxv = NULL;
+    struct stat sb;
+    size_t ofs, ix, size;
+    if (mf_open (&ex->mf, cachefile)) { return -1; }
+    data = ex->mf.data; size = ex->mf.size;
+    hdr = (const struct ex_hdr *) data;
+    if (size < sizeof(*hdr)
+    ||  memcmp (hdr->magic, EX_MAGIC, sizeof(hdr->magic)) != 0
+    ||  hdr->version != EX_VERSION || hdr->order != EX_ORDER
+    ||  hdr->nsrc != nsrc || hdr->dfa_ofs > size
+    ||  hdr->dfa_size != size - hdr->dfa_ofs) {
+	goto STALE;
+    }
+    ifnull (rxv = t_allocv (const char *, hdr->nrx + 1)) { goto ERROUT; }
+    for (ix = 0, ofs = sizeof(*hdr); ix < nsrc + hdr->nrx; ++ix) {
+	rec = (const struct ex_rec *) (data + ofs);
+	if (ofs + sizeof(*rec) > hdr->dfa_ofs) { goto STALE; }
+	text = data + ofs + sizeof(*rec);
+	ofs += sizeof(*rec) + EX_ALIGN (rec->len + 1);
+	if (ofs > hdr->dfa_ofs || text[rec->len] != '\0') { goto STALE; }
+	if (ix >= nsrc) {
+	    if (rec->kind != EXR_REGEX) { goto STALE; }
+	    rxv[ix - nsrc] = text;
+	} else if (src[ix].path) {
+	    if (rec->kind != EXR_FILE || strcmp (text, src[ix].path) != 0) {
+		goto STALE;
+	    }
+	    if (stat (src[ix].path, &sb)) {
+		if (errno != ENOENT || rec->size >= 0) { goto STALE; }
+	    } else if (rec->size != (int64_t) sb.st_size
+		   ||  rec->mtime != (int64_t) sb.st_mtim.tv_sec
+		   ||  rec->mtime_ns != (int64_t) sb.st_mtim.tv_nsec) {
+		goto STALE;
+	    }
+	} else if (rec->kind != EXR_RULE || strcmp (text, src[ix].rule)) {
+	    goto STALE;
+	}
+    }
+    if (ofs != hdr->dfa_ofs
+    ||  rxdfa_attach (&ex->dfa, data + ofs, (size_t) hdr->dfa_size)) {
+	goto STALE;
+    }
+    if (ex_regcomp (ex, hdr->nrx, rxv)) { goto ERROUT; }
+    free (rxv);
+    return 0;
+STALE:
+    errno = ESTALE;
+ERROUT:
+    cfree (rxv);
+    return -1;
+}
+
+/* Write the compiled rules to 'cachefile' (via a temporary file, which then
+** replaces 'cachefile') ...
+*/
+static int ex_save (struct exclude *ex, const char *cachefile)
+{
+    const char *p;
+    char *tmp;
+    size_t len;
+    ssize_t wr;
+    mode_t mode;
+    int fd, ec, part;
+    ifnull (tmp = t_allocv (char, strlen (cachefile) + 8)) { return -1; }
+    strcpy (tmp, cachefile); strcat (tmp, ".XXXXXX");
+    if ((fd = mkstemp (tmp)) < 0) { ec = errno; goto ERROUT; }
+    for (part = 0; part < 2; ++part) {
+	p = (part ? ex->dfa.image : ex->meta);
+	len = (part ? ex->dfa.size : ex->metalen);
+	for (; len > 0; p += wr, len -= (size_t) wr) {
+	    if ((wr = write (fd, p, len)) < 0) {
+		if (errno == EINTR) { wr = 0; continue; }
+		ec = errno; close (fd); unlink (tmp); goto ERROUT;
+	    }
+	}
+    }
+    mode = umask (0); umask (mode);
+    if (fchmod (fd, 0666 & ~mode)) {
+	ec = errno; close (fd); unlink (tmp); goto ERROUT;
+    }
+    if (close (fd) || rename (tmp, cachefile)) {
+	ec = errno; unlink (tmp); goto ERROUT;
+    }
+    free (tmp);
+    return 0;
+ERROUT:
+    free (tmp); errno = ec;
+    return -1;
+}
+
+static void ex_free (struct exclude *ex)
+{
+    size_t ix;
+    for (ix = 0; ix < ex->nrx; ++ix) { regfree (&ex->rxv[ix]); }
+    cfree (ex->rxv); ex->nrx = 0;
+    rxdfa_free (&ex->dfa);
+    cfree (ex->meta);
+    if (ex->mf.data) { mf_close (&ex->mf); }
+}
+
+static int ex_open (struct exclude *ex, const char *cachefile, size_t nsrc,
+		    const struct ex_source *src)
+{
+    memset (ex, 0, sizeof(*ex));
+    if (cachefile) {
+	if (ex_load (ex, cachefile, nsrc, src) == 0) { goto DONE; }
+	ex_free (ex); memset (ex, 0, sizeof(*ex));
+    }
+    if (ex_compile (ex, nsrc, src)) {
+	int ec = errno;
+	ex_free (ex); errno = ec;
+	return -1;
+    }
+    if (cachefile && ex_save (ex, cachefile)) { ex->cache_errno = errno; }
+DONE:
+    ex->dot = rxdfa_run (&ex->dfa, ex->dfa.start, "./", 2);
+    return 0;
+}
+
+static int ex_match (const struct exclude *ex, const char *path, size_t len)
+{
+    char sbuf[1024], *s;
+    size_t ix;
+    int rel, res = 0;
+    if (len == 0) { return 0; }
+    rel = ! (*path == '/' || (len == 1 && *path == '.')
+	     || (len >= 2 && memcmp (path, "./", 2) == 0)
+	     || (len >= 3 && memcmp (path, "../", 3) == 0));
+    if (rxdfa_accepts (&ex->dfa, rxdfa_run (&ex->dfa,
+					    (rel ? ex->dot : ex->dfa.start),
+					    path, len))) {
+	return 1;
+    }
+    if (ex->nrx == 0) { return 0; }
+    /* (The regular expressions need a NUL-terminated pathname) */
+    s = sbuf;
+    if (len + 3 > sizeof(sbuf)) {
+	ifnull (s = t_allocv (char, len + 3)) { return 0; }
+    }
+    if (rel) { s[0] = '.'; s[1] = '/'; }
+    memcpy (s + (rel ? 2 : 0), path, len); s[len + (rel ? 2 : 0)] = '\0';
+    for (ix = 0; ix < ex->nrx; ++ix) {
+	if (regexec (&ex->rxv[ix], s, 0, NULL, 0) == 0) { res = 1; break; }
+    }
+    if (s != sbuf) { free (s); }
+    return res;
+}
+
+#endif /*EXCLUDE_C*/
@@ -15,12 +15,32 @@
 ** index reeaches the end of the argument list. A `$$` or a single `$` at the
 ** end of the format string leads to `$` being printed itself.
 **
+** For formats which are used over and over again (e.g. in a loop), the
+** format string can be parsed once into a `struct fmt_spec` with
+** `fmt_compile()`; such a pre-parsed format is then used (with the same
+** semantics) by `fmt_cprint()` (printing to a FILE) and `fmt_cformat()`
+** (writing into a buffer of at least `fmt_clen()` + 1 bytes), neither of
+** which scans the format string again:
+**
+**    struct fmt_spec spec;
+**    if (fmt_compile (&spec, "# line $1 \"$2\"\n")) { ... error ... }
+**    fmt_cprint (out, &spec, numstr, filename);
+**
+**    const char *args[] = { numstr, filename };
+**    size_t len = fmt_clen (&spec, 2, args);
+**    ... buf = (allocate len + 1 bytes) ...
+**    fmt_cformat (buf, &spec, 2, args);
+**
+** `fmt_compile()` returns 0 on success and -1 (with `errno` set to E2BIG) if
+** the format has more than FMT_MAXPARTS placeholders.
+**
 */
 #ifndef FMT_C
 #define FMT_C
 
 #include <stdio.h>
 #include <stdarg.h>
+#include <string.h>
 #include <errno.h>
 
 #include "parseint.c"
@@ -97,6 +117,115 @@ static int _fmt_print (FILE *out, const char *fmt, ...)
     return (int) out_len;
 }
 
+/* A pre-parsed format consists of a sequence of parts, each one being a
+** literal text (a part of the format string) which is followed by the
+** argument with the (0-based) index `arg` (or by nothing if `arg` is < 0).
+*/
+#define FMT_MAXPARTS 16
+
+struct fmt_part {
+    const char *text;
+    size_t len;
+    int arg;
+};
+
+struct fmt_spec {
+    struct fmt_part part[FMT_MAXPARTS];
+    int count;
+};
+
+static int fmt_compile (struct fmt_spec *spec, const char *fmt)
+{
+    const char *p = fmt, *q;
+    int next_arg = 0, ix;
+    struct fmt_part *pt;
+    spec->count = 0;
+    for (;;) {
+	if (spec->count >= FMT_MAXPARTS) { errno = E2BIG; return -1; }
+	pt = &spec->part[spec->count++];
+	q = p - 1; while (*++q && *q != '$');
+	pt->text = p; pt->len = (size_t) (q - p); pt->arg = -1;
+	if (! *q) { break; }
+	p = q + 1;
+	if (! *p || *p == '$') {
+	    /* (The `$` is part of the literal text) */
+	    ++pt->len; if (*p) { ++p; }
+	} else if (*p == '#') {
+	    ++p; pt->arg = next_arg++;
+	} else if (parseint (p, &ix, &p, 0)) {
+	    ++pt->len;
+	} else if (ix > 0) {
+	    pt->arg = ix - 1;
+	}
+	if (! *p) { break; }
+    }
+    return 0;
+}
+
+/* Return the length of the output of `fmt_cformat()` ... */
+static size_t fmt_clen (const struct fmt_spec *spec,
+			int argc, const char *const *args)
+{
+    const struct fmt_part *pt = spec->part, *end = pt + spec->count;
+    size_t len = 0;
+    for (; pt < end; ++pt) {
+	len += pt->len;
+	if (pt->arg >= 0 && pt->arg < argc) { len += strlen (args[pt->arg]); }
+    }
+    return len;
+}
+
+/* Write the formatted output (terminated with a NUL character) to `buf`,
+** which must be large enough (see `fmt_clen()`). Returns the length of the
+** output.
+*/
+static size_t fmt_cformat (char *buf, const struct fmt_spec *spec,
+			   int argc, const char *const *args)
+{
+    const struct fmt_part *pt = spec->part, *end = pt + spec->count;
+    char *r = buf;
+    size_t len;
+    for (; pt < end; ++pt) {
+	memcpy (r, pt->text, pt->len); r += pt->len;
+	if (pt->arg >= 0 && pt->arg < argc) {
+	    len = strlen (args[pt->arg]);
+	    memcpy (r, args[pt->arg], len); r += len;
+	}
+    }
+    *r = '\0';
+    return (size_t) (r - buf);
+}
+
+static int fmt_cprintv (FILE *out, const struct fmt_spec *spec, va_list ap)
+{
+    const struct fmt_part *pt = spec->part, *end = pt + spec->count;
+    const char *args[FMT_MAXPARTS];
+    int argc = 0;
+    size_t out_len = 0;
+    while (argc < FMT_MAXPARTS && (args[argc] = va_arg (ap, char *))) {
+	++argc;
+    }
+    for (; pt < end; ++pt) {
+	fwrite (pt->text, 1, pt->len, out); out_len += pt->len;
+	if (pt->arg >= 0 && pt->arg < argc) {
+	    fputs (args[pt->arg], out); out_len += fmt_strlen (args[pt->arg]);
+	}
+    }
+    return (int) out_len;
+}
+
+# define fmt_cprint(out, spec, ...) \
+    (_fmt_cprint((out), (spec), ##__VA_ARGS__, NULL))
+static int _fmt_cprint (FILE *out, const struct fmt_spec *spec, ...)
+{
+    int out_len;
+    va_list ap;
+    va_start (ap, spec);
+    out_len = fmt_cprintv (out, spec, ap);
+    va_end (ap);
+    return out_len;
+}
+
 # ifdef __cplusplus
 }
 # endif
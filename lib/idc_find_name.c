@@ -0,0 +1,35 @@
+/* lib/idc_find_name.c
+**
+** $Id$
+**
+** Author: Boris Jakubith
+** E-Mail: runkharr@googlemail.com
+** Copyright: (c) 2026, Boris Jakubith <runkharr@googlemail.com>
+** License: GNU General Public License, version 2
+**
+** Synopsis:
+**    struct idc_entry *e = idc_find_name (&tab, name);
+**
+** Returns the cache entry of the name 'name' in the table 'tab' (see
+** 'lib/idcache.c'), or NULL if there is none (yet).
+**
+*/
+#ifndef IDC_FIND_NAME_C
+#define IDC_FIND_NAME_C
+
+#include <string.h>
+
+#include "lib/idcache.c"
+
+static struct idc_entry *idc_find_name (struct idc_table *tab,
+					const char *name)
+{
+    struct idc_entry *e;
+    if (tab->nbuckets == 0) { return NULL; }
+    for (e = tab->byname[idc_nhash (name, tab->nbuckets)]; e; e = e->nnext) {
+	if (! strcmp (e->name, name)) { break; }
+    }
+    return e;
+}
+
+#endif /*IDC_FIND_NAME_C*/
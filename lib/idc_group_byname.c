@@ -0,0 +1,44 @@
+/* lib/idc_group_byname.c
+**
+** $Id$
+**
+** Author: Boris Jakubith
+** E-Mail: runkharr@googlemail.com
+** Copyright: (c) 2026, Boris Jakubith <runkharr@googlemail.com>
+** License: GNU General Public License, version 2
+**
+** Synopsis:
+**    int rc = idc_group_byname (name, &gid);
+**
+** Resolves the group name 'name' into a group id (through the cache of
+** 'lib/idcache.c'). Returns 0 on success and -1 (with 'errno' set to
+** ENOENT) if the name is unknown.
+**
+*/
+#ifndef IDC_GROUP_BYNAME_C
+#define IDC_GROUP_BYNAME_C
+
+#include <errno.h>
+#include <grp.h>
+
+#include "lib/idcache.c"
+#include "lib/idc_find_name.c"
+
+static struct idc_table idc_groups = { NULL, NULL, 0, 0 };
+
+static int idc_group_byname (const char *name, gid_t *_gid)
+{
+    struct idc_entry *e = idc_find_name (&idc_groups, name);
+    if (! e) {
+	struct group *gr = getgrnam (name);
+	e = (gr ? idc_insert (&idc_groups, name, 1, (unsigned long) gr->gr_gid,
+			      NULL)
+		: idc_insert (&idc_groups, name, 0, 0, NULL));
+	if (! e) { return -1; }
+    }
+    if (! e->has_id) { errno = ENOENT; return -1; }
+    *_gid = (gid_t) e->id;
+    return 0;
+}
+
+#endif /*IDC_GROUP_BYNAME_C*/
@@ -0,0 +1,42 @@
+/* lib/idc_user_byname.c
+**
+** $Id$
+**
+** Author: Boris Jakubith
+** E-Mail: runkharr@googlemail.com
+** Copyright: (c) 2026, Boris Jakubith <runkharr@googlemail.com>
+** License: GNU General Public License, version 2
+**
+** Synopsis:
+**    int rc = idc_user_byname (name, &uid);
+**
+** Resolves the user name 'name' into a user id (through the cache of
+** 'lib/idcache.c'). Returns 0 on success and -1 (with 'errno' set to ENOENT)
+** if the name is unknown.
+**
+*/
+#ifndef IDC_USER_BYNAME_C
+#define IDC_USER_BYNAME_C
+
+#include <errno.h>
+#include <pwd.h>
+
+#include "lib/idcache.c"
+#include "lib/idc_find_name.c"
+
+static int idc_user_byname (const char *name, uid_t *_uid)
+{
+    struct idc_entry *e = idc_find_name (&idc_users, name);
+    if (! e) {
+	struct passwd *pw = getpwnam (name);
+	e = (pw ? idc_insert (&idc_users, name, 1, (unsigned long) pw->pw_uid,
+			      pw->pw_dir)
+		: idc_insert (&idc_users, name, 0, 0, NULL));
+	if (! e) { return -1; }
+    }
+    if (! e->has_id) { errno = ENOENT; return -1; }
+    *_uid = (uid_t) e->id;
+    return 0;
+}
+
+#endif /*IDC_USER_BYNAME_C*/
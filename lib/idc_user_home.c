@@ -0,0 +1,50 @@
+/* lib/idc_user_home.c
+**
+** $Id$
+**
+** Author: Boris Jakubith
+** E-Mail: runkharr@googlemail.com
+** Copyright: (c) 2026, Boris Jakubith <runkharr@googlemail.com>
+** License: GNU General Public License, version 2
+**
+** Synopsis:
+**    const char *home = idc_user_home (uid);
+**
+** Returns the home directory of the user 'uid' (through the cache of
+** 'lib/idcache.c'), or NULL (with 'errno' set to ENOENT) if the user id is
+** unknown. The returned string is owned by the cache.
+**
+*/
+#ifndef IDC_USER_HOME_C
+#define IDC_USER_HOME_C
+
+#include <errno.h>
+#include <pwd.h>
+
+#include "lib/idcache.c"
+
+static struct idc_entry *idc_find_id (struct idc_table *tab,
+				      unsigned long id)
+{
+    struct idc_entry *e;
+    if (tab->nbuckets == 0) { return NULL; }
+    for (e = tab->byid[idc_ihash (id, tab->nbuckets)]; e; e = e->inext) {
+	if (e->id == id) { break; }
+    }
+    return e;
+}
+
+static const char *idc_user_home (uid_t uid)
+{
+    struct idc_entry *e = idc_find_id (&idc_users, (unsigned long) uid);
+    if (! e) {
+	struct passwd *pw = getpwuid (uid);
+	e = idc_insert (&idc_users, (pw ? pw->pw_name : NULL), 1,
+			(unsigned long) uid, (pw ? pw->pw_dir : NULL));
+	if (! e) { return NULL; }
+    }
+    if (! e->home) { errno = ENOENT; return NULL; }
+    return e->home;
+}
+
+#endif /*IDC_USER_HOME_C*/
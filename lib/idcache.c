@@ -0,0 +1,128 @@
+/* lib/idcache.c
+**
+** $Id$
+**
+** Author: Boris Jakubith
+** E-Mail: runkharr@googlemail.com
+** Copyright: (c) 2026, Boris Jakubith <runkharr@googlemail.com>
+** License: GNU General Public License, version 2
+**
+** A cache for the user and group database lookups. Each user/group name or
+** id is resolved (via 'getpwnam()', 'getpwuid()', 'getgrnam()' or
+** 'getgrgid()') only once; unsuccessful lookups are cached, too. With NSS
+** backends like LDAP or sssd, each of these lookups may be expensive ...
+**
+** This file contains only the cache itself; the lookup functions are
+**    int rc = idc_user_byname (name, &uid);     ('lib/idc_user_byname.c')
+**    int rc = idc_group_byname (name, &gid);    ('lib/idc_group_byname.c')
+**    const char *home = idc_user_home (uid);    ('lib/idc_user_home.c')
+**
+** These functions are not thread-safe; programs with multiple threads must
+** serialize the calls.
+**
+*/
+#ifndef IDCACHE_C
+#define IDCACHE_C
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pwd.h>
+#include <grp.h>
+#include <sys/types.h>
+
+#include "lib/mrmacs.c"
+
+/* A cache entry. It is linked into the name chain (if the name is known)
+** and into the id chain (if the id is known); entries of unsuccessful
+** lookups have only one of the two ...
+*/
+struct idc_entry {
+    struct idc_entry *nnext, *inext;
+    unsigned long id;
+    int has_id;
+    char *name, *home;
+};
+
+struct idc_table {
+    struct idc_entry **byname, **byid;
+    size_t nbuckets, count;
+};
+
+static struct idc_table idc_users = { NULL, NULL, 0, 0 };
+
+static size_t idc_nhash (const char *name, size_t nbuckets)
+{
+    /* FNV-1a */
+    unsigned long h = 2166136261ul;
+    const unsigned char *p = (const unsigned char *) name;
+    while (*p) { h = (h ^ *p++) * 16777619ul; }
+    return (size_t) (h & (nbuckets - 1));
+}
+
+static size_t idc_ihash (unsigned long id, size_t nbuckets)
+{
+    return (size_t) ((id * 2654435761ul) >> 7) & (nbuckets - 1);
+}
+
+/* Double the number of buckets of 'tab' (allocating the initial buckets if
+** there are none) ...
+*/
+static int idc_grow (struct idc_table *tab)
+{
+    size_t ix, nb = (tab->nbuckets > 0 ? 2 * tab->nbuckets : 64);
+    struct idc_entry **bn, **bi, *e, *next;
+    if (! (bn = (struct idc_entry **) calloc (nb, sizeof(*bn)))) {
+	return -1;
+    }
+    if (! (bi = (struct idc_entry **) calloc (nb, sizeof(*bi)))) {
+	free (bn); return -1;
+    }
+    for (ix = 0; ix < tab->nbuckets; ++ix) {
+	for (e = tab->byname[ix]; e; e = next) {
+	    size_t h = idc_nhash (e->name, nb);
+	    next = e->nnext; e->nnext = bn[h]; bn[h] = e;
+	}
+	for (e = tab->byid[ix]; e; e = next) {
+	    size_t h = idc_ihash (e->id, nb);
+	    next = e->inext; e->inext = bi[h]; bi[h] = e;
+	}
+    }
+    if (tab->byname) { free (tab->byname); free (tab->byid); }
+    tab->byname = bn; tab->byid = bi; tab->nbuckets = nb;
+    return 0;
+}
+
+/* Insert a new entry into 'tab'. 'name' may be NULL (unknown id) and
+** 'has_id' false (unknown name) ...
+*/
+static struct idc_entry *idc_insert (struct idc_table *tab, const char *name,
+				     int has_id, unsigned long id,
+				     const char *home)
+{
+    struct idc_entry *e;
+    size_t nl = (name ? strlen (name) + 1 : 0);
+    size_t hl = (home ? strlen (home) + 1 : 0);
+    if (tab->count >= 2 * tab->nbuckets && idc_grow (tab)) { return NULL; }
+    ifnull (e = t_allocp (struct idc_entry, nl + hl)) { return NULL; }
+    e->name = e->home = NULL;
+    e->has_id = has_id; e->id = id;
+    if (name) {
+	size_t h = idc_nhash (name, tab->nbuckets);
+	e->name = (char *) e + sizeof(struct idc_entry);
+	memcpy (e->name, name, nl);
+	e->nnext = tab->byname[h]; tab->byname[h] = e;
+    }
+    if (home) {
+	e->home = (char *) e + sizeof(struct idc_entry) + nl;
+	memcpy (e->home, home, hl);
+    }
+    if (has_id) {
+	size_t h = idc_ihash (id, tab->nbuckets);
+	e->inext = tab->byid[h]; tab->byid[h] = e;
+    }
+    ++tab->count;
+    return e;
+}
+
+#endif /*IDCACHE_C*/
@@ -0,0 +1,107 @@
+/* lib/mapfile.c
+**
+** $Id$
+**
+** Author: Boris Jakubith
+** E-Mail: runkharr@googlemail.com
+** Copyright: (c) 2026, Boris Jakubith <runkharr@googlemail.com>
+** License: GNU General Public License, version 2
+**
+** Make the complete content of a file accessible as one (read-only) memory
+** area. A (non-empty) regular file is mapped into memory; anything else
+** (e.g. a pipe or a terminal) is read into an allocated buffer.
+**
+** Synopsis:
+**    struct mapfile mf;
+**
+**    rc = mf_open (&mf, path);
+**    ... mf.data[0] .. mf.data[mf.size - 1] ...
+**    mf_close (&mf);
+**
+** The content is not terminated with a NUL character. An empty file yields
+** a 'mf.size' of 0 (and a 'mf.data' which may not be dereferenced).
+**
+** Return values: 'mf_open()' returns 0 on success and -1 (with 'errno' set)
+** on failure.
+**
+*/
+#ifndef MAPFILE_C
+#define MAPFILE_C
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "lib/mrmacs.c"
+
+struct mapfile {
+    const char *data;
+    size_t size;
+    int mapped;
+};
+
+/* Read the file 'fd' into an allocated buffer ... */
+static int mf_read (struct mapfile *mf, int fd)
+{
+    char *buf = NULL, *p;
+    size_t bufsz = 0, len = 0;
+    ssize_t rc;
+    for (;;) {
+	if (len >= bufsz) {
+	    bufsz = (bufsz ? 2 * bufsz : 65536);
+	    ifnull (p = (char *) realloc (buf, bufsz)) { goto ERROUT; }
+	    buf = p;
+	}
+	if ((rc = read (fd, buf + len, bufsz - len)) < 0) {
+	    if (errno == EINTR) { continue; }
+	    goto ERROUT;
+	}
+	if (rc == 0) { break; }
+	len += (size_t) rc;
+    }
+    mf->data = buf; mf->size = len; mf->mapped = 0;
+    return 0;
+ERROUT:
+    cfree (buf);
+    return -1;
+}
+
+static int mf_open (struct mapfile *mf, const char *path)
+{
+    struct stat sb;
+    void *p;
+    int fd, rc = 0, ec;
+    mf->data = NULL; mf->size = 0; mf->mapped = 0;
+    if ((fd = open (path, O_RDONLY)) < 0) { return -1; }
+    if (fstat (fd, &sb)) { rc = -1; goto CLEANUP; }
+    if (S_ISREG (sb.st_mode) && sb.st_size > 0) {
+	p = mmap (NULL, (size_t) sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (p != MAP_FAILED) {
+	    mf->data = (const char *) p; mf->size = (size_t) sb.st_size;
+	    mf->mapped = 1;
+	    goto CLEANUP;
+	}
+    }
+    rc = mf_read (mf, fd);
+CLEANUP:
+    ec = errno; close (fd); errno = ec;
+    return rc;
+}
+
+static void mf_close (struct mapfile *mf)
+{
+    int ec = errno;
+    if (mf->mapped) {
+	munmap ((void *) mf->data, mf->size);
+    } else if (mf->data) {
+	free ((void *) mf->data);
+    }
+    mf->data = NULL; mf->size = 0; mf->mapped = 0;
+    errno = ec;
+}
+
+#endif /*MAPFILE_C*/
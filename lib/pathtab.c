@@ -0,0 +1,355 @@
+/* lib/pathtab.c
+**
+** $Id$
+**
+** Author: Boris Jakubith
+** E-Mail: runkharr@googlemail.com
+** Copyright: (c) 2026, Boris Jakubith <runkharr@googlemail.com>
+** License: GNU General Public License, version 2
+**
+** A table of (relative) pathnames, stored as a tree: each entry consists of
+** the index of it's parent directory and it's own name, so the common
+** prefixes of the pathnames are stored only once. The names are kept in one
+** contiguous pool; a hash table (keyed by parent index and name) finds the
+** entries. The pathnames can be walked in sorted order (each directory
+** immediately followed by it's sub-tree, the entries of a directory sorted
+** by their names), and two tables can be merged.
+**
+** Synopsis:
+**    struct pathtab t = PATHTAB_INIT;   (or: pt_init (&t);)
+**
+**    size_t ix = pt_addpath (&t, path);
+**    size_t ix = pt_add (&t, parent, name, len);
+**    size_t ix = pt_find (&t, parent, name, len);
+**    const char *name = pt_name (&t, ix);
+**    int rc = pt_walk (&t, op, data);
+**    int rc = pt_merge (&t, &other);
+**    pt_free (&t);
+**
+** A pathname consists of names separated by '/' characters; empty names
+** (leading, trailing or repeated slashes) are ignored, so the empty
+** pathname is the root entry (whose index is PT_ROOT). 'pt_addpath()' adds
+** an entry together with all of it's (missing) parent directories;
+** 'pt_add()' adds the entry 'name' (of length 'len') to the directory
+** 'parent'. Both return the index of the new (or already existing) entry,
+** whose 'flags' member ('t.v[ix].flags', initially 0) is for the use of the
+** caller. The indices remain valid until 'pt_free()'; the entries
+** '0 .. t.count - 1' can be iterated over directly (a parent directory
+** always has a smaller index than it's entries). 'pt_addpath()' remembers
+** the last parent directory, so adding the entries of one directory one
+** after another resolves the directory only once.
+**
+** 'pt_walk()' calls
+**    rc = op (path, ix, data);
+** for each entry (the root entry first, whose pathname is empty) in sorted
+** order; a non-zero 'rc' terminates the walk. 'pt_merge()' adds all entries
+** of 'other' to 't' (or-ing the flags of entries which exist in both).
+**
+** Return values:
+**   'pt_addpath()', 'pt_add()': PT_NONE (with 'errno' set) if no memory
+**   could be allocated; 'pt_find()': PT_NONE if the entry doesn't exist;
+**   'pt_walk()': 0 or the result of 'op()' which terminated the walk (-1 if
+**   no memory could be allocated); 'pt_merge()': 0 on success and -1 (with
+**   'errno' set) on failure.
+**
+*/
+#ifndef PATHTAB_C
+#define PATHTAB_C
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "lib/mrmacs.c"
+
+#define PT_NONE ((size_t) -1)
+#define PT_ROOT 0
+
+struct pt_entry {
+    size_t parent;		/* (PT_NONE for the root entry) */
+    size_t name;		/* (Offset of the name in the name pool) */
+    unsigned int hash, flags;
+};
+
+struct pathtab {
+    struct pt_entry *v;
+    size_t count, size;
+    char *names;
+    size_t nameslen, namessz;
+    size_t *ht, htsize;
+    size_t cdir;		/* The last parent directory of 'pt_addpath()' */
+    char *cpath;		/* (and it's pathname) */
+    size_t cpathlen, cpathsz;
+};
+
+#define PATHTAB_INIT { NULL, 0, 0, NULL, 0, 0, NULL, 0, PT_NONE, NULL, 0, 0 }
+
+typedef int (*ptwalkop_t) (const char *path, size_t ix, void *data);
+
+static void pt_init (struct pathtab *t)
+{
+    memset (t, 0, sizeof(*t)); t->cdir = PT_NONE;
+}
+
+static unsigned int pt_hash (size_t parent, const char *name, size_t len)
+{
+    /* FNV-1a (over the parent index and the name) */
+    unsigned int h = 2166136261u;
+    size_t ix;
+    for (ix = 0; ix < sizeof(parent); ++ix) {
+	h = (h ^ (unsigned char) (parent >> (8 * ix))) * 16777619u;
+    }
+    for (ix = 0; ix < len; ++ix) {
+	h = (h ^ (unsigned char) name[ix]) * 16777619u;
+    }
+    return h;
+}
+
+static const char *pt_name (struct pathtab *t, size_t ix)
+{
+    return t->names + t->v[ix].name;
+}
+
+/* Find the hash table slot of the entry (parent, name) - or the (empty)
+** slot where it is to be inserted ...
+*/
+static size_t *pt_slot (struct pathtab *t, size_t parent, const char *name,
+			size_t len, unsigned int hv)
+{
+    size_t mask = t->htsize - 1, hx = hv & mask, ix;
+    struct pt_entry *e;
+    const char *en;
+    for (;; hx = (hx + 1) & mask) {
+	if ((ix = t->ht[hx]) == PT_NONE) { break; }
+	e = &t->v[ix];
+	if (e->hash != hv || e->parent != parent) { continue; }
+	en = t->names + e->name;
+	if (! strncmp (en, name, len) && en[len] == '\0') { break; }
+    }
+    return &t->ht[hx];
+}
+
+/* Double the size of the hash table (keeping it at most half full) ... */
+static int pt_rehash (struct pathtab *t)
+{
+    size_t sz = (t->htsize > 0 ? 2 * t->htsize : 1024), ix, hx;
+    size_t *ht;
+    ifnull (ht = t_allocv (size_t, sz)) { return -1; }
+    for (ix = 0; ix < sz; ++ix) { ht[ix] = PT_NONE; }
+    for (ix = 0; ix < t->count; ++ix) {
+	for (hx = t->v[ix].hash & (sz - 1); ht[hx] != PT_NONE;
+	     hx = (hx + 1) & (sz - 1));
+	ht[hx] = ix;
+    }
+    cfree (t->ht);
+    t->ht = ht; t->htsize = sz;
+    return 0;
+}
+
+/* Create a new entry (without checking if it already exists) ... */
+static size_t pt_new (struct pathtab *t, size_t parent, const char *name,
+		      size_t len, unsigned int hv)
+{
+    struct pt_entry *e;
+    if (t->count >= t->size) {
+	size_t sz = (t->size > 0 ? 2 * t->size : 1024);
+	struct pt_entry *v = t_realloc (struct pt_entry, t->v, sz);
+	ifnull (v) { return PT_NONE; }
+	t->v = v; t->size = sz;
+    }
+    if (t->nameslen + len + 1 > t->namessz) {
+	size_t sz = (t->namessz > 0 ? 2 * t->namessz : 16384);
+	char *p;
+	while (sz < t->nameslen + len + 1) { sz *= 2; }
+	ifnull (p = t_realloc (char, t->names, sz)) { return PT_NONE; }
+	t->names = p; t->namessz = sz;
+    }
+    if (2 * (t->count + 1) > t->htsize && pt_rehash (t)) { return PT_NONE; }
+    e = &t->v[t->count];
+    e->parent = parent; e->name = t->nameslen;
+    e->hash = hv; e->flags = 0;
+    memcpy (t->names + t->nameslen, name, len);
+    t->names[t->nameslen + len] = '\0';
+    t->nameslen += len + 1;
+    *pt_slot (t, parent, name, len, hv) = t->count;
+    return t->count++;
+}
+
+static size_t pt_find (struct pathtab *t, size_t parent, const char *name,
+		       size_t len)
+{
+    if (t->count == 0) { return PT_NONE; }
+    return *pt_slot (t, parent, name, len, pt_hash (parent, name, len));
+}
+
+static size_t pt_add (struct pathtab *t, size_t parent, const char *name,
+		      size_t len)
+{
+    unsigned int hv;
+    size_t ix;
+    if (t->count == 0 && pt_new (t, PT_NONE, "", 0, 0) == PT_NONE) {
+	return PT_NONE;
+    }
+    hv = pt_hash (parent, name, len);
+    if ((ix = *pt_slot (t, parent, name, len, hv)) != PT_NONE) { return ix; }
+    return pt_new (t, parent, name, len, hv);
+}
+
+/* Resolve the names of 'path' (of length 'len'), adding the missing entries
+** if 'add' is set ...
+*/
+static size_t pt_resolve (struct pathtab *t, const char *path, size_t len,
+			  int add)
+{
+    const char *p = path, *end = path + len, *q;
+    size_t ix = PT_ROOT;
+    if (t->count == 0) {
+	if (! add) { return PT_NONE; }
+	if (pt_new (t, PT_NONE, "", 0, 0) == PT_NONE) { return PT_NONE; }
+    }
+    while (p < end && ix != PT_NONE) {
+	if (*p == '/') { ++p; continue; }
+	ifnull (q = (const char *) memchr (p, '/', (size_t) (end - p))) {
+	    q = end;
+	}
+	ix = (add ? pt_add (t, ix, p, (size_t) (q - p))
+		  : pt_find (t, ix, p, (size_t) (q - p)));
+	p = q;
+    }
+    return ix;
+}
+
+static size_t pt_addpath (struct pathtab *t, const char *path)
+{
+    const char *base = strrchr (path, '/');
+    size_t dlen, dir;
+    if (! base) { return pt_resolve (t, path, strlen (path), 1); }
+    dlen = (size_t) (base - path); ++base;
+    if (t->cdir != PT_NONE && dlen == t->cpathlen
+    &&  ! memcmp (path, t->cpath, dlen)) {
+	dir = t->cdir;
+    } else {
+	if ((dir = pt_resolve (t, path, dlen, 1)) == PT_NONE) {
+	    return PT_NONE;
+	}
+	if (dlen + 1 > t->cpathsz) {
+	    size_t sz = dlen + 128;
+	    char *p;
+	    ifnull (p = t_realloc (char, t->cpath, sz)) { return PT_NONE; }
+	    t->cpath = p; t->cpathsz = sz;
+	}
+	memcpy (t->cpath, path, dlen); t->cpathlen = dlen;
+	t->cdir = dir;
+    }
+    return (*base ? pt_add (t, dir, base, strlen (base)) : dir);
+}
+
+/* (The sorting key of an entry in 'pt_walk()') */
+struct pt_key {
+    const char *name;
+    size_t ix;
+};
+
+static int pt_keycmp (const void *a, const void *b)
+{
+    return strcmp (((const struct pt_key *) a)->name,
+		   ((const struct pt_key *) b)->name);
+}
+
+static int pt_walk (struct pathtab *t, ptwalkop_t op, void *data)
+{
+    struct pt_key *keys = NULL;
+    size_t *first = NULL, *stack = NULL, *lens = NULL;
+    size_t ix, sp, n, len, nlen, bufsz = 0, pos;
+    char *buf = NULL, *p;
+    int rc = -1;
+    if (t->count == 0) { return 0; }
+    /* Group the entries by their parent directories (the group of the
+    ** directory 'ix' starts at 'first[ix]' and ends at 'first[ix + 1]') and
+    ** sort each group by the names ...
+    */
+    ifnull (first = t_allocv (size_t, t->count + 1)) { goto CLEANUP; }
+    ifnull (keys = t_allocv (struct pt_key, t->count)) { goto CLEANUP; }
+    memset (first, 0, (t->count + 1) * sizeof(size_t));
+    for (ix = 1; ix < t->count; ++ix) { ++first[t->v[ix].parent + 1]; }
+    for (ix = 0; ix < t->count; ++ix) { first[ix + 1] += first[ix]; }
+    for (ix = 1; ix < t->count; ++ix) {
+	pos = first[t->v[ix].parent]++;
+	keys[pos].name = pt_name (t, ix); keys[pos].ix = ix;
+    }
+    /* (Filling the groups advanced 'first[p]' to the start of group p+1) */
+    for (ix = t->count; ix > 0; --ix) { first[ix] = first[ix - 1]; }
+    first[0] = 0;
+    for (ix = 0; ix < t->count; ++ix) {
+	if ((n = first[ix + 1] - first[ix]) > 1) {
+	    qsort (keys + first[ix], n, sizeof(struct pt_key), pt_keycmp);
+	}
+    }
+    /* Walk the tree depth-first; 'stack[sp]' is the position of the next
+    ** entry of the directory at depth 'sp', 'lens[sp]' the length of the
+    ** directory's pathname ...
+    */
+    ifnull (stack = t_allocv (size_t, t->count + 1)) { goto CLEANUP; }
+    ifnull (lens = t_allocv (size_t, t->count + 1)) { goto CLEANUP; }
+    ifnull (buf = t_allocv (char, (bufsz = 1024))) { goto CLEANUP; }
+    *buf = '\0';
+    if ((rc = op (buf, PT_ROOT, data))) { goto CLEANUP; }
+    sp = 0; stack[0] = first[PT_ROOT]; lens[0] = 0;
+    for (;;) {
+	/* (The end of the group of the current directory) */
+	ix = (sp == 0 ? PT_ROOT : keys[stack[sp - 1] - 1].ix);
+	if (stack[sp] >= first[ix + 1]) {
+	    if (sp == 0) { break; }
+	    --sp; continue;
+	}
+	ix = keys[stack[sp]++].ix;
+	len = lens[sp]; nlen = strlen (keys[stack[sp] - 1].name);
+	if (len + nlen + 2 > bufsz) {
+	    size_t sz = 2 * (len + nlen + 2);
+	    ifnull (p = t_realloc (char, buf, sz)) { rc = -1; goto CLEANUP; }
+	    buf = p; bufsz = sz;
+	}
+	if (len > 0) { buf[len++] = '/'; }
+	memcpy (buf + len, keys[stack[sp] - 1].name, nlen + 1);
+	if ((rc = op (buf, ix, data))) { goto CLEANUP; }
+	if (first[ix + 1] > first[ix]) {
+	    /* Descend into the directory ... */
+	    ++sp; stack[sp] = first[ix]; lens[sp] = len + nlen;
+	}
+    }
+    rc = 0;
+CLEANUP:
+    cfree (first); cfree (keys); cfree (stack); cfree (lens); cfree (buf);
+    return rc;
+}
+
+static int pt_merge (struct pathtab *t, struct pathtab *other)
+{
+    size_t *map, ix, nx;
+    if (other->count == 0) { return 0; }
+    ifnull (map = t_allocv (size_t, other->count)) { return -1; }
+    /* (The parent of an entry always precedes it) */
+    for (ix = 0; ix < other->count; ++ix) {
+	if (ix == PT_ROOT) {
+	    nx = (t->count > 0 ? PT_ROOT : pt_new (t, PT_NONE, "", 0, 0));
+	} else {
+	    const char *name = pt_name (other, ix);
+	    nx = pt_add (t, map[other->v[ix].parent], name, strlen (name));
+	}
+	if (nx == PT_NONE) { free (map); return -1; }
+	t->v[nx].flags |= other->v[ix].flags;
+	map[ix] = nx;
+    }
+    free (map);
+    return 0;
+}
+
+static void pt_free (struct pathtab *t)
+{
+    int ec = errno;
+    cfree (t->v); cfree (t->names); cfree (t->ht); cfree (t->cpath);
+    pt_init (t);
+    errno = ec;
+}
+
+#endif /*PATHTAB_C*/
@@ -0,0 +1,311 @@
+/* lib/pwalk.c
+**
+** $Id$
+**
+** Author: Boris Jakubith
+** E-Mail: runkharr@googlemail.com
+** Copyright: (c) 2026, Boris Jakubith <runkharr@googlemail.com>
+** License: GNU General Public License, version 2
+**
+** Parallel traversal of a directory tree. A pool of worker threads reads the
+** directories (each worker with it's own 'lib/dirread.c' reader); each
+** worker pushes the sub-directories it finds onto it's own queue (deque)
+** and takes the next directory from the end of this queue (depth-first).
+** A worker whose queue is empty steals a directory from the other end of
+** another worker's queue. The traversal is complete when no directory is
+** queued or being read anymore.
+**
+** Synopsis:
+**    int rc = pwalk (dirname, nworkers, flags, get_filetype,
+**                    visit, done, walkdata);
+**
+** 'flags' are the TRAV_... flags of 'lib/travdir-core.c'. 'visit()' is
+** called for each entry (and directory) as
+**    rc = visit (path, filetype, worker, walkdata);
+** where 'worker' is the number (0 .. nworkers-1) of the calling worker;
+** 'visit()' is called concurrently by the workers, so it should use
+** 'worker' for selecting the data it modifies. If 'done' isn't NULL, each
+** worker calls
+**    rc = done (worker, walkdata);
+** after the traversal is complete. The order in which the entries are
+** visited is not determined, except that a directory is visited before it's
+** entries. 'get_filetype()' is called only for entries whose type isn't
+** supplied by the file system.
+**
+** Return values: as for 'travdir_core()'; additionally, -4 if no worker
+** thread could be started.
+**
+*/
+#ifndef PWALK_C
+#define PWALK_C
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+
+#include "lib/mrmacs.c"
+#include "lib/dirread.c"
+#include "lib/dr_open.c"
+#include "lib/travdir-core.c"
+
+typedef int (*pwalkop_t) (const char *path, int filetype, int worker,
+			  void *walkdata);
+typedef int (*pwalkdone_t) (int worker, void *walkdata);
+
+/* The queue of a worker; the owner pushes and pops at 'tail', other workers
+** steal from 'head' ...
+*/
+struct pw_deque {
+    pthread_mutex_t lock;
+    char **items;
+    size_t head, tail, size;
+};
+
+struct pw_pool;
+
+struct pw_worker {
+    struct pw_pool *pool;
+    struct pw_deque dq;
+    pthread_t tid;
+    int id;
+    char *buf;
+    size_t bufsz;
+    struct dirread dr;
+};
+
+struct pw_pool {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    struct pw_worker *workers;
+    int nworkers, flags;
+    size_t pending;		/* Directories queued or being read */
+    unsigned long seq;		/* Incremented on each push */
+    int idle, rc, err;
+    getfiletype_t get_filetype;
+    pwalkop_t visit;
+    pwalkdone_t done;
+    void *walkdata;
+};
+
+static int pw_push (struct pw_deque *dq, char *item)
+{
+    pthread_mutex_lock (&dq->lock);
+    if (dq->tail >= dq->size) {
+	if (dq->head > 0) {
+	    memmove (dq->items, dq->items + dq->head,
+		     (dq->tail - dq->head) * sizeof(char *));
+	    dq->tail -= dq->head; dq->head = 0;
+	} else {
+	    size_t newsz = (dq->size > 0 ? 2 * dq->size : 64);
+	    char **items = t_realloc (char *, dq->items, newsz);
+	    if (! items) { pthread_mutex_unlock (&dq->lock); return -1; }
+	    dq->items = items; dq->size = newsz;
+	}
+    }
+    dq->items[dq->tail++] = item;
+    pthread_mutex_unlock (&dq->lock);
+    return 0;
+}
+
+static char *pw_take (struct pw_deque *dq, int steal)
+{
+    char *item = NULL;
+    pthread_mutex_lock (&dq->lock);
+    if (dq->head < dq->tail) {
+	item = (steal ? dq->items[dq->head++] : dq->items[--dq->tail]);
+	if (dq->head >= dq->tail) { dq->head = dq->tail = 0; }
+    }
+    pthread_mutex_unlock (&dq->lock);
+    return item;
+}
+
+/* Stop the traversal with the result code 'rc' ... */
+static void pw_stop (struct pw_pool *pool, int rc)
+{
+    int ec = errno;
+    pthread_mutex_lock (&pool->lock);
+    if (pool->rc == 0) { pool->rc = rc; pool->err = ec; }
+    pthread_cond_broadcast (&pool->cond);
+    pthread_mutex_unlock (&pool->lock);
+}
+
+/* Read the directory 'dir', visit it's entries and queue it's
+** sub-directories ...
+*/
+static int pw_dir (struct pw_worker *w, const char *dir)
+{
+    struct pw_pool *pool = w->pool;
+    int rc = 0, nr, filetype, ec;
+    int dirnotdone = (pool->flags & (TRAV_NODIRS|TRAV_NOEMPTY)) != 0;
+    size_t len = strlen (dir), nlen;
+    struct dr_entry de;
+    char *sd;
+
+    if (! dirnotdone) {
+	if ((rc = pool->visit (dir, FT_DIRECTORY, w->id, pool->walkdata))) {
+	    return rc;
+	}
+    }
+    if (dr_open (&w->dr, dir)) { return -2; }
+    while ((nr = dr_next (&w->dr, &de)) > 0) {
+	if (dirnotdone && (pool->flags & TRAV_NODIRS) == 0) {
+	    rc = pool->visit (dir, FT_DIRECTORY, w->id, pool->walkdata);
+	    if (rc) { break; }
+	}
+	dirnotdone = 0;
+	nlen = strlen (de.name);
+	if (len + nlen + 2 > w->bufsz) {
+	    size_t sz = len + nlen + 2 + 127;
+	    char *p;
+	    sz -= sz % 128;
+	    p = (char *) realloc (w->buf, sz);
+	    if (! p) { rc = -3; break; }
+	    w->buf = p; w->bufsz = sz;
+	}
+	memcpy (w->buf, dir, len); w->buf[len] = '/';
+	memcpy (w->buf + len + 1, de.name, nlen + 1);
+	if ((filetype = trav_filetype (de.type)) < 0) {
+	    if ((rc = pool->get_filetype (w->buf, &filetype))) { break; }
+	}
+	if (filetype == FT_DIRECTORY) {
+	    if (! (sd = strdup (w->buf))) { rc = -3; break; }
+	    /* The directory must be counted before it can be stolen ... */
+	    pthread_mutex_lock (&pool->lock);
+	    ++pool->pending;
+	    pthread_mutex_unlock (&pool->lock);
+	    if (pw_push (&w->dq, sd)) {
+		free (sd);
+		pthread_mutex_lock (&pool->lock);
+		--pool->pending;
+		pthread_mutex_unlock (&pool->lock);
+		rc = -3; break;
+	    }
+	    pthread_mutex_lock (&pool->lock);
+	    ++pool->seq;
+	    if (pool->idle > 0) { pthread_cond_signal (&pool->cond); }
+	    pthread_mutex_unlock (&pool->lock);
+	    continue;
+	}
+	if ((rc = pool->visit (w->buf, filetype, w->id, pool->walkdata))) {
+	    break;
+	}
+    }
+    if (nr < 0) { rc = -2; }
+    ec = errno; dr_close (&w->dr); errno = ec;
+    return rc;
+}
+
+static void *pw_worker (void *arg)
+{
+    struct pw_worker *w = (struct pw_worker *) arg;
+    struct pw_pool *pool = w->pool;
+    unsigned long seq;
+    char *dir;
+    int ix, rc;
+    for (;;) {
+	pthread_mutex_lock (&pool->lock);
+	seq = pool->seq;
+	if (pool->rc != 0 || pool->pending == 0) {
+	    pthread_mutex_unlock (&pool->lock); break;
+	}
+	pthread_mutex_unlock (&pool->lock);
+	/* Take a directory from the own queue or steal one ... */
+	dir = pw_take (&w->dq, 0);
+	for (ix = 1; ! dir && ix < pool->nworkers; ++ix) {
+	    dir = pw_take (&pool->workers[(w->id + ix) % pool->nworkers].dq, 1);
+	}
+	if (! dir) {
+	    /* Nothing to do; wait until directories are queued (unless this
+	    ** happened in the meantime) ...
+	    */
+	    pthread_mutex_lock (&pool->lock);
+	    if (pool->seq == seq && pool->rc == 0 && pool->pending > 0) {
+		++pool->idle;
+		pthread_cond_wait (&pool->cond, &pool->lock);
+		--pool->idle;
+	    }
+	    pthread_mutex_unlock (&pool->lock);
+	    continue;
+	}
+	rc = pw_dir (w, dir);
+	free (dir);
+	if (rc) { pw_stop (pool, rc); break; }
+	pthread_mutex_lock (&pool->lock);
+	if (--pool->pending == 0) { pthread_cond_broadcast (&pool->cond); }
+	pthread_mutex_unlock (&pool->lock);
+    }
+    if (pool->done && (rc = pool->done (w->id, pool->walkdata))) {
+	pw_stop (pool, rc);
+    }
+    return NULL;
+}
+
+static int
+pwalk (const char *dirname, int nworkers, int flags,
+       getfiletype_t get_filetype, pwalkop_t visit, pwalkdone_t done,
+       void *walkdata)
+{
+    struct pw_pool pool;
+    struct pw_worker *w;
+    char *root, *item;
+    int ix, nstarted = 0;
+
+    if (nworkers < 1) { errno = EINVAL; return -1; }
+    ifnull (pool.workers = t_allocv (struct pw_worker, nworkers)) {
+	return -3;
+    }
+    ifnull (root = strdup (dirname)) { free (pool.workers); return -3; }
+    pthread_mutex_init (&pool.lock, NULL);
+    pthread_cond_init (&pool.cond, NULL);
+    pool.nworkers = nworkers; pool.flags = flags;
+    pool.pending = 1; pool.seq = 0;
+    pool.idle = 0; pool.rc = 0; pool.err = 0;
+    pool.get_filetype = get_filetype; pool.visit = visit; pool.done = done;
+    pool.walkdata = walkdata;
+    for (ix = 0; ix < nworkers; ++ix) {
+	w = &pool.workers[ix];
+	memset (w, 0, sizeof(*w));
+	pthread_mutex_init (&w->dq.lock, NULL);
+	dr_init (&w->dr, 0);
+	w->pool = &pool; w->id = ix;
+    }
+    if (pw_push (&pool.workers[0].dq, root)) {
+	free (root); pool.rc = -3; pool.err = errno;
+    }
+    /* (The queues of workers which couldn't be started remain empty) */
+    for (ix = 0; pool.rc == 0 && ix < nworkers; ++ix) {
+	w = &pool.workers[ix];
+	if (pthread_create (&w->tid, NULL, pw_worker, w)) { break; }
+	++nstarted;
+    }
+    if (nstarted == 0 && pool.rc == 0) { pool.rc = -4; pool.err = errno; }
+    for (ix = 0; ix < nstarted; ++ix) {
+	pthread_join (pool.workers[ix].tid, NULL);
+    }
+    /* The 'done()' calls of the workers which couldn't be started ... */
+    if (nstarted > 0 && done) {
+	for (ix = nstarted; ix < nworkers; ++ix) {
+	    int rc = done (ix, walkdata);
+	    if (rc && pool.rc == 0) { pool.rc = rc; pool.err = errno; }
+	}
+    }
+    for (ix = 0; ix < nworkers; ++ix) {
+	w = &pool.workers[ix];
+	while ((item = pw_take (&w->dq, 0))) { free (item); }
+	if (w->dq.items) { free (w->dq.items); }
+	if (w->buf) { free (w->buf); }
+	dr_free (&w->dr);
+	pthread_mutex_destroy (&w->dq.lock);
+    }
+    pthread_cond_destroy (&pool.cond);
+    pthread_mutex_destroy (&pool.lock);
+    free (pool.workers);
+    if (pool.rc) { errno = pool.err; }
+    return pool.rc;
+}
+
+#endif /*PWALK_C*/
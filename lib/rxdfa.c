@@ -0,0 +1,512 @@
+/* lib/rxdfa.c
+**
+** $Id$
+**
+** Author: Boris Jakubith
+** E-Mail: runkharr@googlemail.com
+** Copyright: (c) 2026, Boris Jakubith <runkharr@googlemail.com>
+** License: GNU General Public License, version 2
+**
+** Compile a list of (shell-like) glob patterns into one deterministic finite
+** automaton (DFA), which decides with exactly one table lookup per character
+** (and no backtracking) if a string completely matches any of the patterns.
+**
+** Pattern syntax: '*' matches any (possibly empty) sequence of characters,
+** '?' any single character (both including '/'), '[...]' any character of
+** the given set ('a-z' being a range; a leading '!' or '^' negates the set)
+** and '\c' the character 'c' itself; all other characters match themselves.
+** With the flag RXDFA_SUBTREE, each pattern additionally matches everything
+** which begins with a string matched by the pattern followed by a '/' (i.e.
+** all pathnames below a matching directory).
+**
+** The automaton is held in one contiguous (position independent) image - a
+** header, the table mapping the characters onto character classes, the state
+** flags and the transition table -, which can be written to a (cache) file
+** and later used directly from the mapped file (see 'lib/exclude.c').
+**
+** Synopsis:
+**    struct rxdfa dfa;
+**
+**    rc = rxdfa_compile (&dfa, npats, pats, flags);
+**    ... write dfa.image[0] .. dfa.image[dfa.size - 1] to a file ...
+**    rc = rxdfa_attach (&dfa, image, size);
+**
+**    st = rxdfa_run (&dfa, dfa.start, str, len);
+**    if (rxdfa_accepts (&dfa, st)) { ... }
+**    if (rxdfa_match (&dfa, str, len)) { ... }   ('lib/rxdfa_match.c')
+**
+**    rxdfa_free (&dfa);
+**
+** 'rxdfa_run()' feeds the 'len' characters of 'str' into the automaton
+** (beginning with the state 'st') and returns the resulting state, so the
+** common prefix of many strings can be processed only once.
+**
+** 'rxdfa_attach()' uses an image (e.g. a part of a mapped file, which must
+** be aligned to an 8 byte boundary) without copying it; 'rxdfa_free()' then
+** releases nothing but the automaton's own image (of a compiled automaton).
+**
+** Return values: 'rxdfa_compile()' and 'rxdfa_attach()' return 0 on success
+** and -1 (with 'errno' set) on failure. 'rxdfa_compile()' fails with E2BIG if
+** the automaton would become too large, and 'rxdfa_attach()' with ESTALE if
+** the image is invalid (or was written by an incompatible version).
+**
+*/
+#ifndef RXDFA_C
+#define RXDFA_C
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+
+#include "lib/mrmacs.c"
+
+#define RXDFA_SUBTREE 1
+
+/* The state flags: RXDFA_ACCEPT marks a state in which the characters read
+** so far are matched by a pattern, RXDFA_FINAL a state which can't be left
+** any more (so the result is known without reading the remaining input).
+*/
+#define RXDFA_ACCEPT 1
+#define RXDFA_FINAL 2
+
+#define RXDFA_MAGIC "RXDFA\n\032"
+#define RXDFA_VERSION 1
+#define RXDFA_ORDER 0x01020304
+#define RXDFA_MAXTRANS ((size_t) 1 << 26)
+
+struct rxdfa_hdr {
+    char magic[8];
+    uint32_t version, order;
+    uint32_t nstates, nclasses, start, flags;
+};
+
+struct rxdfa {
+    const unsigned char *cls;		/* [256] */
+    const unsigned char *sflags;	/* [nstates] */
+    const uint32_t *trans;		/* [nstates * nclasses] */
+    uint32_t nstates, nclasses, start;
+    char *image;			/* (of a compiled automaton) */
+    size_t size;
+};
+
+/* The layout of the image ... */
+#define RXDFA_CLS_OFS (sizeof(struct rxdfa_hdr))
+#define RXDFA_FLAGS_OFS (RXDFA_CLS_OFS + 256)
+#define RXDFA_TRANS_OFS(nstates) \
+    ((RXDFA_FLAGS_OFS + (size_t) (nstates) + 7) & ~(size_t) 7)
+#define RXDFA_SIZE(nstates, nclasses) \
+    (RXDFA_TRANS_OFS (nstates) \
+     + (size_t) (nstates) * (nclasses) * sizeof(uint32_t))
+
+static void rxdfa_setup (struct rxdfa *dfa, const char *image)
+{
+    const struct rxdfa_hdr *hdr = (const struct rxdfa_hdr *) image;
+    dfa->nstates = hdr->nstates; dfa->nclasses = hdr->nclasses;
+    dfa->start = hdr->start;
+    dfa->cls = (const unsigned char *) image + RXDFA_CLS_OFS;
+    dfa->sflags = (const unsigned char *) image + RXDFA_FLAGS_OFS;
+    dfa->trans = (const uint32_t *) (image + RXDFA_TRANS_OFS (hdr->nstates));
+}
+
+/* THE COMPILER. The patterns are first translated into a (non-deterministic)
+** automaton whose states are the positions in the patterns; each position
+** either matches one character of a set (RXP_SET) and then advances to the
+** next position, or any sequence of characters (RXP_STAR), or terminates a
+** pattern (RXP_END). The DFA is then built with the subset construction,
+** its states being the (sorted) sets of the positions reachable after the
+** characters read so far. The characters are partitioned into classes of
+** characters which are not distinguished by any of the patterns, so the
+** transition table has one column per class instead of one per character.
+** A '*' which terminates a pattern (e.g. the one behind the '/' appended
+** for the flag RXDFA_SUBTREE) accepts every continuation, so each set
+** containing such a position is replaced by one absorbing set; without this,
+** the sets would hold all combinations of the patterns completed so far
+** (which grows exponentially with the number of patterns).
+*/
+enum { RXP_SET, RXP_STAR, RXP_END };
+
+struct rxpos {
+    unsigned char kind, acc;
+    uint32_t set[8];
+};
+
+struct rxbuild {
+    struct rxpos *pos;
+    uint32_t npos, possz;
+    unsigned char cls[256], rep[256];	/* (class of a char, char of a class) */
+    uint32_t ncls, start, sink;		/* (sink: see 'rxb_collapse()') */
+    uint32_t *pool, *soff, *slen, *ht, *trans, *mark, *tmp, gen;
+    unsigned char *acc;
+    size_t poollen, poolsz, nstates, statesz, htsz;
+};
+
+#define rxp_has(p, c) (((p)->set[(c) >> 5] >> ((c) & 31)) & 1)
+#define rxp_set(p, c) ((p)->set[(c) >> 5] |= (uint32_t) 1 << ((c) & 31))
+
+static struct rxpos *rxb_addpos (struct rxbuild *b, int kind, int acc)
+{
+    struct rxpos *p;
+    if (b->npos >= b->possz) {
+	uint32_t nsz = (b->possz ? 2 * b->possz : 256);
+	ifnull (p = t_realloc (struct rxpos, b->pos, nsz)) { return NULL; }
+	b->pos = p; b->possz = nsz;
+    }
+    p = &b->pos[b->npos++];
+    memset (p, 0, sizeof(*p)); p->kind = kind; p->acc = acc;
+    return p;
+}
+
+/* Parse the character set beginning with the '[' at 'p' into 'rp' (returns
+** the position behind the closing ']' or NULL if there is none) ...
+*/
+static const char *rxb_class (const char *p, struct rxpos *rp)
+{
+    const unsigned char *q = (const unsigned char *) p + 1;
+    int neg = 0, first = 1, c, d, ix;
+    if (*q == '!' || *q == '^') { neg = 1; ++q; }
+    for (;;) {
+	if (! *q) { memset (rp->set, 0, sizeof(rp->set)); return NULL; }
+	if (*q == ']' && ! first) { break; }
+	c = *q++;
+	if (c == '\\' && *q) { c = *q++; }
+	d = c;
+	if (*q == '-' && q[1] && q[1] != ']') {
+	    ++q; d = *q++;
+	    if (d == '\\' && *q) { d = *q++; }
+	}
+	for (; c <= d; ++c) { rxp_set (rp, c); }
+	first = 0;
+    }
+    if (neg) {
+	for (ix = 0; ix < 8; ++ix) { rp->set[ix] = ~rp->set[ix]; }
+    }
+    return (const char *) q + 1;
+}
+
+static int rxb_pattern (struct rxbuild *b, const char *p, int flags)
+{
+    struct rxpos *rp;
+    const char *q;
+    while (*p) {
+	if (*p == '*') {
+	    while (*p == '*') { ++p; }
+	    ifnull (rxb_addpos (b, RXP_STAR, 0)) { return -1; }
+	    continue;
+	}
+	ifnull (rp = rxb_addpos (b, RXP_SET, 0)) { return -1; }
+	if (*p == '?') {
+	    memset (rp->set, 0xFF, sizeof(rp->set)); ++p;
+	} else if (*p == '[' && (q = rxb_class (p, rp))) {
+	    p = q;
+	} else {
+	    if (*p == '\\' && p[1]) { ++p; }
+	    rxp_set (rp, (unsigned char) *p); ++p;
+	}
+    }
+    if (flags & RXDFA_SUBTREE) {
+	ifnull (rp = rxb_addpos (b, RXP_SET, 1)) { return -1; }
+	rxp_set (rp, '/');
+	ifnull (rxb_addpos (b, RXP_STAR, 0)) { return -1; }
+    }
+    ifnull (rxb_addpos (b, RXP_END, 1)) { return -1; }
+    return 0;
+}
+
+/* Partition the characters into classes (refining the partition with each
+** character set of the patterns) ...
+*/
+static void rxb_classes (struct rxbuild *b)
+{
+    int16_t split[256][2];
+    uint32_t ix, ncls;
+    int c, in;
+    memset (b->cls, 0, sizeof(b->cls)); b->ncls = 1;
+    for (ix = 0; ix < b->npos; ++ix) {
+	const struct rxpos *rp = &b->pos[ix];
+	if (rp->kind != RXP_SET) { continue; }
+	memset (split, 0xFF, sizeof(split)); ncls = 0;
+	for (c = 0; c < 256; ++c) {
+	    in = rxp_has (rp, c);
+	    if (split[b->cls[c]][in] < 0) {
+		split[b->cls[c]][in] = (int16_t) ncls++;
+	    }
+	    b->cls[c] = (unsigned char) split[b->cls[c]][in];
+	}
+	b->ncls = ncls;
+    }
+    for (c = 255; c >= 0; --c) { b->rep[b->cls[c]] = (unsigned char) c; }
+}
+
+/* Add the position 'ix' (and all positions reachable from it without reading
+** a character) to the set being collected in 'b->tmp' ...
+*/
+static void rxb_close (struct rxbuild *b, uint32_t ix, uint32_t *_n)
+{
+    for (;;) {
+	if (b->mark[ix] == b->gen) { return; }
+	b->mark[ix] = b->gen; b->tmp[(*_n)++] = ix;
+	if (b->pos[ix].kind != RXP_STAR) { return; }
+	++ix;
+    }
+}
+
+/* Replace the set in 'b->tmp' by the absorbing set (the first terminating
+** '*' and the end position behind it) if it contains a terminating '*' ...
+*/
+static void rxb_collapse (struct rxbuild *b, uint32_t *_n)
+{
+    uint32_t ix, px;
+    if (b->sink == UINT32_MAX) { return; }
+    for (ix = 0; ix < *_n; ++ix) {
+	px = b->tmp[ix];
+	if (b->pos[px].kind == RXP_STAR && b->pos[px + 1].kind == RXP_END) {
+	    b->tmp[0] = b->sink; b->tmp[1] = b->sink + 1; *_n = 2;
+	    return;
+	}
+    }
+}
+
+static int rxb_cmp (const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *) a, y = *(const uint32_t *) b;
+    return (x > y) - (x < y);
+}
+
+static uint32_t rxb_hash (const uint32_t *set, uint32_t n)
+{
+    uint32_t h = 2166136261u ^ n;
+    while (n-- > 0) { h = (h ^ *set++) * 16777619u; }
+    return h;
+}
+
+static int rxb_rehash (struct rxbuild *b, size_t htsz)
+{
+    uint32_t *ht, h;
+    size_t ix;
+    ifnull (ht = t_allocv (uint32_t, htsz)) { return -1; }
+    memset (ht, 0, htsz * sizeof(uint32_t));
+    for (ix = 0; ix < b->nstates; ++ix) {
+	h = rxb_hash (b->pool + b->soff[ix], b->slen[ix]) & (htsz - 1);
+	while (ht[h]) { h = (h + 1) & (htsz - 1); }
+	ht[h] = (uint32_t) ix + 1;
+    }
+    cfree (b->ht); b->ht = ht; b->htsz = htsz;
+    return 0;
+}
+
+/* Return the state for the (sorted) set of positions 'set', adding a new
+** state if there is none (or -1 on failure) ...
+*/
+static int64_t rxb_state (struct rxbuild *b, const uint32_t *set, uint32_t n)
+{
+    uint32_t h, st, ix;
+    void *p;
+    if (2 * (b->nstates + 1) > b->htsz) {
+	if (rxb_rehash (b, (b->htsz ? 2 * b->htsz : 1024))) { return -1; }
+    }
+    h = rxb_hash (set, n) & (b->htsz - 1);
+    while ((st = b->ht[h])) {
+	--st;
+	if (b->slen[st] == n
+	&&  memcmp (b->pool + b->soff[st], set, n * sizeof(uint32_t)) == 0) {
+	    return st;
+	}
+	h = (h + 1) & (b->htsz - 1);
+    }
+    if ((b->nstates + 1) * b->ncls > RXDFA_MAXTRANS) {
+	errno = E2BIG; return -1;
+    }
+    if (b->nstates >= b->statesz) {
+	size_t nsz = (b->statesz ? 2 * b->statesz : 256);
+	ifnull (p = t_realloc (uint32_t, b->soff, nsz)) { return -1; }
+	b->soff = p;
+	ifnull (p = t_realloc (uint32_t, b->slen, nsz)) { return -1; }
+	b->slen = p;
+	ifnull (p = t_realloc (unsigned char, b->acc, nsz)) { return -1; }
+	b->acc = p;
+	ifnull (p = t_realloc (uint32_t, b->trans, nsz * b->ncls)) {
+	    return -1;
+	}
+	b->trans = p;
+	b->statesz = nsz;
+    }
+    if (b->poollen + n > b->poolsz) {
+	size_t nsz = (b->poolsz ? 2 * b->poolsz : 4096);
+	while (nsz < b->poollen + n) { nsz *= 2; }
+	ifnull (p = t_realloc (uint32_t, b->pool, nsz)) { return -1; }
+	b->pool = p; b->poolsz = nsz;
+    }
+    st = (uint32_t) b->nstates++;
+    if (n > 0) { memcpy (b->pool + b->poollen, set, n * sizeof(uint32_t)); }
+    b->soff[st] = (uint32_t) b->poollen; b->slen[st] = n;
+    b->poollen += n;
+    b->acc[st] = 0;
+    for (ix = 0; ix < n; ++ix) {
+	if (b->pos[set[ix]].acc) { b->acc[st] = RXDFA_ACCEPT; break; }
+    }
+    b->ht[h] = st + 1;
+    return st;
+}
+
+/* Build the DFA (the subset construction; the states are processed in the
+** order of their creation) ...
+*/
+static int rxb_dfa (struct rxbuild *b, uint32_t npats)
+{
+    uint32_t st, k, ix, n, px, c;
+    int64_t nst;
+    /* (State 0 is the "dead" state, the empty set of positions) */
+    if (rxb_state (b, NULL, 0) < 0) { return -1; }
+    b->sink = UINT32_MAX;
+    for (px = 0; px + 1 < b->npos; ++px) {
+	if (b->pos[px].kind == RXP_STAR && b->pos[px + 1].kind == RXP_END) {
+	    b->sink = px; break;
+	}
+    }
+    ++b->gen; n = 0;
+    for (ix = 0, px = 0; ix < npats; ++ix) {
+	rxb_close (b, px, &n);
+	while (b->pos[px].kind != RXP_END) { ++px; }
+	++px;
+    }
+    rxb_collapse (b, &n);
+    qsort (b->tmp, n, sizeof(uint32_t), rxb_cmp);
+    if ((nst = rxb_state (b, b->tmp, n)) < 0) { return -1; }
+    b->start = (uint32_t) nst;
+    for (st = 0; st < b->nstates; ++st) {
+	for (k = 0; k < b->ncls; ++k) {
+	    const uint32_t *set = b->pool + b->soff[st];
+	    c = b->rep[k]; ++b->gen; n = 0;
+	    for (ix = 0; ix < b->slen[st]; ++ix) {
+		px = set[ix];
+		if (b->pos[px].kind == RXP_STAR) {
+		    rxb_close (b, px, &n);
+		} else if (b->pos[px].kind == RXP_SET
+		       &&  rxp_has (&b->pos[px], c)) {
+		    rxb_close (b, px + 1, &n);
+		}
+	    }
+	    rxb_collapse (b, &n);
+	    qsort (b->tmp, n, sizeof(uint32_t), rxb_cmp);
+	    if ((nst = rxb_state (b, b->tmp, n)) < 0) { return -1; }
+	    b->trans[(size_t) st * b->ncls + k] = (uint32_t) nst;
+	}
+    }
+    return 0;
+}
+
+/* Assemble the image of the automaton ... */
+static int rxb_image (struct rxbuild *b, struct rxdfa *dfa)
+{
+    struct rxdfa_hdr *hdr;
+    unsigned char *sflags;
+    uint32_t st, k;
+    size_t size = RXDFA_SIZE (b->nstates, b->ncls);
+    char *image;
+    ifnull (image = t_allocv (char, size)) { return -1; }
+    memset (image, 0, RXDFA_TRANS_OFS (b->nstates));
+    hdr = (struct rxdfa_hdr *) image;
+    memcpy (hdr->magic, RXDFA_MAGIC, sizeof(hdr->magic));
+    hdr->version = RXDFA_VERSION; hdr->order = RXDFA_ORDER;
+    hdr->nstates = (uint32_t) b->nstates; hdr->nclasses = b->ncls;
+    hdr->start = b->start;
+    memcpy (image + RXDFA_CLS_OFS, b->cls, 256);
+    sflags = (unsigned char *) image + RXDFA_FLAGS_OFS;
+    for (st = 0; st < b->nstates; ++st) {
+	const uint32_t *row = b->trans + (size_t) st * b->ncls;
+	sflags[st] = b->acc[st] | RXDFA_FINAL;
+	for (k = 0; k < b->ncls; ++k) {
+	    if (row[k] != st) { sflags[st] &= ~RXDFA_FINAL; break; }
+	}
+    }
+    memcpy (image + RXDFA_TRANS_OFS (b->nstates), b->trans,
+	    b->nstates * b->ncls * sizeof(uint32_t));
+    dfa->image = image; dfa->size = size;
+    rxdfa_setup (dfa, image);
+    return 0;
+}
+
+static int rxdfa_compile (struct rxdfa *dfa, size_t npats,
+			  const char *const *pats, int flags)
+{
+    struct rxbuild b;
+    size_t ix;
+    int rc = -1, ec;
+    memset (dfa, 0, sizeof(*dfa));
+    memset (&b, 0, sizeof(b));
+    for (ix = 0; ix < npats; ++ix) {
+	if (rxb_pattern (&b, pats[ix], flags)) { goto CLEANUP; }
+    }
+    rxb_classes (&b);
+    ifnull (b.mark = t_allocv (uint32_t, b.npos + 1)) { goto CLEANUP; }
+    ifnull (b.tmp = t_allocv (uint32_t, b.npos + 1)) { goto CLEANUP; }
+    memset (b.mark, 0, (b.npos + 1) * sizeof(uint32_t));
+    if (rxb_dfa (&b, (uint32_t) npats) || rxb_image (&b, dfa)) {
+	goto CLEANUP;
+    }
+    rc = 0;
+CLEANUP:
+    ec = errno;
+    cfree (b.pos); cfree (b.pool); cfree (b.soff); cfree (b.slen);
+    cfree (b.ht); cfree (b.trans); cfree (b.mark); cfree (b.tmp);
+    cfree (b.acc);
+    errno = ec;
+    return rc;
+}
+
+static int rxdfa_attach (struct rxdfa *dfa, const char *image, size_t size)
+{
+    const struct rxdfa_hdr *hdr = (const struct rxdfa_hdr *) image;
+    size_t ix, ntrans;
+    memset (dfa, 0, sizeof(*dfa));
+    if (size < sizeof(*hdr)
+    ||  memcmp (hdr->magic, RXDFA_MAGIC, sizeof(hdr->magic)) != 0
+    ||  hdr->version != RXDFA_VERSION || hdr->order != RXDFA_ORDER
+    ||  hdr->nstates < 1 || hdr->nclasses < 1 || hdr->nclasses > 256
+    ||  hdr->start >= hdr->nstates
+    ||  size != RXDFA_SIZE (hdr->nstates, hdr->nclasses)) {
+	errno = ESTALE; return -1;
+    }
+    rxdfa_setup (dfa, image);
+    /* The tables are used as indices without further checks, so a corrupt
+    ** image (of the correct size) must be rejected here ...
+    */
+    for (ix = 0; ix < 256; ++ix) {
+	if (dfa->cls[ix] >= dfa->nclasses) { goto STALE; }
+    }
+    ntrans = (size_t) dfa->nstates * dfa->nclasses;
+    for (ix = 0; ix < ntrans; ++ix) {
+	if (dfa->trans[ix] >= dfa->nstates) { goto STALE; }
+    }
+    dfa->size = size;
+    return 0;
+STALE:
+    memset (dfa, 0, sizeof(*dfa));
+    errno = ESTALE; return -1;
+}
+
+static void rxdfa_free (struct rxdfa *dfa)
+{
+    cfree (dfa->image);
+    memset (dfa, 0, sizeof(*dfa));
+}
+
+/* MATCHING ... */
+static uint32_t rxdfa_run (const struct rxdfa *dfa, uint32_t st,
+			   const char *s, size_t len)
+{
+    const unsigned char *p = (const unsigned char *) s, *end = p + len;
+    const unsigned char *cls = dfa->cls, *sflags = dfa->sflags;
+    const uint32_t *trans = dfa->trans;
+    size_t ncls = dfa->nclasses;
+    for (; p < end; ++p) {
+	if (sflags[st] & RXDFA_FINAL) { break; }
+	st = trans[st * ncls + cls[*p]];
+    }
+    return st;
+}
+
+#define rxdfa_accepts(dfa, st) ((dfa)->sflags[(st)] & RXDFA_ACCEPT)
+
+#endif /*RXDFA_C*/
@@ -0,0 +1,28 @@
+/* lib/rxdfa_match.c
+**
+** $Id$
+**
+** Author: Boris Jakubith
+** E-Mail: runkharr@googlemail.com
+** Copyright: (c) 2026, Boris Jakubith <runkharr@googlemail.com>
+** License: GNU General Public License, version 2
+**
+** Synopsis:
+**    if (rxdfa_match (&dfa, str, len)) { ... }
+**
+** Returns 1 if the automaton 'dfa' ('lib/rxdfa.c') accepts the 'len'
+** characters of 'str' (i.e. if 'str' matches any of the patterns 'dfa' was
+** compiled from) and 0 otherwise.
+**
+*/
+#ifndef RXDFA_MATCH_C
+#define RXDFA_MATCH_C
+
+#include "lib/rxdfa.c"
+
+static int rxdfa_match (const struct rxdfa *dfa, const char *s, size_t len)
+{
+    return rxdfa_accepts (dfa, rxdfa_run (dfa, dfa->start, s, len)) != 0;
+}
+
+#endif /*RXDFA_MATCH_C*/
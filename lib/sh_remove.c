@@ -0,0 +1,40 @@
+/* lib/sh_remove.c
+**
+** $Id$
+**
+** Author: Boris Jakubith
+** E-Mail: runkharr@googlemail.com
+** Copyright: (c) 2026, Boris Jakubith <runkharr@googlemail.com>
+** License: GNU General Public License, version 2
+**
+** Synopsis:
+**    int rc = sh_remove (&h, key);
+**
+** Removes the entry of 'key' from the hash table 'h' ('lib/strhash.c').
+** Returns 0 if the entry was removed and -1 if it didn't exist.
+**
+*/
+#ifndef SH_REMOVE_C
+#define SH_REMOVE_C
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "lib/strhash.c"
+
+static int sh_remove (struct strhash *h, const char *key)
+{
+    size_t hv;
+    struct sh_entry *e, **pe;
+    if (h->nbuckets == 0) { return -1; }
+    hv = sh_hash (key);
+    for (pe = &h->buckets[hv & (h->nbuckets - 1)]; (e = *pe); pe = &e->next) {
+	if (e->hash == hv && ! strcmp (e->key, key)) {
+	    *pe = e->next; free (e); --h->count;
+	    return 0;
+	}
+    }
+    return -1;
+}
+
+#endif /*SH_REMOVE_C*/
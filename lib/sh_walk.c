@@ -0,0 +1,45 @@
+/* lib/sh_walk.c
+**
+** $Id$
+**
+** Author: Boris Jakubith
+** E-Mail: runkharr@googlemail.com
+** Copyright: (c) 2026, Boris Jakubith <runkharr@googlemail.com>
+** License: GNU General Public License, version 2
+**
+** Synopsis:
+**    int rc = sh_walk (&h, op, data);
+**
+** Calls
+**    rc = op (entry, data);
+** for each entry of the hash table 'h' ('lib/strhash.c'), in no particular
+** order; if 'rc' is positive, the entry is removed, if it is negative, the
+** walk terminates (returning 'rc'). Returns 0 otherwise.
+**
+*/
+#ifndef SH_WALK_C
+#define SH_WALK_C
+
+#include <stdlib.h>
+
+#include "lib/strhash.c"
+
+static int sh_walk (struct strhash *h, shwalkop_t op, void *data)
+{
+    size_t ix;
+    struct sh_entry *e, **pe;
+    int rc;
+    for (ix = 0; ix < h->nbuckets; ++ix) {
+	for (pe = &h->buckets[ix]; (e = *pe); ) {
+	    if ((rc = op (e, data)) < 0) { return rc; }
+	    if (rc > 0) {
+		*pe = e->next; free (e); --h->count;
+	    } else {
+		pe = &e->next;
+	    }
+	}
+    }
+    return 0;
+}
+
+#endif /*SH_WALK_C*/
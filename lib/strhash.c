@@ -0,0 +1,126 @@
+/* lib/strhash.c
+**
+** $Id$
+**
+** Author: Boris Jakubith
+** E-Mail: runkharr@googlemail.com
+** Copyright: (c) 2026, Boris Jakubith <runkharr@googlemail.com>
+** License: GNU General Public License, version 2
+**
+** A hash table of strings (each one with an associated integer value); it
+** can be used as a set of strings as well. The table grows as the number of
+** entries increases; each entry (including it's string) is allocated in one
+** piece.
+**
+** Synopsis:
+**    struct strhash h = STRHASH_INIT;
+**
+**    struct sh_entry *e = sh_lookup (&h, key);
+**    struct sh_entry *e = sh_insert (&h, key, value, &is_new);
+**    sh_free (&h);
+**
+** 'sh_lookup()' returns the entry of 'key' (or NULL). 'sh_insert()' returns
+** the (new or already existing) entry of 'key', setting '*is_new' (if
+** 'is_new' isn't NULL) to 1 if the entry was created (with the value
+** 'value'), and NULL (with 'errno' set) if the memory allocation failed.
+** Entries are removed with 'sh_remove()' ('lib/sh_remove.c'); all entries
+** are visited with 'sh_walk()' ('lib/sh_walk.c').
+**
+*/
+#ifndef STRHASH_C
+#define STRHASH_C
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "lib/mrmacs.c"
+
+struct sh_entry {
+    struct sh_entry *next;
+    size_t hash;
+    int value;
+    char key[1];
+};
+
+struct strhash {
+    struct sh_entry **buckets;
+    size_t nbuckets, count;
+};
+
+#define STRHASH_INIT { NULL, 0, 0 }
+
+typedef int (*shwalkop_t) (struct sh_entry *entry, void *data);
+
+static size_t sh_hash (const char *key)
+{
+    /* FNV-1a */
+    size_t h = (size_t) 2166136261ul;
+    const unsigned char *p = (const unsigned char *) key;
+    while (*p) { h = (h ^ *p++) * (size_t) 16777619ul; }
+    return h;
+}
+
+/* Double the number of buckets (allocating the initial buckets if there
+** are none) ...
+*/
+static int sh_grow (struct strhash *h)
+{
+    size_t ix, nb = (h->nbuckets > 0 ? 2 * h->nbuckets : 256);
+    struct sh_entry **b, *e, *next;
+    if (! (b = (struct sh_entry **) calloc (nb, sizeof(*b)))) { return -1; }
+    for (ix = 0; ix < h->nbuckets; ++ix) {
+	for (e = h->buckets[ix]; e; e = next) {
+	    next = e->next;
+	    e->next = b[e->hash & (nb - 1)]; b[e->hash & (nb - 1)] = e;
+	}
+    }
+    if (h->buckets) { free (h->buckets); }
+    h->buckets = b; h->nbuckets = nb;
+    return 0;
+}
+
+static struct sh_entry *sh_lookup (struct strhash *h, const char *key)
+{
+    size_t hv;
+    struct sh_entry *e;
+    if (h->nbuckets == 0) { return NULL; }
+    hv = sh_hash (key);
+    for (e = h->buckets[hv & (h->nbuckets - 1)]; e; e = e->next) {
+	if (e->hash == hv && ! strcmp (e->key, key)) { break; }
+    }
+    return e;
+}
+
+static struct sh_entry *sh_insert (struct strhash *h, const char *key,
+				   int value, int *is_new)
+{
+    size_t hv, len;
+    struct sh_entry *e;
+    if (is_new) { *is_new = 0; }
+    if ((e = sh_lookup (h, key))) { return e; }
+    if (h->count >= h->nbuckets && sh_grow (h)) { return NULL; }
+    len = strlen (key);
+    ifnull (e = t_allocp (struct sh_entry, len)) { return NULL; }
+    hv = sh_hash (key);
+    e->hash = hv; e->value = value;
+    memcpy (e->key, key, len + 1);
+    e->next = h->buckets[hv & (h->nbuckets - 1)];
+    h->buckets[hv & (h->nbuckets - 1)] = e;
+    ++h->count;
+    if (is_new) { *is_new = 1; }
+    return e;
+}
+
+static void sh_free (struct strhash *h)
+{
+    size_t ix;
+    struct sh_entry *e, *next;
+    for (ix = 0; ix < h->nbuckets; ++ix) {
+	for (e = h->buckets[ix]; e; e = next) { next = e->next; free (e); }
+    }
+    if (h->buckets) { free (h->buckets); }
+    h->buckets = NULL; h->nbuckets = h->count = 0;
+}
+
+#endif /*STRHASH_C*/
@@ -0,0 +1,79 @@
+/* lib/strlist.c
+**
+** $Id$
+**
+** Author: Boris Jakubith
+** E-Mail: runkharr@googlemail.com
+** Copyright: (c) 2026, Boris Jakubith <runkharr@googlemail.com>
+** License: GNU General Public License, version 2
+**
+** A list of strings whose elements (each one together with it's string) are
+** allocated contiguously from an arena ('lib/arena.c'), instead of with one
+** 'malloc()' per element. The complete list is released with one call.
+**
+** Synopsis:
+**    struct strlist l = STRLIST_INIT;
+**
+**    struct sl_item *it = sl_append (&l, str);
+**    for (it = l.first; it; it = it->next) { ... it->str ... }
+**    sl_free (&l);
+**
+** Each element has (besides it's string) an integer 'flags' member (which is
+** initialized with 0) for the use of the caller. 'l.count' is the number of
+** elements.
+**
+** Return values: 'sl_append()' returns the new element, or NULL (with
+** 'errno' set) if no memory could be allocated.
+**
+*/
+#ifndef STRLIST_C
+#define STRLIST_C
+
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <errno.h>
+
+#include "lib/mrmacs.c"
+#include "lib/arena.c"
+
+struct sl_item {
+    struct sl_item *next;
+    int flags;
+    char str[1];
+};
+
+struct strlist {
+    struct arena pool;
+    struct sl_item *first, *last;
+    size_t count;
+};
+
+#define STRLIST_INIT { ARENA_INIT, NULL, NULL, 0 }
+
+/* Append the first 'len' characters of 's' (which contain no NUL) ... */
+static struct sl_item *sl_add (struct strlist *l, const char *s, size_t len)
+{
+    struct sl_item *it;
+    it = (struct sl_item *) arena_alloc (&l->pool,
+					 offsetof(struct sl_item, str) + len + 1);
+    ifnull (it) { return NULL; }
+    it->next = NULL; it->flags = 0;
+    memcpy (it->str, s, len); it->str[len] = '\0';
+    if (l->last) { l->last->next = it; } else { l->first = it; }
+    l->last = it; ++l->count;
+    return it;
+}
+
+static struct sl_item *sl_append (struct strlist *l, const char *s)
+{
+    return sl_add (l, s, strlen (s));
+}
+
+static void sl_free (struct strlist *l)
+{
+    arena_free (&l->pool);
+    l->first = l->last = NULL; l->count = 0;
+}
+
+#endif /*STRLIST_C*/
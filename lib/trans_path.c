@@ -10,11 +10,43 @@
 ** Normalize an absolute pathname (remove './' occurrences, resolve '../' and
 ** translate multiple consecutive occurrences of '/' into a single '/') ...
 **
+** Most pathnames are already normalized, so the pathname is first scanned
+** (with SSE2 - 16 characters at once - where available) for the first '/'
+** which is followed by another '/' or a '.'. Only the remainder of the
+** pathname (beginning with this '/') is processed by the state machine; a
+** pathname without such a '/' is merely copied (without a trailing '/').
+**
+** Synopsis:
+**    int rc = trans_path (outpath, inpath);
+**
+** 'trans_path()' writes the normalized 'inpath' into 'outpath' (which may
+** be the same as 'inpath', as the result is never longer than 'inpath').
+** It returns 0 on success and -1 if 'inpath' isn't an absolute pathname.
+**
+** Many pathnames are normalized at once (into one buffer) with
+** 'trans_paths()' ('lib/trans_paths.c').
+**
 */
 #ifndef TRANS_PATH_C
 #define TRANS_PATH_C
 
-static int trans_path (char *p, const char *q)
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#if defined(__SSE2__)
+# include <emmintrin.h>
+# define TP_SSE2 1
+#endif
+
+#define TP_INVALID ((size_t) -1)
+
+/* The state machine (for the part of the pathname beginning at 'q', which
+** is written to 'p'; 'sp' is the beginning of the output pathname). The
+** part begins with a '/' which follows a name (or is the first character
+** of the pathname) ...
+*/
+static int trans_path_fsm (char *sp, char *p, const char *q)
 {
     enum cclass { CCEOS = 0, CCSLASH, CCDOT, CCOTHER } cclass;
     enum state { S0 = 0, S1, S2, S3, END }
@@ -22,7 +54,7 @@ static int trans_path (char *p, const char *q)
     enum action { NOOP = 0, STORE, BACK1, BACK, STOP } action;
     static const enum state strans[5][4] = {
 	       /* CCEOS    CCSLASH  CCDOT    CCOTHER*/
-	/*S0*/  { END,     S1,      S2,      S0 },
+	/*S0*/  { END,     S1,      S0,      S0 },
 	/*S1*/  { END,     S1,      S2,      S0 },
 	/*S2*/  { END,     S1,      S3,      S0 },
 	/*S3*/  { END,     S1,      S0,      S0 },
@@ -36,8 +68,6 @@ static int trans_path (char *p, const char *q)
 	/*S3*/  { BACK,      BACK,    STORE,       STORE },
 	/*END*/ { STOP,      STOP,    STOP,        STOP },
     };
-    char *sp = p;
-    if (*q != '/') { return -1; }
     for (;;) {
 	int ch = *q;
 	if (ch) { ++q; }
@@ -70,4 +100,64 @@ static int trans_path (char *p, const char *q)
     }
 }
 
+/* Return the position of the first '/' in 'q' which is followed by another
+** '/' or a '.' - or TP_INVALID if there is none (storing the length of 'q'
+** in '*_len' then) ...
+*/
+static size_t trans_path_scan (const char *q, size_t *_len)
+{
+    const char *s = q;
+#ifdef TP_SSE2
+    const __m128i slash = _mm_set1_epi8 ('/'), dot = _mm_set1_epi8 ('.');
+    const __m128i zero = _mm_setzero_si128 ();
+    __m128i c0, c1;
+    unsigned int hit, eos;
+    for (;;) {
+	if (((uintptr_t) s & 4095) > 4096 - 17) {
+	    /* (The 17 characters loaded below would cross a page boundary,
+	    ** and the page behind the pathname may not be mapped) */
+	    if (! *s) { break; }
+	    if (*s == '/' && (s[1] == '/' || s[1] == '.')) {
+		return (size_t) (s - q);
+	    }
+	    ++s; continue;
+	}
+	c0 = _mm_loadu_si128 ((const __m128i *) s);
+	c1 = _mm_loadu_si128 ((const __m128i *) (s + 1));
+	eos = (unsigned int) _mm_movemask_epi8 (_mm_cmpeq_epi8 (c0, zero));
+	hit = (unsigned int) _mm_movemask_epi8 (
+		_mm_and_si128 (_mm_cmpeq_epi8 (c0, slash),
+			       _mm_or_si128 (_mm_cmpeq_epi8 (c1, slash),
+					     _mm_cmpeq_epi8 (c1, dot))));
+	/* (Only the hits before the end of the pathname count) */
+	if (eos) { hit &= (eos & -eos) - 1; }
+	if (hit) { return (size_t) (s - q) + __builtin_ctz (hit); }
+	if (eos) { s += __builtin_ctz (eos); break; }
+	s += 16;
+    }
+#else
+    for (; *s; ++s) {
+	if (*s == '/' && (s[1] == '/' || s[1] == '.')) {
+	    return (size_t) (s - q);
+	}
+    }
+#endif
+    *_len = (size_t) (s - q);
+    return TP_INVALID;
+}
+
+static int trans_path (char *p, const char *q)
+{
+    size_t len = 0, pos;
+    if (*q != '/') { return -1; }
+    if ((pos = trans_path_scan (q, &len)) != TP_INVALID) {
+	/* (A '/' followed by '/' or '.' was found at 'pos') */
+	if (p != q) { memmove (p, q, pos); }
+	return trans_path_fsm (p, p + pos, q + pos);
+    }
+    if (p != q) { memmove (p, q, len + 1); }
+    if (len > 1 && p[len - 1] == '/') { p[len - 1] = '\0'; }
+    return 0;
+}
+
 #endif /*TRANS_PATH_C*/
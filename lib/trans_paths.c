@@ -0,0 +1,65 @@
+/* lib/trans_paths.c
+**
+** $Id$
+**
+** Author: Boris Jakubith
+** E-Mail: runkharr@googlemail.com
+** Copyright: (c) 2026, Boris Jakubith <runkharr@googlemail.com>
+** License: GNU General Public License, version 2
+**
+** Synopsis:
+**    int rc = trans_paths (base, n, paths, &buf, &bufsz, offsets);
+**
+** Normalizes (see 'lib/trans_path.c') the 'n' pathnames 'paths[0] ..
+** paths[n-1]' into the buffer '*_buf' (which is (re-)allocated as needed),
+** one after another, each one terminated by a NUL character; 'offsets[ix]'
+** is set to the position of the result for 'paths[ix]' in the buffer. A
+** relative pathname is taken relative to the (absolute) directory 'base'; if
+** 'base' is NULL, 'offsets[ix]' is set to TP_INVALID for a relative pathname
+** (as well as for a pathname which can't be normalized). The function
+** returns 0 on success and -1 (with 'errno' set) if no memory could be
+** allocated.
+**
+*/
+#ifndef TRANS_PATHS_C
+#define TRANS_PATHS_C
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "lib/trans_path.c"
+
+static int trans_paths (const char *base, size_t n, const char *const *paths,
+			char **_buf, size_t *_bufsz, size_t *offsets)
+{
+    size_t ix, sz = 0, pos = 0, blen = (base ? strlen (base) : 0), len;
+    const char *path;
+    char *p;
+    /* (The results are never longer than their (absolute) pathnames) */
+    for (ix = 0; ix < n; ++ix) {
+	sz += strlen (paths[ix]) + 1;
+	if (*paths[ix] != '/') { sz += blen + 1; }
+    }
+    if (sz > *_bufsz || ! *_buf) {
+	sz += 1023; sz -= sz % 1024;
+	if (! (p = (char *) realloc (*_buf, sz))) { return -1; }
+	*_buf = p; *_bufsz = sz;
+    }
+    for (ix = 0; ix < n; ++ix) {
+	path = paths[ix]; p = *_buf + pos;
+	if (*path != '/') {
+	    if (! base) { offsets[ix] = TP_INVALID; continue; }
+	    /* (The relative pathname is appended to 'base' and the result
+	    ** normalized in place) */
+	    memcpy (p, base, blen); p[blen] = '/';
+	    strcpy (p + blen + 1, path);
+	    path = p;
+	}
+	if (trans_path (p, path)) { offsets[ix] = TP_INVALID; continue; }
+	offsets[ix] = pos;
+	len = strlen (p); pos += len + 1;
+    }
+    return 0;
+}
+
+#endif /*TRANS_PATHS_C*/
@@ -0,0 +1,206 @@
+/* lib/travdir-core.c
+**
+** $Id$
+**
+** Author: Boris Jakubith
+** E-Mail: runkharr@googlemail.com
+** Copyright: (c) 2026, Boris Jakubith <runkharr@googlemail.com>
+** License: GNU General Public License, version 2
+**
+** The traversal engine behind 'travdir()', 'travdirnd()' and 'travdirne()'.
+** The directories are opened relative to their parent directories
+** ('openat()') and read in bulk with one (reusable) 'lib/dirread.c' reader,
+** the type of an entry is taken from it's directory entry and
+** 'get_filetype()' is called only if the file system doesn't supply it
+** ('DT_UNKNOWN'). The pathnames are built in
+** one (reusable) buffer by appending/removing the names of the entries, and
+** the names of the sub-directories of a directory are collected in one
+** buffer per directory level.
+**
+** Synopsis:
+**    int rc = travdir_core (&buf, &bufsz, dirname, flags,
+**                           get_filetype, travop, travdata);
+**
+** 'flags' is a combination of
+**    TRAV_NODIRS   don't process the directories (only the other entries),
+**    TRAV_NOEMPTY  don't process empty directories.
+**
+** Each directory is processed before it's entries; the entries which are no
+** directories are processed in the order they are read, followed by the
+** sub-directories (recursively).
+**
+** Return values:
+**    0  success,
+**   -2  a directory couldn't be opened,
+**   -3  memory allocation failed,
+** or the (non-zero) value returned by 'get_filetype()' or 'travop()'.
+**
+*/
+#ifndef TRAVDIR_CORE_C
+#define TRAVDIR_CORE_C
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+
+#include <sys/types.h>
+
+#include "lib/mrmacs.c"
+#include "lib/dirread.c"
+
+#include "lib/travdir-types.c"
+
+#define TRAV_NODIRS 1
+#define TRAV_NOEMPTY 2
+
+struct trav_state {
+    char **_buf;
+    size_t *_bufsz;
+    int flags;
+    getfiletype_t get_filetype;
+    travop_t travop;
+    void *travdata;
+    struct dirread dr;		/* (A directory is read completely before
+				** it's sub-directories are processed) */
+};
+
+/* Append '/name' to the pathname (of length 'len') in the buffer. Returns
+** the new length of the pathname or 0 if the buffer couldn't be expanded ...
+*/
+static size_t trav_push (struct trav_state *ts, size_t len, const char *name)
+{
+    size_t nlen = strlen (name), sz = len + nlen + 2;
+    char *p;
+    if (sz > *ts->_bufsz) {
+	sz += 127; sz -= sz % 128;
+	ifnull (p = (char *) realloc (*ts->_buf, sz)) { return 0; }
+	*ts->_buf = p; *ts->_bufsz = sz;
+    }
+    p = *ts->_buf + len;
+    *p++ = '/'; memcpy (p, name, nlen + 1);
+    return len + nlen + 1;
+}
+
+static int trav_filetype (unsigned char d_type)
+{
+    switch (d_type) {
+	case DT_REG: return FT_FILE;
+	case DT_DIR: return FT_DIRECTORY;
+	case DT_LNK: return FT_SYMLINK;
+	case DT_FIFO: return FT_PIPE;
+	case DT_SOCK: return FT_SOCKET;
+	case DT_CHR: return FT_CHARDEV;
+	case DT_BLK: return FT_BLOCKDEV;
+	default: return -1;
+    }
+}
+
+/* Process the directory (opened as 'dfd') whose pathname (of length 'len')
+** is in the buffer. 'dfd' is closed in any case ...
+*/
+static int trav_level (struct trav_state *ts, int dfd, size_t len)
+{
+    int errnosave, rc = 0, filetype, fd = -1;
+    int dirnotdone = (ts->flags & (TRAV_NODIRS|TRAV_NOEMPTY)) != 0;
+    char *names = NULL, *np;
+    size_t namesz = 0, nameslen = 0, nlen, elen;
+    struct dr_entry de;
+
+    if (! dirnotdone) {
+	if ((rc = ts->travop (*ts->_buf, FT_DIRECTORY, ts->travdata))) {
+	    close (dfd); return rc;
+	}
+    }
+    /* 'fd' is kept open for opening the sub-directories ... */
+    if ((fd = dup (dfd)) < 0) { close (dfd); return -2; }
+    if (dr_fdopen (&ts->dr, dfd)) {
+	errnosave = errno; close (fd); errno = errnosave;
+	return -2;
+    }
+    while ((rc = dr_next (&ts->dr, &de)) > 0) {
+	if (dirnotdone && (ts->flags & TRAV_NODIRS) == 0) {
+	    (*ts->_buf)[len] = '\0';
+	    rc = ts->travop (*ts->_buf, FT_DIRECTORY, ts->travdata);
+	    if (rc) { goto ERROUT; }
+	}
+	dirnotdone = 0;
+	if ((filetype = trav_filetype (de.type)) < 0) {
+	    /* No (usable) type in the directory entry ... */
+	    if (! trav_push (ts, len, de.name)) { goto FATAL; }
+	    if ((rc = ts->get_filetype (*ts->_buf, &filetype))) {
+		goto ERROUT;
+	    }
+	}
+	if (filetype == FT_DIRECTORY) {
+	    nlen = strlen (de.name) + 1;
+	    if (nameslen + nlen > namesz) {
+		size_t sz = (namesz > 0 ? 2 * namesz : 1024);
+		while (sz < nameslen + nlen) { sz *= 2; }
+		ifnull (np = (char *) realloc (names, sz)) { goto FATAL; }
+		names = np; namesz = sz;
+	    }
+	    memcpy (names + nameslen, de.name, nlen);
+	    nameslen += nlen;
+	    continue;
+	}
+	if (! trav_push (ts, len, de.name)) { goto FATAL; }
+	if ((rc = ts->travop (*ts->_buf, filetype, ts->travdata))) {
+	    goto ERROUT;
+	}
+    }
+    if (rc < 0) { rc = -2; goto ERROUT; }
+    dr_close (&ts->dr);
+    /* Now process the sub-directories ... */
+    for (np = names; np < names + nameslen; np += strlen (np) + 1) {
+	int sdfd;
+	if (! (elen = trav_push (ts, len, np))) { goto FATAL; }
+	if ((sdfd = openat (fd, np, O_RDONLY|O_DIRECTORY|O_NOFOLLOW)) < 0) {
+	    rc = -2; goto ERROUT;
+	}
+	if ((rc = trav_level (ts, sdfd, elen))) { goto ERROUT; }
+    }
+    close (fd);
+    if (names) { free (names); }
+    return 0;
+FATAL:
+    rc = -3;
+ERROUT:
+    errnosave = errno;
+    dr_close (&ts->dr);
+    close (fd);
+    if (names) { free (names); }
+    errno = errnosave;
+    return rc;
+}
+
+static int
+travdir_core (char **_buf, size_t *_bufsz, const char *dirname, int flags,
+	      getfiletype_t get_filetype, travop_t travop, void *travdata)
+{
+    struct trav_state ts;
+    size_t len, sz;
+    int dfd, rc;
+    char *p;
+
+    if (isNULL(_buf) || isNULL(_bufsz)) { errno = EINVAL; return -1; }
+    len = strlen (dirname);
+    if (len + 1 > *_bufsz) {
+	sz = len + 128; sz -= sz % 128;
+	ifnull (p = (char *) realloc (*_buf, sz)) { return -3; }
+	*_buf = p; *_bufsz = sz;
+    }
+    memmove (*_buf, dirname, len + 1);
+    ts._buf = _buf; ts._bufsz = _bufsz; ts.flags = flags;
+    ts.get_filetype = get_filetype; ts.travop = travop;
+    ts.travdata = travdata;
+    if ((dfd = open (*_buf, O_RDONLY|O_DIRECTORY)) < 0) { return -2; }
+    dr_init (&ts.dr, 0);
+    rc = trav_level (&ts, dfd, len);
+    dr_free (&ts.dr);
+    return rc;
+}
+
+#endif /*TRAVDIR_CORE_C*/
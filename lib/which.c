@@ -27,6 +27,8 @@
 #include "empty.c"
 #include "sfmt.c"
 #include "separators.c"
+#include "idcache.c"
+#include "idc_user_home.c"
 
 #define ROOT_PATH_TMPL  "$1/bin:/bin:/sbin:/usr/bin:/usr/sbin:" \
 			"/usr/local/bin:/usr/local/sbin"
@@ -44,8 +46,8 @@ const char *which_getpath (void)
 	    which_path = path;
 	} else {
 	    uid_t uid = geteuid();
-	    struct passwd *pw = getpwuid (uid);
-	    if (! pw) {
+	    const char *home = idc_user_home (uid);
+	    if (! home) {
 		errno = EINVAL;
 	    } else {
 		char *p;
@@ -63,10 +65,10 @@ const char *which_getpath (void)
 			*p = PATHSEP;
 		    }
 		}
-		which_path_len = strlen (pw->pw_dir) + strlen (which_pthtpl);
+		which_path_len = strlen (home) + strlen (which_pthtpl);
 		if ((p = (char *) malloc (which_path_len + 1))) {
 		    sfmt_print (p, which_path_len + 1,
-				which_pthtpl, pw->pw_dir);
+				which_pthtpl, home);
 		    which_path = p;
 		}
 	    }
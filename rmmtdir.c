@@ -24,6 +24,9 @@
 #include <sys/types.h>
 #include <dirent.h>
 
+#include "lib/dirread.c"
+#include "lib/dr_open.c"
+
 /** Displaying either the _usage_ message (on `stdout`), terminating the
 **  program with the exit code 0, or a given usage message (`printf`-style),
 **  terminating the program with `EX_USAGE` in this case.
@@ -60,30 +63,18 @@ static void usage (const char *prog, const char *fmt, ...)
     exit (0);
 }
 
-/** Check if a string consists entirely of `.` or `..` ... */
-static __inline__ bool dotordotdot (const char *s)
-{
-    if (*s != '.') { return false; }
-    if (s[1] == '\0') { return true; }
-    if (s[1] != '.') { return false; }
-    return s[2] == '\0';
-}
-
 /** Check if a directory is empty (save from `.` and `..`) */
 static int check_if_empty (const char *path)
 {
-    bool is_empty = true;
-    struct dirent *de = NULL;
-    DIR *dh = opendir (path);
-    if (! dh) { return -1; }
-
-    while ((de = readdir (dh))) {
-	if (dotordotdot (de->d_name)) { continue; }
-	is_empty = false;
-	break;
-    }
-    closedir (dh);
-    return (is_empty ? 0 : 1);
+    int rc;
+    struct dirread dr;
+    struct dr_entry de;
+    /* (Only the first entry is of interest, so a small buffer suffices) */
+    dr_init (&dr, 1024);
+    if (dr_open (&dr, path)) { dr_free (&dr); return -1; }
+    rc = dr_next (&dr, &de);
+    dr_free (&dr);
+    return rc;
 }
 
 /** Testing if a string `probe` (with a given length `plen`) exactly matches
@@ -17,6 +17,15 @@
 **
 **    admin/svnignore [-r svnignore-file] file/pattern...
 **
+**    admin/svnignore -R [-n] [-r svnignore-file] dir [file/pattern...]
+**
+** The recursive mode ('-R') computes the ignore set of each directory of the
+** tree below 'dir' (from the 'svnignore-file' in this directory and the
+** given file/patterns), skipping the directories ignored by their parent.
+** The current properties are fetched with one 'svn propget -R --xml', and
+** the directories whose property differs are then updated with one
+** 'svn propset --targets' for each distinct ignore set.
+**
 */
 
 #include <stdbool.h>
@@ -28,22 +37,38 @@
 #include <stdarg.h>
 #include <signal.h>
 #include <sysexits.h>
+#include <fnmatch.h>
 
 #include <sys/stat.h>
 #include <sys/wait.h>
 
+#include "lib/prog.c"
+#include "lib/arena.c"
+#include "lib/strhash.c"
+#include "lib/strlist.c"
+#include "lib/dirread.c"
+#include "lib/dr_open.c"
+#include "lib/cwd.c"
+#include "lib/trans_path.c"
+#include "lib/trans_paths.c"
+
 typedef struct list list_t;
 struct list {
     list_t *next;
     char *s;
 };
 
+/* All list elements (and the copies of their strings) are allocated from
+** this arena, so the list is released with one 'arena_free()' ...
+*/
+static struct arena list_pool = ARENA_INIT;
+
 list_t *list_push (list_t *old, char *s, bool duplicate)
 {
     list_t *new;
     size_t ssz = (duplicate ? strlen (s) + 1 : 0);
     size_t elsz = sizeof(list_t);
-    if ((new = (list_t *) malloc (elsz + ssz))) {
+    if ((new = (list_t *) arena_alloc (&list_pool, elsz + ssz))) {
 	new->next = old;
 	if (duplicate) {
 	    char *p = (char *) new + elsz;
@@ -55,35 +80,58 @@ list_t *list_push (list_t *old, char *s, bool duplicate)
     return new;
 }
 
+/* (Releases all lists, as their elements share 'list_pool') */
 void list_free (list_t *list)
 {
-    list_t *tail;
-    int ec = errno;
-    while (list) {
-	tail = list->next; list->next = NULL;
-	free (list); list = tail;
+    (void) list;
+    arena_free (&list_pool);
+}
+
+/* Push 's' onto '*_list' unless it is already an element of the set 'seen'
+** (a hash table, instead of a linear search through the list) ...
+*/
+static int list_add (list_t **_list, struct strhash *seen, char *s,
+		     bool duplicate)
+{
+    list_t *new;
+    int is_new;
+    if (! sh_insert (seen, s, 0, &is_new)) { return -1; }
+    if (is_new) {
+	if (!(new = list_push (*_list, s, duplicate))) { return -1; }
+	*_list = new;
     }
-    errno = ec;
+    return 0;
 }
 
-const list_t *list_find (const char *s, list_t **_list)
+static int cmpstr (const void *a, const void *b)
 {
-//    bool found = false;
-    list_t *list = *_list, *curr, *prev;
-    if (! list) { return NULL; }
-    if (strcmp (list->s, s) == 0) { return list; }
-    prev = list;
-    while ((curr = prev->next)) {
-	if (strcmp (curr->s, s) == 0) {
-	    prev->next = curr->next;
-	    curr->next = list; list = curr;
-//	    found = true;
-	    break;
+    return strcmp (*(const char *const *) a, *(const char *const *) b);
+}
+
+/* The elements of 'list' (sorted if 'sorted' is set), each one terminated
+** with a '\n', as one (allocated) string ...
+*/
+static char *list_join (list_t *list, bool sorted)
+{
+    list_t *el;
+    size_t len = 0, count = 0, ix;
+    char *res, *p, **sv;
+    for (el = list; el; el = el->next) { ++count; }
+    if (!(sv = (char **) malloc ((count ? count : 1) * sizeof(char *)))) {
+	return NULL;
+    }
+    for (ix = 0, el = list; el; el = el->next, ++ix) {
+	sv[ix] = el->s; len += strlen (el->s) + 1;
+    }
+    if (sorted) { qsort (sv, count, sizeof(char *), cmpstr); }
+    if ((res = (char *) malloc (len + 1))) {
+	for (p = res, ix = 0; ix < count; ++ix) {
+	    p = stpcpy (p, sv[ix]); *p++ = '\n';
 	}
-	prev = curr;
+	*p = '\0';
     }
-    *_list = list;
-    return curr;
+    free (sv);
+    return res;
 }
 
 #define errguard(stmts) do { int ec = errno; stmts; errno = ec; } while (0)
@@ -122,10 +170,11 @@ static int cuteol (char *s)
     return 0;
 }
 
-static int read_ignore_file (const char *ignore_file, list_t **_list)
+static int read_ignore_file (const char *ignore_file, list_t **_list,
+			     struct strhash *seen)
 {
     FILE *ifp = NULL;
-    list_t *list = *_list, *newel;
+    list_t *list = *_list;
     char buf[4096], rest[4096];
     int rc = -1;
     bool had_overflows = false;
@@ -139,11 +188,10 @@ static int read_ignore_file (const char *ignore_file, list_t **_list)
 		}
 		had_overflows = true;
 	    }
-	    if (! list_find (buf, &list)) {
-		if (!(newel = list_push (list, buf, true))) {
-		    rc = -1; goto EXIT_POINT;
-		}
-		list = newel;
+	    /* (Empty lines are meaningless in an 'svn:ignore' property) */
+	    if (! *buf) { continue; }
+	    if (list_add (&list, seen, buf, true)) {
+		rc = -1; goto EXIT_POINT;
 	    }
 	}
 	if (ferror (ifp)) { rc = -1; }
@@ -157,7 +205,11 @@ EXIT_POINT:
     return rc;
 }
 
-static int svn_propset (const char *prop, const char *dir, list_t *list)
+/* Set the property 'prop' of 'dir' (or of the directories listed in the file
+** 'targets') to 'value' ...
+*/
+static int svn_propset (const char *prop, const char *dir,
+			const char *targets, const char *value)
 {
     int pfd[2];
     pid_t pid;
@@ -169,8 +221,10 @@ static int svn_propset (const char *prop, const char *dir, list_t *list)
 	case 0:
 	    /*CHILD*/ {
 	    const char *cmd[] = {
-		"svn", "propset", prop, "-F", "-", dir, NULL
+		"svn", "propset", prop, "-F", "-", NULL, NULL, NULL
 	    };
+	    cmd[5] = dir;
+	    if (targets) { cmd[5] = "--targets"; cmd[6] = targets; }
 	    dup2 (pfd[0], 0); close (pfd[1]);
 	    execvp (*cmd, (char *const *) cmd);
 	    fprintf (stderr, "svn propset - %s\n", strerror (errno));
@@ -183,15 +237,12 @@ static int svn_propset (const char *prop, const char *dir, list_t *list)
 		ec = errno;
 		kill (pid, SIGPIPE);
 	    } else {
-		list_t *el;
-		for (el = list; el; el = el->next) {
-		    fprintf (fp, "%s\n", el->s);
-		}
+		fputs (value, fp);
 		fclose (fp);
 	    }
 	    waitpid (pid, &wstat, 0);
 	    if (WIFEXITED(wstat)) {
-		int xc = WTERMSIG(wstat);
+		int xc = WEXITSTATUS(wstat);
 		switch (xc) {
 		    case 0:  return 0;
 		    case 99: errno = ENOENT; return -1;
@@ -213,27 +264,16 @@ static int svn_propset (const char *prop, const char *dir, list_t *list)
     }
 }
 
-int add_ignores (int argc, char *argv[], list_t **_list)
+int add_ignores (int argc, char *argv[], list_t **_list, struct strhash *seen)
 {
-    list_t *list = *_list, *new;
-    int ix, rc = 0;
+    int ix;
 
     for (ix = 0; ix < argc; ++ix) {
-	char *arg = argv[ix];
-	if (! list_find (arg, &list)) {
-	    if (!(new = list_push (list, arg, false))) {
-		rc = -1; goto EXIT_POINT;
-	    }
-	    list = new;
-	}
+	if (list_add (_list, seen, argv[ix], false)) { return -1; }
     }
-EXIT_POINT:
-    *_list = list;
-    return rc;
+    return 0;
 }
 
-const char *prog;
-
 const char *bn (const char *path)
 {
     const char *res = strrchr (path, '/');
@@ -252,6 +292,7 @@ static void usage (const char *format, ...)
 	exit (EX_USAGE);
     }
     printf ("Usage: %s [-r file] dir file/pattern...\n"
+	    "       %s -R [-n] [-r file] dir [file/pattern...]\n"
 	    "       %s -w file file/pattern...\n"
 	    "       %s [-h]\n"
 	    "\nOptions/Arguments:"
@@ -262,13 +303,27 @@ static void usage (const char *format, ...)
 	    "\n     Read entries from an 'file', append each given"
 	    " 'file/pattern' and"
 	    "\n     send the result to 'svn propset svn:ignore -F - dir'"
+	    "\n  -R"
+	    "\n     Update the 'svn:ignore' property of each versioned"
+	    " directory below 'dir' (and"
+	    "\n     of 'dir' itself) which has an ignore 'file' (given with"
+	    " '-r') or,"
+	    "\n     if 'file/pattern's are given, of each directory which"
+	    " isn't ignored"
+	    "\n     by it's parent. Only the directories whose property"
+	    " differs are"
+	    "\n     changed (with one 'svn propset --targets' for each"
+	    " distinct value)."
+	    "\n  -n"
+	    "\n     (With '-R') Only list the directories which would be"
+	    " changed."
 	    "\n  -w file"
 	    "\n     Create (or overwrite) 'file' and fill it with the given"
 	    " 'file/pattern'"
 	    "\n     values (one per line)."
 	    "\n  file/pattern"
 	    "\n     A list of file(-pattern)s"
-	    "\n", prog, prog, prog);
+	    "\n", prog, prog, prog, prog);
     exit (0);
 }
 
@@ -306,19 +361,426 @@ bool is_file (const char *file)
     errno = EACCES; return false;
 }
 
+/* Run the 'svn' command 'cmd' (which produces XML), returning it's
+** (NUL-terminated) output in an allocated buffer (or NULL on failure) ...
+*/
+static char *svn_xml (const char *const *cmd)
+{
+    int pfd[2], wstat, ec;
+    pid_t pid;
+    char *buf = NULL, *p;
+    size_t len = 0, bufsz = 0;
+    ssize_t rc;
+    if (pipe (pfd) < 0) { return NULL; }
+    switch ((pid = fork())) {
+	case -1:
+	    /*ERROR*/
+	    ec = errno; close (pfd[0]); close (pfd[1]); errno = ec;
+	    return NULL;
+	case 0:
+	    /*CHILD*/
+	    dup2 (pfd[1], 1); close (pfd[0]); close (pfd[1]);
+	    execvp (*cmd, (char *const *) cmd);
+	    fprintf (stderr, "svn %s - %s\n", cmd[1], strerror (errno));
+	    exit (99);
+	default: /*PARENT*/
+	    break;
+    }
+    close (pfd[1]);
+    for (;;) {
+	if (len + 1 >= bufsz) {
+	    bufsz = (bufsz ? 2 * bufsz : 65536);
+	    if (!(p = (char *) realloc (buf, bufsz))) { goto ERROUT; }
+	    buf = p;
+	}
+	if ((rc = read (pfd[0], buf + len, bufsz - len - 1)) < 0) {
+	    if (errno == EINTR) { continue; }
+	    goto ERROUT;
+	}
+	if (rc == 0) { break; }
+	len += (size_t) rc;
+    }
+    close (pfd[0]);
+    buf[len] = '\0';
+    waitpid (pid, &wstat, 0);
+    if (! WIFEXITED(wstat) || WEXITSTATUS(wstat) != 0) {
+	free (buf);
+	errno = (WIFEXITED(wstat) && WEXITSTATUS(wstat) == 99
+		 ? ENOENT : ECOMM);
+	return NULL;
+    }
+    return buf;
+ERROUT:
+    ec = errno;
+    close (pfd[0]); kill (pid, SIGPIPE); waitpid (pid, &wstat, 0);
+    free (buf); errno = ec;
+    return NULL;
+}
+
+/* Replace the XML entities in 's' (in place) ... */
+static char *xml_unescape (char *s)
+{
+    static const struct { const char *name; char c; } ents[] = {
+	{ "&lt;", '<' }, { "&gt;", '>' }, { "&amp;", '&' },
+	{ "&quot;", '"' }, { "&apos;", '\'' }, { NULL, 0 }
+    };
+    char *p, *q;
+    int ix;
+    for (p = q = s; *q; ) {
+	if (*q == '&') {
+	    for (ix = 0; ents[ix].name; ++ix) {
+		size_t len = strlen (ents[ix].name);
+		if (strncmp (q, ents[ix].name, len) == 0) {
+		    *p++ = ents[ix].c; q += len; break;
+		}
+	    }
+	    if (ents[ix].name) { continue; }
+	}
+	*p++ = *q++;
+    }
+    *p = '\0';
+    return s;
+}
+
+/* The state of the recursive mode. 'dirs' holds the directories which
+** currently have the property (each one with the number of it's entries),
+** 'current' the entries themselves (each one as "dir\nentry"), 'versioned'
+** all directories under version control (only these are visited). The
+** directories to be changed are collected in 'groups' (one for each distinct
+** new value; 'values' maps a value to it's group) ...
+*/
+struct group {
+    const char *value;
+    struct strlist targets;
+};
+
+struct rstate {
+    const char *prop, *ignore_file;
+    int argc;
+    char **argv;
+    bool dry_run;
+    struct strhash dirs, current, values, versioned;
+    struct group *groups;
+    size_t ngroups;
+    struct dirread dr;
+    char *buf;
+    size_t bufsz;
+};
+
+/* Store 'a' + sep + 'b' in 'rs->buf' ... */
+static char *rs_join (struct rstate *rs, const char *a, int sep,
+		      const char *b)
+{
+    size_t al = strlen (a), bl = strlen (b);
+    char *p;
+    if (al + bl + 2 > rs->bufsz) {
+	size_t nsz = al + bl + 1024;
+	if (!(p = (char *) realloc (rs->buf, nsz))) { return NULL; }
+	rs->buf = p; rs->bufsz = nsz;
+    }
+    memcpy (rs->buf, a, al); rs->buf[al] = (char) sep;
+    memcpy (rs->buf + al + 1, b, bl + 1);
+    return rs->buf;
+}
+
+/* Parse the output of 'svn propget --xml' into 'rs->dirs' and
+** 'rs->current' ...
+*/
+static int parse_props (struct rstate *rs, char *xml)
+{
+    char *p = xml, *path, *val, *end, *q;
+    struct sh_entry *de;
+    int is_new;
+    while ((p = strstr (p, "<target"))) {
+	if (!(p = strstr (p, "path=\""))) { break; }
+	path = p + 6;
+	if (!(p = strchr (path, '"'))) { break; }
+	*p++ = '\0'; xml_unescape (path);
+	if (!(end = strstr (p, "</target>"))) { break; }
+	*end = '\0';
+	/* (A value which isn't plain text never equals a new one) */
+	if ((val = strstr (p, "<property")) && (val = strchr (val, '>'))
+	&&  (q = strstr (++val, "</property>"))) {
+	    *q = '\0'; xml_unescape (val);
+	    if (!(de = sh_insert (&rs->dirs, path, 0, NULL))) { return -1; }
+	    for (p = val; *p; p = q) {
+		if (!(q = strchr (p, '\n'))) { q = p + strlen (p); }
+		if (*q) { *q++ = '\0'; }
+		if (! *p) { continue; }
+		if (! rs_join (rs, path, '\n', p)
+		||  ! sh_insert (&rs->current, rs->buf, 0, &is_new)) {
+		    return -1;
+		}
+		if (is_new) { ++de->value; }
+	    }
+	}
+	p = end + 1;
+    }
+    return 0;
+}
+
+/* Parse the output of 'svn info -R --xml' into 'rs->versioned' (the
+** pathnames of all versioned directories) ...
+*/
+static int parse_versioned (struct rstate *rs, char *xml)
+{
+    char *p = xml, *end, *path, *q;
+    while ((p = strstr (p, "<entry"))) {
+	if (!(end = strchr (p, '>'))) { break; }
+	*end = '\0';
+	if (strstr (p, "kind=\"dir\"") && (path = strstr (p, "path=\""))
+	&&  (q = strchr (path += 6, '"'))) {
+	    *q = '\0'; xml_unescape (path);
+	    if (! sh_insert (&rs->versioned, path, 0, NULL)) { return -1; }
+	}
+	p = end + 1;
+    }
+    return 0;
+}
+
+/* Check if the property of 'dir' already consists of the entries of 'list'
+** ('count' elements) ...
+*/
+static bool rs_unchanged (struct rstate *rs, const char *dir, list_t *list,
+			  size_t count)
+{
+    struct sh_entry *de = sh_lookup (&rs->dirs, dir);
+    list_t *el;
+    if (! de || (size_t) de->value != count) { return false; }
+    for (el = list; el; el = el->next) {
+	if (! rs_join (rs, dir, '\n', el->s)
+	||  ! sh_lookup (&rs->current, rs->buf)) {
+	    return false;
+	}
+    }
+    return true;
+}
+
+/* Add 'dir' to the group of the new value 'value' ... */
+static int rs_change (struct rstate *rs, const char *dir, const char *value)
+{
+    static const struct strlist sl_empty = STRLIST_INIT;
+    struct sh_entry *ve;
+    struct group *g;
+    int is_new;
+    if (!(ve = sh_insert (&rs->values, value, (int) rs->ngroups, &is_new))) {
+	return -1;
+    }
+    if (is_new) {
+	g = (struct group *) realloc (rs->groups,
+				      (rs->ngroups + 1) * sizeof(*g));
+	if (! g) { return -1; }
+	rs->groups = g; g += rs->ngroups++;
+	g->value = ve->key; g->targets = sl_empty;
+    }
+    return (sl_append (&rs->groups[ve->value].targets, dir) ? 0 : -1);
+}
+
+/* Compute the ignore set of 'dir' (recording a change if it differs from
+** the current property) and then descend into the (versioned) sub-directories
+** which aren't ignored ...
+*/
+static int update_tree (struct rstate *rs, const char *dir)
+{
+    list_t *list = NULL, *el;
+    struct strhash seen = STRHASH_INIT;
+    struct strlist subdirs = STRLIST_INIT;
+    struct sl_item *sd;
+    struct dr_entry de;
+    char *value;
+    int rc = -1, ec;
+    if (rs->ignore_file) {
+	if (! rs_join (rs, dir, '/', rs->ignore_file)) { goto EXIT_POINT; }
+	if (access (rs->buf, F_OK) == 0
+	&&  read_ignore_file (rs->buf, &list, &seen) < 0) {
+	    fprintf (stderr, "%s: \"%s\" - %s\n", prog, rs->buf,
+		     strerror (errno));
+	    goto EXIT_POINT;
+	}
+    }
+    if (add_ignores (rs->argc, rs->argv, &list, &seen) < 0) {
+	goto EXIT_POINT;
+    }
+    if (list && ! rs_unchanged (rs, dir, list, seen.count)) {
+	/* (Sorted, so equal sets share one 'svn propset') */
+	if (!(value = list_join (list, true))) { goto EXIT_POINT; }
+	rc = rs_change (rs, dir, value);
+	free (value);
+	if (rc) { goto EXIT_POINT; }
+	rc = -1;
+    }
+    if (dr_open (&rs->dr, dir)) {
+	fprintf (stderr, "%s: \"%s\" - %s\n", prog, dir, strerror (errno));
+	goto EXIT_POINT;
+    }
+    while ((rc = dr_next (&rs->dr, &de)) > 0) {
+	if (strcmp (de.name, ".svn") == 0) { continue; }
+	if (de.type != DT_DIR && de.type != DT_UNKNOWN) { continue; }
+	for (el = list; el; el = el->next) {
+	    if (fnmatch (el->s, de.name, 0) == 0) { break; }
+	}
+	if (el) { continue; }
+	if (strcmp (dir, ".") == 0) {
+	    if (! rs_join (rs, ".", '/', de.name)) { rc = -1; break; }
+	    memmove (rs->buf, rs->buf + 2, strlen (rs->buf + 2) + 1);
+	} else if (! rs_join (rs, dir, '/', de.name)) {
+	    rc = -1; break;
+	}
+	/* (Setting a property on an unversioned directory would let the
+	** whole 'svn propset' fail) */
+	if (! sh_lookup (&rs->versioned, rs->buf)) { continue; }
+	if (! sl_append (&subdirs, rs->buf)) { rc = -1; break; }
+    }
+    ec = errno; dr_close (&rs->dr); errno = ec;
+    if (rc < 0) { goto EXIT_POINT; }
+    for (sd = subdirs.first; sd; sd = sd->next) {
+	if (update_tree (rs, sd->str)) { goto EXIT_POINT; }
+    }
+    rc = 0;
+EXIT_POINT:
+    ec = errno;
+    sh_free (&seen);
+    sl_free (&subdirs);
+    errno = ec;
+    return rc;
+}
+
+/* Apply the changes, with one 'svn propset --targets' for each group (or
+** list the changed directories if 'rs->dry_run' is set) ...
+*/
+static int apply_changes (struct rstate *rs)
+{
+    const char *tmpdir = getenv ("TMPDIR");
+    char *tmpfile;
+    size_t tmpfilesz;
+    struct sl_item *it;
+    struct group *g;
+    FILE *fp;
+    size_t ix;
+    int fd, rc = 0;
+    if (! tmpdir || ! *tmpdir) { tmpdir = "/tmp"; }
+    tmpfilesz = strlen (tmpdir) + sizeof("/svnignore.XXXXXX");
+    if (!(tmpfile = (char *) malloc (tmpfilesz))) { return -1; }
+    for (ix = 0; ix < rs->ngroups; ++ix) {
+	g = &rs->groups[ix];
+	if (rs->dry_run) {
+	    for (it = g->targets.first; it; it = it->next) {
+		printf ("%s\n", it->str);
+	    }
+	    continue;
+	}
+	snprintf (tmpfile, tmpfilesz, "%s/svnignore.XXXXXX", tmpdir);
+	if ((fd = mkstemp (tmpfile)) < 0) { rc = -1; break; }
+	if (!(fp = fdopen (fd, "w"))) {
+	    errguard (close (fd); unlink (tmpfile));
+	    rc = -1; break;
+	}
+	for (it = g->targets.first; it; it = it->next) {
+	    fprintf (fp, "%s\n", it->str);
+	}
+	if (fclose (fp) == EOF) {
+	    errguard (unlink (tmpfile)); rc = -1; break;
+	}
+	rc = svn_propset (rs->prop, NULL, tmpfile, g->value);
+	errguard (unlink (tmpfile));
+	if (rc) { rc = -1; break; }
+    }
+    errguard (free (tmpfile));
+    return rc;
+}
+
+static void rs_free (struct rstate *rs)
+{
+    size_t ix;
+    for (ix = 0; ix < rs->ngroups; ++ix) { sl_free (&rs->groups[ix].targets); }
+    free (rs->groups);
+    sh_free (&rs->dirs); sh_free (&rs->current); sh_free (&rs->values);
+    sh_free (&rs->versioned);
+    dr_free (&rs->dr);
+    free (rs->buf);
+}
+
+/* The recursive mode ('-R') ... */
+static void update_recursive (const char *dir, const char *file, int argc,
+			      char *argv[], bool dry_run)
+{
+    struct rstate rs;
+    const char *propget[] = {
+	"svn", "propget", "-R", "--xml", NULL, NULL, NULL
+    };
+    const char *info[] = { "svn", "info", "-R", "--xml", NULL, NULL };
+    const char *wd = cwd ();
+    char *xml, *buf = NULL;
+    size_t bufsz = 0, ofs, wdlen = strlen (wd);
+    memset (&rs, 0, sizeof(rs));
+    rs.prop = "svn:ignore"; rs.ignore_file = file;
+    rs.argc = argc; rs.argv = argv; rs.dry_run = dry_run;
+    dr_init (&rs.dr, 0);
+    /* The pathnames built by 'update_tree()' must look like the ones 'svn'
+    ** reports, so 'dir' is normalized ('./wc', 'wc/./sub/' and the like) and
+    ** - if it is below the working directory - made relative again ...
+    */
+    if (trans_paths (wd, 1, &dir, &buf, &bufsz, &ofs)) {
+	quit (EX_OSERR, "trans_paths() - %s", strerror (errno));
+    }
+    dir = buf + ofs;
+    if (strcmp (dir, wd) == 0) {
+	dir = ".";
+    } else if (wdlen > 1 && strncmp (dir, wd, wdlen) == 0
+	   &&  dir[wdlen] == '/') {
+	dir += wdlen + 1;
+    }
+    propget[4] = rs.prop; propget[5] = dir;
+    if (!(xml = svn_xml (propget))) {
+	quit (EX_PROTOCOL, "svn propget %s ... failed - %s", rs.prop,
+	      strerror (errno));
+    }
+    if (parse_props (&rs, xml)) {
+	quit (EX_OSERR, "parse_props() - %s", strerror (errno));
+    }
+    free (xml);
+    info[4] = dir;
+    if (!(xml = svn_xml (info))) {
+	quit (EX_PROTOCOL, "svn info ... failed - %s", strerror (errno));
+    }
+    if (parse_versioned (&rs, xml)) {
+	quit (EX_OSERR, "parse_versioned() - %s", strerror (errno));
+    }
+    free (xml);
+    if (! sh_lookup (&rs.versioned, dir)) {
+	quit (EX_DATAERR, "'%s' is no versioned directory", dir);
+    }
+    if (update_tree (&rs, dir)) { exit (EX_OSERR); }
+    if (apply_changes (&rs)) {
+	quit (EX_PROTOCOL, "svn propset %s --targets ... failed.", rs.prop);
+    }
+    rs_free (&rs);
+    list_free (NULL);
+    free (buf);
+}
+
 int main (int argc, char *argv[])
 {
     int opt;
-    const char *file = NULL, *dir = NULL;
-    bool wflag = false, rflag = false;
+    const char *file = NULL;
+    char *dir = NULL;
+    bool wflag = false, rflag = false, Rflag = false, nflag = false;
     list_t *list = NULL;
+    struct strhash seen = STRHASH_INIT;
 
     prog = bn (*argv);
 
     if (argc < 2) { usage (NULL); }
-    while ((opt = getopt (argc, argv, "+:r:w:")) != -1) {
+    while ((opt = getopt (argc, argv, "+:hnRr:w:")) != -1) {
 	switch (opt) {
 	    case 'h': usage (NULL);
+	    case 'n': nflag = true; break;
+	    case 'R':
+		if (wflag) {
+		    usage ("Options '-R' and '-w' are mutually exclusive.");
+		}
+		Rflag = true;
+		break;
 	    case 'r':
 		if (rflag) { usage ("Ambiguous option '-%c'", opt); }
 		if (wflag) {
@@ -331,6 +793,9 @@ int main (int argc, char *argv[])
 		if (rflag) {
 		    usage ("Options '-r' and '-w' are mutually exclusive.");
 		}
+		if (Rflag) {
+		    usage ("Options '-R' and '-w' are mutually exclusive.");
+		}
 		file = optarg; wflag = true;
 		break;
 	    case ':': usage ("Missing argument for option '-%c'.", optopt);
@@ -346,15 +811,24 @@ int main (int argc, char *argv[])
 	    quit (EX_NOPERM, "\"%s\" - not a directory.", dir);
 	}
     }
+    if (nflag && ! Rflag) { usage ("Option '-n' requires '-R'."); }
+    if (Rflag && ! file && optind >= argc) {
+	usage ("Neither '-r file' nor a file/pattern given.");
+    }
+    if (Rflag) {
+	/* (Here, 'file' is the name of the ignore file in each directory) */
+	update_recursive (dir, file, argc - optind, &argv[optind], nflag);
+	return 0;
+    }
     if (rflag) {
 	if (! is_file (file)) {
 	    quit (EX_NOINPUT, "\"%s\" - %s", file, strerror (errno));
 	}
-	if (read_ignore_file (file, &list) < 0) {
+	if (read_ignore_file (file, &list, &seen) < 0) {
 	    quit (EX_NOINPUT, "\"%s\" - %s", file, strerror (errno));
 	}
     }
-    if (add_ignores (argc - optind, &argv[optind], &list) < 0) {
+    if (add_ignores (argc - optind, &argv[optind], &list, &seen) < 0) {
 	quit (EX_OSERR, "add_ignores() - %s", strerror (errno));
     }
     if (! list) {
@@ -369,9 +843,16 @@ int main (int argc, char *argv[])
 	}
     } else {
 	const char *prop = "svn:ignore";
-	if (svn_propset (prop, dir, list)) {
+	char *value = list_join (list, false);
+	if (! value) {
+	    quit (EX_OSERR, "list_join() - %s", strerror (errno));
+	}
+	if (svn_propset (prop, dir, NULL, value)) {
 	    quit (EX_PROTOCOL, "svn propset %s ... failed.", prop);
 	}
+	free (value);
     }
+    sh_free (&seen);
+    list_free (list);
     return 0;
 }
@@ -0,0 +1,53 @@
+#! /bin/sh
+# tests/install-tree-test.sh
+#
+# $Id$
+#
+# Author: Boris Jakubith
+# E-Mail: runkharr@googlemail.com
+# Copyright: (c) 2026, Boris Jakubith <runkharr@googlemail.com>
+# License: GNU General Public License, version 2
+#
+# Check the recursive mode of 'install' ('-r') with a source tree containing
+# symbolic links to directories: links to a directory of their own path
+# (loops like 'up -> ..') must be recreated as links, all other links to
+# directories are followed.
+#
+# Synopsis:
+#    sh tests/install-tree-test.sh [install-program]
+#
+# The exit code is 0 if all checks passed and 1 otherwise.
+#
+
+INSTALL="${1:-./install}"
+case "$INSTALL" in /*) ;; *) INSTALL="$PWD/$INSTALL" ;; esac
+
+tmp=`mktemp -d "${TMPDIR:-/tmp}/install-test.XXXXXX"` || exit 1
+trap 'rm -rf "$tmp"' 0
+
+errs=0
+fail () { echo "FAIL: $*"; errs=`expr $errs + 1`; }
+
+mkdir -p "$tmp/src/a/b" || exit 1
+echo x > "$tmp/src/a/b/f"
+ln -s .. "$tmp/src/a/up"
+ln -s ../.. "$tmp/src/a/b/top"
+ln -s b "$tmp/src/a/bb"
+
+cd "$tmp" || exit 1
+# (A loop would let 'install' run until it runs out of file descriptors)
+if ! "$INSTALL" -r src dst; then fail "install -r src dst"; fi
+
+[ -h dst/a/up ] || fail "dst/a/up is no symbolic link"
+[ "`readlink dst/a/up 2>/dev/null`" = ".." ] || fail "dst/a/up -> ?"
+[ -h dst/a/b/top ] || fail "dst/a/b/top is no symbolic link"
+[ -f dst/a/b/f ] || fail "dst/a/b/f is missing"
+# (Not a loop: 'bb' is followed and installed as a directory)
+[ -d dst/a/bb -a ! -h dst/a/bb ] || fail "dst/a/bb is no directory"
+[ -f dst/a/bb/f ] || fail "dst/a/bb/f is missing"
+n=`find dst | wc -l`
+[ "$n" -le 12 ] || fail "dst has $n entries"
+
+if [ $errs -gt 0 ]; then echo "$errs check(s) failed"; exit 1; fi
+echo "OK"
+exit 0
@@ -0,0 +1,153 @@
+/* tests/rxdfa-test.c
+**
+** $Id$
+**
+** Author: Boris Jakubith
+** E-Mail: runkharr@googlemail.com
+** Copyright: (c) 2026, Boris Jakubith <runkharr@googlemail.com>
+** License: GNU General Public License, version 2
+**
+** Check 'lib/rxdfa.c': compile many RXDFA_SUBTREE patterns at once (which
+** must neither fail with E2BIG nor produce an exponential number of states)
+** and compare the results of the automaton with 'fnmatch()' for a set of
+** generated pathnames. Corrupted images must be rejected by
+** 'rxdfa_attach()'.
+**
+** Synopsis:
+**    cc -I. -o rxdfa-test tests/rxdfa-test.c && ./rxdfa-test
+**
+** The exit code is 0 if all checks passed and 1 otherwise.
+**
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fnmatch.h>
+
+#include "lib/rxdfa.c"
+#include "lib/rxdfa_match.c"
+
+#define MAXSTATES 4096
+
+static const char *common[] = {
+    "./*.o", "./*.a", "./*.so", "./*~", "./*.bak", "./*.swp", "./*.orig",
+    "./*.rej", "./*.tmp", "./*.log", "./core", "./.deps", "./*/.deps",
+    "./.libs", "./*/.libs", "./*.l[ao]", "./autom4te.cache", "./[!a-z]*.x",
+};
+
+#define NCOMMON (sizeof(common) / sizeof(common[0]))
+#define NEXTRA 40
+
+/* The reference: a pattern matches 'path' (RXDFA_SUBTREE) if it matches
+** 'path' itself or a prefix of it which is followed by a '/' ...
+*/
+static int ref_match (size_t npats, const char *const *pats, const char *path)
+{
+    char buf[256];
+    size_t ix, len = strlen (path), l;
+    for (l = 1; l <= len; ++l) {
+	if (l < len && path[l] != '/') { continue; }
+	memcpy (buf, path, l); buf[l] = '\0';
+	for (ix = 0; ix < npats; ++ix) {
+	    if (fnmatch (pats[ix], buf, 0) == 0) { return 1; }
+	}
+    }
+    return 0;
+}
+
+static void gen_path (char *buf, unsigned *seed)
+{
+    static const char *parts[] = {
+	"src", "a.o", "lib.so", "x~", ".deps", "core", "b.la", "Q.x", "d.c",
+	"f.tmp", "README", ".libs", "e.x3", "g.x17", "sub", "h.rej",
+    };
+    size_t n = 1 + rand_r (seed) % 4, ix;
+    strcpy (buf, ".");
+    for (ix = 0; ix < n; ++ix) {
+	strcat (buf, "/");
+	strcat (buf, parts[rand_r (seed) % (sizeof(parts) / sizeof(parts[0]))]);
+    }
+}
+
+/* Attach a copy of the image of 'dfa', with one byte of the class table or
+** one transition corrupted ('what': 0 = none, 1 = class, 2 = transition),
+** returning the result of 'rxdfa_attach()' ...
+*/
+static int attach_copy (const struct rxdfa *dfa, int what)
+{
+    struct rxdfa d2;
+    char *img = (char *) malloc (dfa->size);
+    int rc;
+    if (! img) { return -2; }
+    memcpy (img, dfa->image, dfa->size);
+    if (what == 1) {
+	img[RXDFA_CLS_OFS + 'x'] = (char) 0xFF;
+    } else if (what == 2) {
+	uint32_t bad = dfa->nstates;
+	memcpy (img + RXDFA_TRANS_OFS (dfa->nstates), &bad, sizeof(bad));
+    }
+    rc = rxdfa_attach (&d2, img, dfa->size);
+    if (rc && errno != ESTALE) { rc = -2; }
+    free (img);
+    return rc;
+}
+
+static int check_attach (const struct rxdfa *dfa)
+{
+    int errors = 0;
+    if (attach_copy (dfa, 0) != 0) {
+	printf ("FAIL: attaching a valid image\n"); ++errors;
+    }
+    if (attach_copy (dfa, 1) != -1) {
+	printf ("FAIL: attaching an image with a corrupt class table\n");
+	++errors;
+    }
+    if (attach_copy (dfa, 2) != -1) {
+	printf ("FAIL: attaching an image with a corrupt transition\n");
+	++errors;
+    }
+    return errors;
+}
+
+int main (void)
+{
+    const char *pats[NCOMMON + NEXTRA];
+    char extra[NEXTRA][16], path[256];
+    struct rxdfa dfa;
+    size_t npats = 0, ix;
+    unsigned seed = 4711;
+    int errors = 0, m, r;
+    for (ix = 0; ix < NCOMMON; ++ix) { pats[npats++] = common[ix]; }
+    for (ix = 0; ix < NEXTRA; ++ix) {
+	snprintf (extra[ix], sizeof(extra[ix]), "./*.x%u", (unsigned) ix);
+	pats[npats++] = extra[ix];
+    }
+    if (rxdfa_compile (&dfa, npats, pats, RXDFA_SUBTREE)) {
+	printf ("FAIL: compiling %u patterns - %s\n", (unsigned) npats,
+		strerror (errno));
+	return 1;
+    }
+    if (dfa.nstates > MAXSTATES) {
+	printf ("FAIL: %u patterns yield %u states\n", (unsigned) npats,
+		(unsigned) dfa.nstates);
+	++errors;
+    }
+    for (ix = 0; ix < 20000; ++ix) {
+	gen_path (path, &seed);
+	m = rxdfa_match (&dfa, path, strlen (path));
+	r = ref_match (npats, pats, path);
+	if (m != r) {
+	    if (errors < 10) {
+		printf ("FAIL: %s - %s (expected: %s)\n", path,
+			(m ? "match" : "no match"), (r ? "match" : "no match"));
+	    }
+	    ++errors;
+	}
+    }
+    errors += check_attach (&dfa);
+    rxdfa_free (&dfa);
+    if (errors) { printf ("%d check(s) failed\n", errors); return 1; }
+    printf ("OK (%u patterns)\n", (unsigned) npats);
+    return 0;
+}
@@ -0,0 +1,759 @@
+/* travbench.c
+**
+** $Id$
+**
+** Author: Boris Jakubith
+** E-Mail: runkharr@googlemail.com
+** Copyright: (c) 2026, Boris Jakubith <runkharr@googlemail.com>
+** License: GNU General Public License, version 2
+**
+** Benchmark the directory walkers of 'lib/' and the tree copying/removing
+** functions of the tools ('copy_to()' of 'install', 'copy_tree()' and
+** 'collect_excludes()' of 'distfile', 'rmrec()' of 'cgen') on a synthetic
+** directory tree, which is generated in each of the given work directories
+** (e.g. one on a 'tmpfs' and one on a disk).
+**
+** Synopsis:
+**
+**    travbench [-d depth] [-w fanout] [-f files] [-s size] [-x excludes]
+**              [-j N] [-r runs] [-t variant,...] [-B bindir] [-n] [-J]
+**              workdir...
+**
+** Options:
+**   -d depth (default: 4)
+**     the depth of the generated tree (below it's top directory)
+**   -w fanout (default: 4)
+**     the number of sub-directories of each (non-leaf) directory
+**   -f files (default: 16)
+**     the number of files in each directory; every fourth file is an object
+**     file ('*.o'), which the exclude patterns remove
+**   -s size (default: 1024)
+**     the size (in bytes) of each file
+**   -x excludes (default: 16)
+**     the number of exclude patterns (for 'install' and 'distfile'); only
+**     one of them ('*.o') matches anything
+**   -j N (default: 4)
+**     the number of workers of the 'pwalk' variant
+**   -r runs (default: 3)
+**     the number of runs of each variant; the fastest run is reported
+**   -t variant,...
+**     run only the given variants (default: all of them): 'travdir',
+**     'travdirnd', 'travdirne', 'pwalk' (the walkers, which run in-process)
+**     and 'install', 'distfile-src', 'distfile-bin', 'cgen-clean' (which
+**     run the tool programs)
+**   -B bindir
+**     take the (compiled) tool programs from 'bindir'; by default, they are
+**     built (via their wrappers in the directory of 'travbench') into the
+**     first work directory
+**   -n
+**     don't count the system calls (which needs an additional run of each
+**     variant under 'ptrace()')
+**   -J
+**     write the results as a JSON array (instead of tab-separated values)
+**
+** Each run is executed in a child process, so the peak RSS and the CPU times
+** are those of the variant alone. The system calls are counted in an extra
+** (untimed) run, whose system calls are intercepted with 'ptrace()'; for the
+** tool variants, the system calls of the programs these tools start (e.g.
+** 'cp' for 'distfile-bin') aren't counted. 'distfile-src' includes the
+** removal of the copied tree, 'distfile-bin' the installation (with 'cp')
+** of the tree to be packed. The columns of the result are:
+**    fs variant entries bytes runs wall_s user_s sys_s entries_per_s
+**    bytes_per_s syscalls maxrss_kb
+** 'bytes' is 0 for the variants which don't copy anything; 'syscalls' is -1
+** if they weren't counted.
+**
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <signal.h>
+#include <time.h>
+#include <fcntl.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <sys/vfs.h>
+#include <sys/ptrace.h>
+
+#define PROG "travbench"
+
+#include "lib/set_prog.c"
+#include "lib/mrmacs.c"
+#include "lib/pbCopy.c"
+#include "lib/travdir-types.c"
+#include "lib/travdir.c"
+#include "lib/travdirnd.c"
+#include "lib/travdirne.c"
+#include "lib/dirread.c"
+#include "lib/dr_open.c"
+#include "lib/pwalk.c"
+
+struct bench {
+    int depth, fanout, files, njobs, runs, count, json, nrows;
+    size_t size;
+    int excludes;
+    const char *work, *bindir;
+    char *tree, *dst, *victim, *outdir, *exclfile, *cpcmd;
+    unsigned long long entries, bytes;
+};
+
+struct result {
+    double wall, user, sys;
+    long maxrss;
+    long long syscalls;
+};
+
+struct variant {
+    const char *name;
+    int copies;			/* (The variant copies the file data) */
+    int (*prepare) (struct bench *b);
+    int (*run) (struct bench *b);	/* (In the child process) */
+};
+
+static char *bconcat (const char *a, const char *b)
+{
+    char *res;
+    ifnull (res = t_allocv (char, strlen (a) + strlen (b) + 2)) {
+	fprintf (stderr, "%s: %s\n", prog, strerror (errno)); exit (1);
+    }
+    pbCopy (pbCopy (pbCopy (res, a), "/"), b);
+    return res;
+}
+
+/* Generate the tree (a directory with 'b->files' files and - if 'depth' is
+** greater than 0 - 'b->fanout' sub-trees of the depth 'depth - 1') ...
+*/
+static int gen_tree (struct bench *b, const char *dir, int depth)
+{
+    static char data[65536];
+    char *path;
+    size_t len, wlen;
+    int ix, fd, rc = 0;
+    if (mkdir (dir, 0755)) { return -1; }
+    ifnull (path = t_allocv (char, strlen (dir) + 32)) { return -1; }
+    len = (size_t) (pbCopy (pbCopy (path, dir), "/") - path);
+    memset (data, 'x', sizeof(data));
+    for (ix = 0; rc == 0 && ix < b->files; ++ix) {
+	size_t left = b->size;
+	sprintf (path + len, "f%d.%c", ix, (ix % 4 == 3 ? 'o' : 'c'));
+	if ((fd = open (path, O_WRONLY|O_CREAT|O_TRUNC, 0644)) < 0) {
+	    rc = -1; break;
+	}
+	while (left > 0) {
+	    wlen = (left < sizeof(data) ? left : sizeof(data));
+	    if (write (fd, data, wlen) != (ssize_t) wlen) { rc = -1; break; }
+	    left -= wlen;
+	}
+	if (close (fd)) { rc = -1; }
+	++b->entries; b->bytes += b->size;
+    }
+    for (ix = 0; rc == 0 && depth > 0 && ix < b->fanout; ++ix) {
+	sprintf (path + len, "d%d", ix);
+	rc = gen_tree (b, path, depth - 1);
+    }
+    ++b->entries;
+    free (path);
+    return rc;
+}
+
+/* Remove the tree 'dir' (if it exists) ... */
+static int rm_tree (const char *dir)
+{
+    struct dirread dr;
+    struct dr_entry de;
+    struct stat sb;
+    char *path;
+    int rc = 0, nr;
+    if (lstat (dir, &sb)) { return (errno == ENOENT ? 0 : -1); }
+    if (! S_ISDIR (sb.st_mode)) { return unlink (dir); }
+    dr_init (&dr, 0);
+    if (dr_open (&dr, dir)) { return -1; }
+    while (rc == 0 && (nr = dr_next (&dr, &de)) > 0) {
+	path = bconcat (dir, de.name);
+	if (de.type == DT_DIR) {
+	    rc = rm_tree (path);
+	} else if (unlink (path) && (errno != EISDIR || rm_tree (path))) {
+	    rc = -1;
+	}
+	free (path);
+    }
+    if (nr < 0) { rc = -1; }
+    dr_free (&dr);
+    return (rc ? rc : rmdir (dir));
+}
+
+/* Create a copy of the tree 'src' (consisting of hard links) ... */
+static int link_tree (const char *src, const char *dst)
+{
+    struct dirread dr;
+    struct dr_entry de;
+    char *sp, *dp;
+    int rc = 0, nr;
+    if (mkdir (dst, 0755)) { return -1; }
+    dr_init (&dr, 0);
+    if (dr_open (&dr, src)) { return -1; }
+    while (rc == 0 && (nr = dr_next (&dr, &de)) > 0) {
+	sp = bconcat (src, de.name); dp = bconcat (dst, de.name);
+	rc = (de.type == DT_DIR ? link_tree (sp, dp) : link (sp, dp));
+	free (sp); free (dp);
+    }
+    if (nr < 0) { rc = -1; }
+    dr_free (&dr);
+    return rc;
+}
+
+/* Return (a copy of) the directory part of 'path' ... */
+static char *dir_of (const char *path)
+{
+    const char *p = strrchr (path, '/');
+    char *res;
+    size_t len = (p ? (p == path ? 1 : (size_t) (p - path)) : 1);
+    ifnull (res = t_allocv (char, len + 1)) { return NULL; }
+    if (p) { memcpy (res, path, len); } else { *res = '.'; }
+    res[len] = '\0';
+    return res;
+}
+
+/*#### The variants ####*/
+
+static int get_filetype (const char *path, int *_filetype)
+{
+    struct stat sb;
+    if (lstat (path, &sb)) { return -1; }
+    *_filetype = (S_ISDIR (sb.st_mode) ? FT_DIRECTORY : FT_FILE);
+    return 0;
+}
+
+static unsigned long long visited;
+
+static int count_entry (const char *path, int filetype, void *data)
+{
+    (void) path; (void) filetype; (void) data;
+    ++visited; return 0;
+}
+
+static int walk_exit (int rc)
+{
+    if (rc) { fprintf (stderr, "%s: %s\n", prog, strerror (errno)); }
+    return (rc ? 1 : 0);
+}
+
+static int run_travdir (struct bench *b)
+{
+    char *buf = NULL;
+    size_t bufsz = 0;
+    return walk_exit (travdir (&buf, &bufsz, b->tree, get_filetype,
+			       count_entry, NULL));
+}
+
+static int run_travdirnd (struct bench *b)
+{
+    char *buf = NULL;
+    size_t bufsz = 0;
+    return walk_exit (travdirnd (&buf, &bufsz, b->tree, get_filetype,
+				 count_entry, NULL));
+}
+
+static int run_travdirne (struct bench *b)
+{
+    char *buf = NULL;
+    size_t bufsz = 0;
+    return walk_exit (travdirne (&buf, &bufsz, b->tree, get_filetype,
+				 count_entry, NULL));
+}
+
+static int pw_count_entry (const char *path, int filetype, int worker,
+			   void *data)
+{
+    (void) path; (void) filetype;
+    ++((unsigned long long *) data)[worker]; return 0;
+}
+
+static int run_pwalk (struct bench *b)
+{
+    unsigned long long *counts;
+    ifnull (counts = t_allocv (unsigned long long, b->njobs)) { return 1; }
+    memset (counts, 0, b->njobs * sizeof(*counts));
+    return walk_exit (pwalk (b->tree, b->njobs, 0, get_filetype,
+			     pw_count_entry, NULL, (void *) counts));
+}
+
+static void run_tool (const char *dir, char **argv)
+{
+    int fd;
+    /* (The output of the tools would be mixed up with the results) */
+    if ((fd = open ("/dev/null", O_WRONLY)) >= 0) {
+	dup2 (fd, 1); close (fd);
+    }
+    if (dir && chdir (dir)) {
+	fprintf (stderr, "%s: %s - %s\n", prog, dir, strerror (errno));
+	_exit (1);
+    }
+    execv (argv[0], argv);
+    fprintf (stderr, "%s: %s - %s\n", prog, argv[0], strerror (errno));
+    _exit (127);
+}
+
+/* (The arguments for the exclude patterns of 'install': '-X pattern') */
+static char **exclude_args (struct bench *b, char **argv)
+{
+    static char pats[64][32];
+    int ix, n = (b->excludes < 64 ? b->excludes : 64);
+    for (ix = 0; ix < n; ++ix) {
+	if (ix == 0) {
+	    strcpy (pats[ix], "*.o");
+	} else {
+	    sprintf (pats[ix], "*.nomatch%d", ix);
+	}
+	*argv++ = (char *) "-X"; *argv++ = pats[ix];
+    }
+    return argv;
+}
+
+static int prepare_install (struct bench *b)
+{
+    if (rm_tree (b->dst)) { return -1; }
+    return mkdir (b->dst, 0755);
+}
+
+static int run_install (struct bench *b)
+{
+    char *argv[140], **ap = argv;
+    *ap++ = bconcat (b->bindir, "install"); *ap++ = (char *) "-r";
+    ap = exclude_args (b, ap);
+    *ap++ = b->tree; *ap++ = b->dst; *ap = NULL;
+    run_tool (NULL, argv);
+    return 1;
+}
+
+static int prepare_distfile (struct bench *b)
+{
+    if (rm_tree (b->outdir)) { return -1; }
+    return mkdir (b->outdir, 0755);
+}
+
+static int run_distfile (struct bench *b, const char *mode)
+{
+    char *argv[16], **ap = argv;
+    *ap++ = bconcat (b->bindir, "distfile"); *ap++ = (char *) "-q";
+    *ap++ = (char *) "-c"; *ap++ = (char *) "true";
+    *ap++ = (char *) "-p"; *ap++ = (char *) "%p%s.none\ttrue";
+    if (! strcmp (mode, "bindist")) {
+	*ap++ = (char *) "-i"; *ap++ = b->cpcmd;
+    }
+    *ap++ = (char *) "-x"; *ap++ = b->exclfile;
+    *ap++ = (char *) mode; *ap++ = b->outdir; *ap = NULL;
+    run_tool (b->tree, argv);
+    return 1;
+}
+
+static int run_distfile_src (struct bench *b)
+{
+    return run_distfile (b, "srcdist");
+}
+
+static int run_distfile_bin (struct bench *b)
+{
+    return run_distfile (b, "bindist");
+}
+
+static int prepare_cgen (struct bench *b)
+{
+    if (rm_tree (b->victim)) { return -1; }
+    return link_tree (b->tree, b->victim);
+}
+
+static int run_cgen (struct bench *b)
+{
+    char *argv[8], **ap = argv;
+    *ap++ = bconcat (b->bindir, "cgen"); *ap++ = (char *) "clean";
+    *ap++ = (char *) "-s"; *ap++ = (char *) "-C"; *ap++ = (char *) b->work;
+    *ap++ = (char *) "victim"; *ap = NULL;
+    run_tool (NULL, argv);
+    return 1;
+}
+
+static const struct variant variants[] = {
+    { "travdir", 0, NULL, run_travdir },
+    { "travdirnd", 0, NULL, run_travdirnd },
+    { "travdirne", 0, NULL, run_travdirne },
+    { "pwalk", 0, NULL, run_pwalk },
+    { "install", 1, prepare_install, run_install },
+    { "distfile-src", 1, prepare_distfile, run_distfile_src },
+    { "distfile-bin", 1, prepare_distfile, run_distfile_bin },
+    { "cgen-clean", 0, prepare_cgen, run_cgen },
+    { NULL, 0, NULL, NULL }
+};
+
+/*#### Running and measuring ####*/
+
+static double now (void)
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+static double tv2s (const struct timeval *tv)
+{
+    return (double) tv->tv_sec + (double) tv->tv_usec / 1e6;
+}
+
+/* Count the system calls of the (stopped) traced child 'pid' (and it's
+** threads) until it terminates; returns -1 if this failed ...
+*/
+static long long trace_syscalls (pid_t pid, int *_status)
+{
+    long long stops = 0;
+    int st, sig;
+    pid_t tid;
+    if (waitpid (pid, &st, 0) != pid || ! WIFSTOPPED (st)) { return -1; }
+    if (ptrace (PTRACE_SETOPTIONS, pid, 0, PTRACE_O_TRACESYSGOOD
+		| PTRACE_O_TRACECLONE | PTRACE_O_EXITKILL)
+    ||  ptrace (PTRACE_SYSCALL, pid, 0, 0)) {
+	kill (pid, SIGKILL); waitpid (pid, &st, 0);
+	return -1;
+    }
+    while ((tid = waitpid (-1, &st, __WALL)) > 0) {
+	if (! WIFSTOPPED (st)) {
+	    if (tid == pid) { *_status = st; }
+	    continue;
+	}
+	sig = WSTOPSIG (st);
+	if (sig == (SIGTRAP | 0x80)) {
+	    ++stops; sig = 0;
+	} else if (sig == SIGTRAP || sig == SIGSTOP) {
+	    /* (Event stops - 'exec()', new threads) */
+	    sig = 0;
+	}
+	ptrace (PTRACE_SYSCALL, tid, 0, sig);
+    }
+    /* (Each system call stops on it's entry and on it's exit) */
+    return (stops + 1) / 2;
+}
+
+/* Execute one run of the variant 'v' (a traced one if 'trace' is set) ...
+*/
+static int run_once (struct bench *b, const struct variant *v, int trace,
+		     struct result *r)
+{
+    struct rusage ru;
+    double start;
+    int st = 0;
+    pid_t pid;
+    if (v->prepare && v->prepare (b)) {
+	fprintf (stderr, "%s: %s (preparing) - %s\n", prog, v->name,
+		 strerror (errno));
+	return -1;
+    }
+    fflush (stdout); fflush (stderr);
+    start = now ();
+    if ((pid = fork ()) < 0) { return -1; }
+    if (pid == 0) {
+	if (trace) {
+	    if (ptrace (PTRACE_TRACEME, 0, 0, 0)) { _exit (126); }
+	    raise (SIGSTOP);
+	}
+	_exit (v->run (b));
+    }
+    if (trace) {
+	r->syscalls = trace_syscalls (pid, &st);
+    } else {
+	if (wait4 (pid, &st, 0, &ru) != pid) { return -1; }
+	r->wall = now () - start;
+	r->user = tv2s (&ru.ru_utime); r->sys = tv2s (&ru.ru_stime);
+	r->maxrss = ru.ru_maxrss;
+    }
+    if (! WIFEXITED (st) || WEXITSTATUS (st) != 0) {
+	fprintf (stderr, "%s: %s failed\n", prog, v->name);
+	return -1;
+    }
+    return 0;
+}
+
+static const char *fs_type (const char *dir)
+{
+    static char buf[32];
+    struct statfs sf;
+    if (statfs (dir, &sf)) { return "unknown"; }
+    switch ((unsigned long) sf.f_type) {
+	case 0x01021994UL: return "tmpfs";
+	case 0x0000EF53UL: return "ext4";
+	case 0x58465342UL: return "xfs";
+	case 0x9123683EUL: return "btrfs";
+	case 0x794C7630UL: return "overlayfs";
+	case 0x2FC12FC1UL: return "zfs";
+	default: break;
+    }
+    sprintf (buf, "0x%lx", (unsigned long) sf.f_type);
+    return buf;
+}
+
+/* Write 's' as a JSON string (with '"', '\\' and the control characters
+** escaped) ...
+*/
+static void put_json_string (const char *s)
+{
+    const unsigned char *p = (const unsigned char *) s;
+    putchar ('"');
+    for (; *p; ++p) {
+	if (*p == '"' || *p == '\\') {
+	    putchar ('\\'); putchar (*p);
+	} else if (*p < 0x20) {
+	    printf ("\\u%04x", (unsigned int) *p);
+	} else {
+	    putchar (*p);
+	}
+    }
+    putchar ('"');
+}
+
+static void put_result (struct bench *b, const struct variant *v,
+			const struct result *r)
+{
+    unsigned long long bytes = (v->copies ? b->bytes : 0);
+    double eps = (r->wall > 0 ? (double) b->entries / r->wall : 0);
+    double bps = (r->wall > 0 ? (double) bytes / r->wall : 0);
+    const char *fs = fs_type (b->work);
+    if (b->json) {
+	printf ("%s\n  {\"fs\": \"%s\", \"workdir\": ",
+		(b->nrows > 0 ? "," : ""), fs);
+	put_json_string (b->work);
+	printf (", \"variant\": \"%s\","
+		" \"entries\": %llu, \"bytes\": %llu, \"runs\": %d,"
+		" \"wall_s\": %.6f, \"user_s\": %.6f, \"sys_s\": %.6f,"
+		" \"entries_per_s\": %.1f, \"bytes_per_s\": %.1f,"
+		" \"syscalls\": %lld, \"maxrss_kb\": %ld}",
+		v->name, b->entries, bytes, b->runs, r->wall, r->user, r->sys,
+		eps, bps, r->syscalls, r->maxrss);
+    } else {
+	printf ("%s\t%s\t%llu\t%llu\t%d\t%.6f\t%.6f\t%.6f\t%.1f\t%.1f\t%lld"
+		"\t%ld\n", fs, v->name, b->entries, bytes, b->runs, r->wall,
+		r->user, r->sys, eps, bps, r->syscalls, r->maxrss);
+    }
+    ++b->nrows;
+}
+
+static int selected (const char *list, const char *name)
+{
+    size_t len = strlen (name);
+    const char *p = list;
+    if (! list) { return 1; }
+    while ((p = strstr (p, name))) {
+	if ((p == list || p[-1] == ',') && (p[len] == ',' || !p[len])) {
+	    return 1;
+	}
+	p += len;
+    }
+    return 0;
+}
+
+/* Generate the tree (and the auxiliary files) in the work directory and run
+** the selected variants ...
+*/
+static int bench_workdir (struct bench *b, const char *tlist)
+{
+    const struct variant *v;
+    struct result best, r;
+    FILE *fp;
+    int ix, rc = 0;
+    b->tree = bconcat (b->work, "tree"); b->dst = bconcat (b->work, "dst");
+    b->victim = bconcat (b->work, "victim");
+    b->outdir = bconcat (b->work, "out");
+    b->exclfile = bconcat (b->work, "excludes");
+    ifnull (b->cpcmd = t_allocv (char, strlen (b->tree) + 32)) { return -1; }
+    sprintf (b->cpcmd, "cp -R '%s/.' '%%d'", b->tree);
+    b->entries = b->bytes = 0;
+    if (rm_tree (b->tree) || gen_tree (b, b->tree, b->depth)) {
+	fprintf (stderr, "%s: %s - %s\n", prog, b->tree, strerror (errno));
+	return -1;
+    }
+    ifnull (fp = fopen (b->exclfile, "w")) {
+	fprintf (stderr, "%s: %s - %s\n", prog, b->exclfile, strerror (errno));
+	return -1;
+    }
+    for (ix = 0; ix < b->excludes; ++ix) {
+	if (ix == 0) { fputs ("*.o\n", fp); } else {
+	    fprintf (fp, "*.nomatch%d\n", ix);
+	}
+    }
+    fclose (fp);
+    for (v = variants; v->name; ++v) {
+	if (! selected (tlist, v->name)) { continue; }
+	memset (&best, 0, sizeof(best)); memset (&r, 0, sizeof(r));
+	for (ix = 0; ix < b->runs; ++ix) {
+	    if (run_once (b, v, 0, &r)) { rc = -1; break; }
+	    if (ix == 0 || r.wall < best.wall) { best = r; }
+	}
+	if (ix < b->runs) { continue; }
+	best.syscalls = -1;
+	if (b->count && run_once (b, v, 1, &r) == 0) {
+	    best.syscalls = r.syscalls;
+	}
+	put_result (b, v, &best);
+    }
+    rm_tree (b->tree); rm_tree (b->dst); rm_tree (b->victim);
+    rm_tree (b->outdir); unlink (b->exclfile);
+    free (b->tree); free (b->dst); free (b->victim); free (b->outdir);
+    free (b->exclfile); free (b->cpcmd);
+    return rc;
+}
+
+/* Build the tool programs (via their wrappers in the directory 'srcdir')
+** into the directory 'bindir' ...
+*/
+static int build_tools (const char *srcdir, const char *bindir)
+{
+    static const char *const tools[] = { "install", "distfile", "cgen", 0 };
+    const char *const *t;
+    char *wrapper, *target;
+    pid_t pid;
+    int st;
+    if (mkdir (bindir, 0755) && errno != EEXIST) { return -1; }
+    for (t = tools; *t; ++t) {
+	wrapper = bconcat (srcdir, *t); target = bconcat (bindir, *t);
+	if ((pid = fork ()) == 0) {
+	    execl (wrapper, wrapper, "--build", target, (char *) NULL);
+	    fprintf (stderr, "%s: %s - %s\n", prog, wrapper, strerror (errno));
+	    _exit (127);
+	}
+	free (wrapper); free (target);
+	if (pid < 0 || waitpid (pid, &st, 0) != pid
+	||  ! WIFEXITED (st) || WEXITSTATUS (st) != 0) {
+	    fprintf (stderr, "%s: building '%s' failed\n", prog, *t);
+	    return -1;
+	}
+    }
+    return 0;
+}
+
+static void usage (const char *format, ...)
+{
+    if (format) {
+	va_list ual;
+	fprintf (stderr, "%s: ", prog);
+	va_start (ual, format); vfprintf (stderr, format, ual); va_end (ual);
+	fputs ("\n", stderr);
+	exit (64);
+    }
+    printf ("Usage: %s [-d depth] [-w fanout] [-f files] [-s size]"
+	    " [-x excludes] [-j N]\n"
+	    "       %*s [-r runs] [-t variant,...] [-B bindir] [-n] [-J]"
+	    " workdir...\n"
+	    "       %s -h\n"
+	    "\nOptions:"
+	    "\n  -B bindir"
+	    "\n    take the tool programs from 'bindir' (instead of building"
+	    " them)"
+	    "\n  -d depth"
+	    "\n    the depth of the generated tree (default: 4)"
+	    "\n  -f files"
+	    "\n    the number of files per directory (default: 16)"
+	    "\n  -h"
+	    "\n    display this text and terminate"
+	    "\n  -J"
+	    "\n    write the results as JSON (instead of tab-separated values)"
+	    "\n  -j N"
+	    "\n    the number of workers of the 'pwalk' variant (default: 4)"
+	    "\n  -n"
+	    "\n    don't count the system calls"
+	    "\n  -r runs"
+	    "\n    the number of runs of each variant (default: 3)"
+	    "\n  -s size"
+	    "\n    the size of each file (default: 1024)"
+	    "\n  -t variant,..."
+	    "\n    the variants to run (travdir, travdirnd, travdirne, pwalk,"
+	    " install,"
+	    "\n    distfile-src, distfile-bin, cgen-clean; default: all)"
+	    "\n  -w fanout"
+	    "\n    the number of sub-directories per directory (default: 4)"
+	    "\n  -x excludes"
+	    "\n    the number of exclude patterns (default: 16)\n",
+	    prog, (int) strlen (prog), "", prog);
+    exit (0);
+}
+
+static long numarg (int opt, const char *arg, long min, long max)
+{
+    char *p;
+    long lv = strtol (arg, &p, 10);
+    if (p == arg || *p || lv < min || lv > max) {
+	usage ("invalid argument for '-%c' (%ld..%ld expected)", opt, min,
+	       max);
+    }
+    return lv;
+}
+
+int main (int argc, char *argv[])
+{
+    struct bench b;
+    const char *tlist = NULL;
+    char *srcdir, *bindir = NULL;
+    int opt, ix, rc = 0;
+
+    set_prog (argc, argv);
+    memset (&b, 0, sizeof(b));
+    b.depth = 4; b.fanout = 4; b.files = 16; b.size = 1024; b.excludes = 16;
+    b.njobs = 4; b.runs = 3; b.count = 1;
+    while ((opt = getopt (argc, argv, ":B:d:f:hJj:nr:s:t:w:x:")) != -1) {
+	switch (opt) {
+	    case 'B': b.bindir = optarg; break;
+	    case 'd': b.depth = (int) numarg (opt, optarg, 0, 16); break;
+	    case 'f': b.files = (int) numarg (opt, optarg, 0, 100000); break;
+	    case 'h': usage (NULL); break;
+	    case 'J': b.json = 1; break;
+	    case 'j': b.njobs = (int) numarg (opt, optarg, 1, 256); break;
+	    case 'n': b.count = 0; break;
+	    case 'r': b.runs = (int) numarg (opt, optarg, 1, 1000); break;
+	    case 's':
+		b.size = (size_t) numarg (opt, optarg, 0, 1L << 30); break;
+	    case 't': tlist = optarg; break;
+	    case 'w': b.fanout = (int) numarg (opt, optarg, 1, 1000); break;
+	    case 'x': b.excludes = (int) numarg (opt, optarg, 1, 64); break;
+	    case ':':
+		usage ("missing argument for option '-%c'", optopt);
+		break;
+	    default:
+		usage ("invalid option '-%c'", optopt);
+		break;
+	}
+    }
+    if (optind >= argc) { usage ("missing argument(s)"); }
+    for (ix = optind; ix < argc; ++ix) {
+	if (*argv[ix] != '/') {
+	    usage ("'%s' - no absolute pathname", argv[ix]);
+	}
+    }
+
+    /* The tool programs are built (once) from the sources beside this
+    ** program ...
+    */
+    if (! b.bindir) {
+	ifnull (srcdir = dir_of (argv[0])) {
+	    fprintf (stderr, "%s: %s\n", prog, strerror (errno)); exit (1);
+	}
+	b.bindir = bindir = bconcat (argv[optind], "bin");
+	if (build_tools (srcdir, bindir)) { rm_tree (bindir); exit (1); }
+	free (srcdir);
+    }
+
+    if (b.json) { fputs ("[", stdout); } else {
+	puts ("fs\tvariant\tentries\tbytes\truns\twall_s\tuser_s\tsys_s"
+	      "\tentries_per_s\tbytes_per_s\tsyscalls\tmaxrss_kb");
+    }
+    for (ix = optind; ix < argc; ++ix) {
+	b.work = argv[ix];
+	if (bench_workdir (&b, tlist)) { rc = 1; }
+    }
+    if (b.json) { fputs ("\n]\n", stdout); }
+    if (bindir) { rm_tree (bindir); free (bindir); }
+    return rc;
+}
@@ -35,26 +35,21 @@
 #include "lib/set_prog.c"
 
 #include "lib/bconc.c"
+#include "lib/dirread.c"
+#include "lib/dr_open.c"
 
 static int
 dir_is_empty (const char *dir)
 {
-    int cc = 0;
-    const char *p;
-    struct dirent *de = NULL;
-    DIR *dp = opendir (dir);
-    if (!dp) { return -1; }
-    while ((de = readdir (dp))) {
-        p = de->d_name;
-        /* Don't know if this is required: if (!*p) { continue; }*/
-        if (*p == '.') {
-            if (*++p == '\0') { continue; }
-            if (*p == '.' && *++p == '\0') { continue; }
-        }
-        ++cc;
-    }
-    closedir (dp);
-    return cc == 0;
+    int rc;
+    struct dirread dr;
+    struct dr_entry de;
+    /* (Only the first entry is of interest, so a small buffer suffices) */
+    dr_init (&dr, 1024);
+    if (dr_open (&dr, dir)) { dr_free (&dr); return -1; }
+    rc = dr_next (&dr, &de);
+    dr_free (&dr);
+    return (rc < 0 ? -1 : rc == 0);
 }
 
 static void